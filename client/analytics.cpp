@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "movegen.h"
+#include "record.h"
+
+using namespace bura;
+
+// Columnar turn table built from record files.
+//
+// <dir>/<column>.col: ColumnHeader followed by rows * width bytes.
+// One row per recorded event. Move events carry the hand and table of the state they answered.
+
+namespace {
+
+constexpr uint32_t kColumnMagic = 0x4C4F4342;  // "BCOL"
+constexpr size_t kBlockRows = 4096;
+
+#pragma pack(push, 1)
+struct ColumnHeader {
+  uint32_t magic;
+  uint16_t width;
+  uint16_t reserved;
+  uint64_t rows;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ColumnHeader) == 16, "ColumnHeader must be 16 bytes");
+
+enum Column : size_t { GameId, Kind, Status, Hand, Attack, Defend, Trump, Heap, Outcome, Deal, ColumnCount };
+
+const std::array<const char *, ColumnCount> kColumnNames = {"game", "kind", "status", "hand", "attack", "defend", "trump", "heap", "outcome", "deal"};
+const std::array<uint16_t, ColumnCount> kColumnWidths = {4, 1, 1, 8, 8, 8, 1, 1, 1, 1};
+
+// Build
+
+class ColumnWriter {
+ private:
+  std::FILE *file;
+  uint16_t width;
+  uint64_t rows{0};
+  std::vector<uint8_t> buffer;
+
+  void flush() {
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) throw std::runtime_error("Failed to write column");
+    buffer.clear();
+  }
+
+ public:
+  ColumnWriter(const std::string &path, uint16_t width) : file(std::fopen(path.c_str(), "wb")), width(width) {
+    if (file == nullptr) throw std::runtime_error("Failed to create " + path);
+    ColumnHeader header{kColumnMagic, width, 0, 0};
+    std::fwrite(&header, sizeof(header), 1, file);
+    buffer.reserve(kBlockRows * width);
+  }
+  ColumnWriter(const ColumnWriter &) = delete;
+
+  ~ColumnWriter() {
+    flush();
+    ColumnHeader header{kColumnMagic, width, 0, rows};
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fclose(file);
+  }
+
+  template <typename T>
+  void push(T value) {
+    static_assert(sizeof(T) <= 8, "Column values are at most 8 bytes");
+    auto data = reinterpret_cast<const uint8_t *>(&value);
+    buffer.insert(buffer.end(), data, data + width);
+    if (buffer.size() >= kBlockRows * width) flush();
+    rows++;
+  }
+};
+
+uint64_t build(const std::string &dir, const std::vector<std::string> &records) {
+  std::vector<std::unique_ptr<ColumnWriter>> columns;
+  for (size_t i = 0; i < ColumnCount; ++i) columns.emplace_back(std::make_unique<ColumnWriter>(dir + "/" + kColumnNames[i] + ".col", kColumnWidths[i]));
+
+  uint32_t gameId = 0;
+  uint64_t rows = 0;
+
+  for (const auto &path : records) {
+    record::RecordReader reader(path);
+
+    for (size_t g = 0; g < reader.size(); ++g, ++gameId) {
+      auto game = reader.game(g);
+      auto outcome = static_cast<int8_t>(game.result());
+      auto events = game.events();
+      bool dealt = false;
+
+      while (events.next()) {
+        auto &event = events.event();
+        auto &state = events.state();
+
+        bool deal = event.kind == record::EventKind::State && !dealt && state.hand != 0;
+        dealt = dealt || deal;
+
+        CardMask attack = 0, defend = 0;
+        for (uint8_t i = 0; i < state.attackCount; ++i) attack |= Card::fromIndex(state.attack[i]).mask();
+        for (uint8_t i = 0; i < state.defendCount; ++i) defend |= Card::fromIndex(state.defend[i]).mask();
+
+        columns[GameId]->push(gameId);
+        columns[Kind]->push(static_cast<uint8_t>(event.kind));
+        columns[Status]->push(event.status);
+        columns[Hand]->push(state.hand);
+        columns[Attack]->push(attack);
+        columns[Defend]->push(defend);
+        columns[Trump]->push(static_cast<uint8_t>(state.trump == kNoCard ? kNoCard : state.trump / kValueCount));
+        columns[Heap]->push(state.inHeap);
+        columns[Outcome]->push(outcome);
+        columns[Deal]->push(static_cast<uint8_t>(deal));
+        rows++;
+      }
+    }
+  }
+
+  return rows;
+}
+
+// Scan
+
+struct Filter {
+  int kind{-1};
+  int status{-100};
+  int minTrumps{-1};
+  bool deal{false};
+};
+
+struct Aggregate {
+  uint64_t rows{0};
+  uint64_t wins{0};
+  uint64_t losses{0};
+  uint64_t beatable{0};
+
+  Aggregate &operator+=(const Aggregate &other) {
+    rows += other.rows;
+    wins += other.wins;
+    losses += other.losses;
+    beatable += other.beatable;
+    return *this;
+  }
+};
+
+class Table {
+ private:
+  std::array<MappedFile, ColumnCount> files;
+  std::array<const uint8_t *, ColumnCount> data{};
+  uint64_t rowCount{0};
+
+ public:
+  explicit Table(const std::string &dir) {
+    for (size_t i = 0; i < ColumnCount; ++i) {
+      auto path = dir + "/" + kColumnNames[i] + ".col";
+      files[i] = MappedFile(path);
+
+      ColumnHeader header{};
+      if (files[i].size() < sizeof(header)) throw std::runtime_error("Invalid column " + path);
+      std::memcpy(&header, files[i].begin(), sizeof(header));
+
+      if (header.magic != kColumnMagic || header.width != kColumnWidths[i] || files[i].size() < sizeof(header) + header.rows * header.width)
+        throw std::runtime_error("Invalid column " + path);
+      if (i > 0 && header.rows != rowCount) throw std::runtime_error("Column " + path + " has a different row count");
+
+      rowCount = header.rows;
+      data[i] = files[i].begin() + sizeof(header);
+    }
+  }
+
+  [[nodiscard]] uint64_t rows() const { return rowCount; }
+
+  template <typename T>
+  [[nodiscard]] const T *column(Column column) const {
+    return reinterpret_cast<const T *>(data[column]);
+  }
+
+  // Filters one block into a selection vector, then aggregates the selected rows
+  Aggregate scan(const Filter &filter, uint64_t begin, uint64_t end) const {
+    Aggregate result;
+    std::array<uint8_t, kBlockRows> selected{};
+    std::array<uint32_t, kBlockRows> rows{};
+
+    auto kind = column<uint8_t>(Kind);
+    auto status = column<int8_t>(Status);
+    auto hand = column<CardMask>(Hand);
+    auto attack = column<CardMask>(Attack);
+    auto trump = column<uint8_t>(Trump);
+    auto outcome = column<int8_t>(Outcome);
+    auto deal = column<uint8_t>(Deal);
+
+    for (uint64_t block = begin; block < end; block += kBlockRows) {
+      auto size = static_cast<size_t>(std::min<uint64_t>(kBlockRows, end - block));
+
+      for (size_t i = 0; i < size; ++i) selected[i] = 1;
+
+      if (filter.kind >= 0)
+        for (size_t i = 0; i < size; ++i) selected[i] &= kind[block + i] == filter.kind;
+
+      if (filter.status > -100)
+        for (size_t i = 0; i < size; ++i) selected[i] &= status[block + i] == filter.status;
+
+      if (filter.deal)
+        for (size_t i = 0; i < size; ++i) selected[i] &= deal[block + i];
+
+      if (filter.minTrumps >= 0)
+        for (size_t i = 0; i < size; ++i) {
+          auto suit = trump[block + i];
+          auto trumps = suit < kSuitCount ? cardCount(hand[block + i] & MoveGen::suitMask(suit)) : 0;
+          selected[i] &= trumps >= filter.minTrumps;
+        }
+
+      size_t count = 0;
+      for (size_t i = 0; i < size; ++i) {
+        rows[count] = static_cast<uint32_t>(i);
+        count += selected[i];
+      }
+
+      result.rows += count;
+
+      for (size_t j = 0; j < count; ++j) {
+        auto row = block + rows[j];
+        result.wins += outcome[row] == static_cast<int8_t>(GameStatus::Win);
+        result.losses += outcome[row] == static_cast<int8_t>(GameStatus::Lose);
+      }
+
+      if (filter.kind == static_cast<int>(record::EventKind::Pass))
+        for (size_t j = 0; j < count; ++j) {
+          auto row = block + rows[j];
+          result.beatable += MoveGen::canDefend(hand[row], attack[row], trump[row]);
+        }
+    }
+
+    return result;
+  }
+};
+
+Aggregate run(const Table &table, const Filter &filter, unsigned threadCount) {
+  auto blocks = (table.rows() + kBlockRows - 1) / kBlockRows;
+  threadCount = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(threadCount, blocks)));
+
+  std::vector<Aggregate> partial(threadCount);
+  std::vector<std::thread> threads;
+
+  for (unsigned t = 0; t < threadCount; ++t) {
+    auto begin = std::min(table.rows(), blocks * t / threadCount * kBlockRows);
+    auto end = std::min(table.rows(), blocks * (t + 1) / threadCount * kBlockRows);
+    threads.emplace_back([&, t, begin, end]() { partial[t] = table.scan(filter, begin, end); });
+  }
+
+  Aggregate result;
+  for (unsigned t = 0; t < threadCount; ++t) {
+    threads[t].join();
+    result += partial[t];
+  }
+  return result;
+}
+
+void usage() {
+  std::cout << "Usage:\n"
+               "  client_analytics build <dir> <record>...\n"
+               "  client_analytics scan <dir> [--kind state|move|defend|pass] [--status N] [--min-trumps N] [--deal] [--threads N]\n"
+               "  client_analytics trump-win <dir> [N]\n"
+               "  client_analytics pass-beatable <dir>\n";
+}
+
+int kindFromName(const std::string &name) {
+  if (name == "state") return static_cast<int>(record::EventKind::State);
+  if (name == "move") return static_cast<int>(record::EventKind::Move);
+  if (name == "defend") return static_cast<int>(record::EventKind::Defend);
+  if (name == "pass") return static_cast<int>(record::EventKind::Pass);
+  throw std::invalid_argument("Unknown event kind: " + name);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+
+  std::string command = argv[1];
+  std::string dir = argv[2];
+
+  try {
+    if (command == "build") {
+      auto start = std::chrono::steady_clock::now();
+      auto rows = build(dir, std::vector<std::string>(argv + 3, argv + argc));
+      auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << "rows: " << rows << " (" << seconds << " s)" << std::endl;
+      return 0;
+    }
+
+    Filter filter;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (command == "trump-win") {
+      filter.deal = true;
+      filter.minTrumps = argc > 3 ? std::stoi(argv[3]) : 3;
+    } else if (command == "pass-beatable") {
+      filter.kind = static_cast<int>(record::EventKind::Pass);
+    } else if (command == "scan") {
+      for (int i = 3; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--deal")
+          filter.deal = true;
+        else if (i + 1 >= argc)
+          throw std::invalid_argument("Missing value for " + option);
+        else if (option == "--kind")
+          filter.kind = kindFromName(argv[++i]);
+        else if (option == "--status")
+          filter.status = std::stoi(argv[++i]);
+        else if (option == "--min-trumps")
+          filter.minTrumps = std::stoi(argv[++i]);
+        else if (option == "--threads")
+          threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        else
+          throw std::invalid_argument("Unknown option: " + option);
+      }
+    } else {
+      usage();
+      return 1;
+    }
+
+    Table table(dir);
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = run(table, filter, threads);
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto decided = result.wins + result.losses;
+
+    std::cout << "rows: " << result.rows << " of " << table.rows() << std::endl;
+    std::cout << "wins: " << result.wins << ", losses: " << result.losses;
+    if (decided > 0) std::cout << ", win rate: " << 100.0 * static_cast<double>(result.wins) / static_cast<double>(decided) << "%";
+    std::cout << std::endl;
+
+    if (filter.kind == static_cast<int>(record::EventKind::Pass)) {
+      std::cout << "passed with a beatable table: " << result.beatable;
+      if (result.rows > 0) std::cout << " (" << 100.0 * static_cast<double>(result.beatable) / static_cast<double>(result.rows) << "%)";
+      std::cout << std::endl;
+    }
+
+    std::cout << "scan: " << seconds * 1000 << " ms, " << static_cast<double>(table.rows()) / std::max(seconds, 1e-9) / 1e6 << " M turns/s, "
+              << threads << " threads" << std::endl;
+  } catch (std::exception &err) {
+    std::cout << err.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,595 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "bot_client.cpp"
+#include "evaluator.h"
+#include "http.h"
+#include "loopback.h"
+#include "movegen.h"
+#include "rng.h"
+#include "screen.h"
+
+// Micro-benchmarks for client hot paths.
+//
+// client_bench [--filter <substr>] [--out <file>] [--compare <baseline.json>] [--threshold <percent>]
+// Results are printed as JSON to stdout (or --out); the comparison report goes to stderr.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename T>
+inline void keep(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Result {
+  std::string name;
+  double nsPerOp{};
+  uint64_t iterations{};
+};
+
+// Counts what reaches the console: characters, and bytes once encoded as UTF-8
+class CountingBuffer : public std::wstreambuf {
+ public:
+  size_t count{0};
+  size_t bytes{0};
+
+ protected:
+  static size_t utf8Size(wchar_t c) { return c < 0x80 ? 1 : c < 0x800 ? 2 : 3; }
+
+  int_type overflow(int_type c) override {
+    count++;
+    bytes += utf8Size(static_cast<wchar_t>(c));
+    return c;
+  }
+  std::streamsize xsputn(const wchar_t *s, std::streamsize n) override {
+    count += static_cast<size_t>(n);
+    for (std::streamsize i = 0; i < n; ++i) bytes += utf8Size(s[i]);
+    return n;
+  }
+};
+
+using Body = std::function<void(uint64_t)>;
+
+double timeRun(const Body &body, uint64_t iterations) {
+  auto start = Clock::now();
+  for (uint64_t i = 0; i < iterations; ++i) body(i);
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Grows the iteration count until one run takes 20 ms, then reports the median of 7 runs
+Result measure(const std::string &name, const Body &body) {
+  uint64_t iterations = 1;
+  while (timeRun(body, iterations) < 20e6 && iterations < (uint64_t{1} << 32)) iterations *= 2;
+
+  std::vector<double> samples;
+  for (int run = 0; run < 7; ++run) samples.push_back(timeRun(body, iterations) / static_cast<double>(iterations));
+  std::sort(samples.begin(), samples.end());
+
+  return {name, samples[samples.size() / 2], iterations};
+}
+
+template <typename T>
+void write(std::vector<uint8_t> &buffer, T value) {
+  auto data = reinterpret_cast<const uint8_t *>(&value);
+  buffer.insert(buffer.end(), data, data + sizeof(T));
+}
+
+void writeCards(std::vector<uint8_t> &buffer, const std::vector<Card> &cards) {
+  write(buffer, static_cast<uint32_t>(cards.size()));
+  for (auto &card : cards) write(buffer, card.type());
+}
+
+GameState sampleState() {
+  GameState state;
+  state.status = GameStatus::YourDef;
+  state.trump = Card(CardSuit::Spades, CardValue::Nine);
+  state.inHeap = 12;
+  state.inFall = 8;
+  state.my_cards = {Card(CardSuit::Hearts, CardValue::Ace),  Card(CardSuit::Hearts, CardValue::Ten),  Card(CardSuit::Clubs, CardValue::King),
+                    Card(CardSuit::Spades, CardValue::Six),  Card(CardSuit::Diamonds, CardValue::Jack), Card(CardSuit::Clubs, CardValue::Seven)};
+  state.opponent_cards.assign(6, Card(CardSuit::None, CardValue::None, true));
+  state.attack_cards = {Card(CardSuit::Hearts, CardValue::Eight), Card(CardSuit::Clubs, CardValue::Eight)};
+  return state;
+}
+
+std::vector<uint8_t> fetchResponse(const GameState &state) {
+  std::vector<uint8_t> buffer;
+  write(buffer, static_cast<int8_t>(state.status));
+  write(buffer, state.trump.type());
+  write(buffer, state.inHeap);
+  write(buffer, state.inFall);
+  writeCards(buffer, state.my_cards);
+  writeCards(buffer, state.opponent_cards);
+  writeCards(buffer, state.attack_cards);
+  writeCards(buffer, state.defend_cards);
+
+  std::string nickname = "Opponent";
+  write(buffer, static_cast<uint32_t>(nickname.size()));
+  buffer.insert(buffer.end(), nickname.begin(), nickname.end());
+  return buffer;
+}
+
+std::string httpResponse(const std::vector<uint8_t> &body) {
+  std::string result =
+      "HTTP/1.1 200 OK\r\n"
+      "Date: Sun, 18 Oct 2026 12:00:00 GMT\r\n"
+      "Connection: keep-alive\r\n"
+      "Keep-Alive: timeout=5\r\n"
+      "Content-Length: " +
+      std::to_string(body.size() + 2) + "\r\n\r\n";
+  result.append(2, '\0');
+  result.append(body.begin(), body.end());
+  return result;
+}
+
+void drawFrame(Screen &screen, int frame) {
+  screen.printText(0, 0, std::wstring(static_cast<size_t>(screen.getWidth() * screen.getHeight()), ' ').c_str(), COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+  for (int i = 0; i < 6; ++i) {
+    int x = 40 + i * 5 + (frame & 1) * 2;
+    screen.printText(x, 40, L"╔══════╗\n║A♥    ║\n║      ║\n║      ║\n║    A♥║\n╚══════╝", i == frame % 6 ? COLOR_ACTIVE_CARD_FG : COLOR_DEFAULT_FG,
+                     COLOR_DEFAULT_BG);
+  }
+  screen.printTextAlignCenter(80, 20, frame & 1 ? L"Your Move" : L"Opponent Move", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+}
+
+// Random positions as a player sees them: hands of 1 to 18 cards, now and then an attack left on the table
+std::vector<EvalPosition> randomEvalPositions(size_t count) {
+  Rng rng(2);
+  std::array<uint8_t, kDeckSize> deck{};
+  for (uint8_t i = 0; i < kDeckSize; ++i) deck[i] = i;
+
+  std::vector<EvalPosition> positions(count);
+  for (auto &position : positions) {
+    rng.shuffle(deck.begin(), deck.end());
+    auto size = 1 + rng.below(18);
+    for (size_t i = 0; i < size; ++i) position.hand |= CardMask{1} << deck[i];
+    if (rng.below(2) == 0) position.table = MoveGen::rankMask(deck[size] % kValueCount) & ~position.hand;
+    position.trumpSuit = static_cast<uint8_t>(rng.below(kSuitCount));
+    position.inHeap = static_cast<uint8_t>(rng.below(25));
+    position.inFall = static_cast<uint8_t>(rng.below(25));
+    position.opponentCards = static_cast<uint8_t>(1 + rng.below(18));
+  }
+  return positions;
+}
+
+std::vector<Result> runAll(const std::string &filter) {
+  std::vector<std::pair<std::string, Body>> benchmarks;
+
+  std::vector<CardType> types;
+  for (uint8_t i = 0; i < kDeckSize; ++i) types.push_back(Card::fromIndex(i).type());
+
+  std::vector<Card> cards;
+  for (uint8_t i = 0; i < kDeckSize; ++i) cards.push_back(Card::fromIndex(i));
+
+  benchmarks.emplace_back("card/decode", [&](uint64_t i) {
+    Card card(types[i % kDeckSize]);
+    keep(card);
+  });
+
+  benchmarks.emplace_back("card/encode", [&](uint64_t i) {
+    auto type = cards[i % kDeckSize].type();
+    keep(type);
+  });
+
+  benchmarks.emplace_back("card/canUseCard", [&](uint64_t i) {
+    auto result = Card::canUseCard(cards[i % kDeckSize], cards[(i / kDeckSize) % kDeckSize], CardSuit::Spades);
+    keep(result);
+  });
+
+  Rng rng(1);
+  std::array<uint8_t, kDeckSize> deck{};
+  for (uint8_t i = 0; i < kDeckSize; ++i) deck[i] = i;
+
+  benchmarks.emplace_back("rng/next", [&](uint64_t) {
+    auto value = rng();
+    keep(value);
+  });
+
+  benchmarks.emplace_back("rng/below", [&](uint64_t i) {
+    auto value = rng.below(1 + i % kDeckSize);
+    keep(value);
+  });
+
+  benchmarks.emplace_back("rng/shuffle", [&](uint64_t) {
+    rng.shuffle(deck.begin(), deck.end());
+    keep(deck);
+  });
+
+  benchmarks.emplace_back("rng/playerId", [&](uint64_t) {
+    auto id = generateRandomString(8);
+    keep(id);
+  });
+
+  auto state = sampleState();
+  auto payload = fetchResponse(state);
+  GameState decoded;
+
+  benchmarks.emplace_back("client/decodeState", [&](uint64_t) {
+    BuraClient::decodeState(payload.data(), payload.size(), decoded);
+    keep(decoded);
+  });
+
+  proto::Move move{state.id, state.my_cards};
+  std::vector<uint8_t> encoded;
+
+  benchmarks.emplace_back("client/encodeMove", [&](uint64_t) {
+    encoded.clear();
+    proto::MoveRequest::encode(move, encoded);
+    keep(encoded);
+  });
+
+  auto response = httpResponse(payload);
+
+  benchmarks.emplace_back("http/parseResponse", [&](uint64_t) {
+    http::ResponseParser parser;
+    parser.feed(reinterpret_cast<const uint8_t *>(response.data()), response.size());
+    auto result = parser.take();
+    keep(result);
+  });
+
+  benchmarks.emplace_back("http/parseResponse/split", [&](uint64_t) {
+    http::ResponseParser parser;
+    for (size_t offset = 0; offset < response.size(); offset += 16)
+      parser.feed(reinterpret_cast<const uint8_t *>(response.data()) + offset, std::min<size_t>(16, response.size() - offset));
+    auto result = parser.take();
+    keep(result);
+  });
+
+  auto defendState = state;
+  auto moveState = state;
+  moveState.status = GameStatus::YourMove;
+  moveState.attack_cards.clear();
+
+  benchmarks.emplace_back("bot/decide/move", [&](uint64_t) {
+    auto decision = BuraBot::decide(moveState);
+    keep(decision);
+  });
+
+  benchmarks.emplace_back("bot/decide/defend", [&](uint64_t) {
+    auto decision = BuraBot::decide(defendState);
+    keep(decision);
+  });
+
+  benchmarks.emplace_back("cache/canonical", [&](uint64_t) {
+    auto canonical = CanonicalState::of(defendState);
+    keep(canonical);
+  });
+
+  // The decision on a hit: canonicalize, look up, map the cards back
+  auto decisionCache = std::make_shared<DecisionCache>();
+  BuraBot::Strategy cachedBot;
+  CachedStrategy<BuraBot::Strategy> cachedStrategy(cachedBot, decisionCache);
+  std::vector<Card> cachedDefence;
+  cachedStrategy.onDefend(defendState, cachedDefence);
+
+  benchmarks.emplace_back("cache/defend/hit", [&](uint64_t) {
+    auto defend = cachedStrategy.onDefend(defendState, cachedDefence);
+    keep(defend);
+    keep(cachedDefence);
+  });
+
+  auto evalPositions = randomEvalPositions(256);
+  EvalWeights evalWeights;
+  EvalBatch evalBatch;
+  for (const auto &position : evalPositions) evalBatch.add(position);
+  std::vector<float> evalScores(evalPositions.size());
+
+  benchmarks.emplace_back("eval/batch256", [&](uint64_t) {
+    evalBatch.score(evalWeights, evalScores.data());
+    keep(evalScores);
+  });
+
+  MoveList moves;
+
+  benchmarks.emplace_back("movegen/attacks", [&](uint64_t) {
+    moves.clear();
+    MoveGen::generate(moveState, moves);
+    keep(moves);
+  });
+
+  benchmarks.emplace_back("movegen/defences", [&](uint64_t) {
+    moves.clear();
+    MoveGen::generate(defendState, moves);
+    keep(moves);
+  });
+
+  Move defence;
+
+  benchmarks.emplace_back("movegen/cheapestDefence", [&](uint64_t) {
+    auto found = MoveGen::cheapestDefence(defendState, defence);
+    keep(found);
+    keep(defence);
+  });
+
+  // Four Eights against a hand of the twelve cards that beat them and more
+  auto largeState = defendState;
+  largeState.attack_cards = {Card(CardSuit::Hearts, CardValue::Eight), Card(CardSuit::Diamonds, CardValue::Eight), Card(CardSuit::Clubs, CardValue::Eight),
+                             Card(CardSuit::Spades, CardValue::Eight)};
+  largeState.my_cards.clear();
+  for (auto suit : {CardSuit::Hearts, CardSuit::Diamonds, CardSuit::Clubs, CardSuit::Spades})
+    for (auto value : {CardValue::Ace, CardValue::Ten, CardValue::Seven}) largeState.my_cards.emplace_back(suit, value);
+
+  benchmarks.emplace_back("movegen/cheapestDefence/4", [&](uint64_t) {
+    auto found = MoveGen::cheapestDefence(largeState, defence);
+    keep(found);
+    keep(defence);
+  });
+
+  // A whole bot-vs-bot game through BuraClient, the server in process and MoveLog skipped
+  LocalServerConfig localConfig;
+  localConfig.moveLogBase = localConfig.moveLogPerCard = std::chrono::milliseconds::zero();
+  localConfig.seed = 1;
+  auto localServer = std::make_shared<LocalServer>(localConfig);
+  BuraBot::Strategy firstBot, secondBot;
+
+  benchmarks.emplace_back("loopback/game", [&](uint64_t) {
+    auto status = playLocalGame(localServer, firstBot, secondBot);
+    keep(status);
+  });
+
+  Screen screen(160, 48), screen256(160, 48), screen16(160, 48);
+  screen256.setColorMode(ColorMode::Palette256);
+  screen16.setColorMode(ColorMode::Palette16);
+  CountingBuffer counter;
+  std::wostream sink(&counter);
+
+  benchmarks.emplace_back("render/flush", [&](uint64_t i) {
+    drawFrame(screen, static_cast<int>(i));
+    screen.flush(sink);
+  });
+
+  benchmarks.emplace_back("render/flush/256", [&](uint64_t i) {
+    drawFrame(screen256, static_cast<int>(i));
+    screen256.flush(sink);
+  });
+
+  benchmarks.emplace_back("render/flush/16", [&](uint64_t i) {
+    drawFrame(screen16, static_cast<int>(i));
+    screen16.flush(sink);
+  });
+
+  std::vector<Result> results;
+  for (auto &item : benchmarks) {
+    if (!filter.empty() && item.first.find(filter) == std::string::npos) continue;
+    results.push_back(measure(item.first, item.second));
+    std::cerr << std::left << std::setw(28) << results.back().name << std::right << std::setw(12) << std::fixed << std::setprecision(2)
+              << results.back().nsPerOp << " ns/op" << std::endl;
+  }
+  return results;
+}
+
+// Console bytes of the first (full) frame and the mean of the following (diff) frames in every colour mode
+void reportFrameBytes() {
+  const std::pair<const char *, ColorMode> modes[] = {
+      {"truecolor", ColorMode::TrueColor}, {"256", ColorMode::Palette256}, {"16", ColorMode::Palette16}};
+  constexpr int frames = 64;
+  double baseline = 0;
+
+  std::cerr << std::endl << std::left << std::setw(28) << "render bytes/frame" << std::right << std::setw(12) << "full" << std::setw(12) << "diff"
+            << std::setw(10) << "delta" << std::endl;
+
+  for (auto &mode : modes) {
+    Screen screen(160, 48);
+    screen.setColorMode(mode.second);
+    CountingBuffer counter;
+    std::wostream sink(&counter);
+
+    drawFrame(screen, 0);
+    screen.flush(sink);
+    auto full = counter.bytes;
+
+    counter.bytes = 0;
+    for (int i = 1; i <= frames; ++i) {
+      drawFrame(screen, i);
+      screen.flush(sink);
+    }
+    auto diff = static_cast<double>(counter.bytes) / frames;
+    if (baseline == 0) baseline = diff;
+
+    std::cerr << std::left << std::setw(28) << mode.first << std::right << std::setw(12) << full << std::setw(12) << std::fixed
+              << std::setprecision(1) << diff << std::setw(9) << std::showpos << (diff - baseline) / baseline * 100.0 << std::noshowpos << "%" << std::endl;
+  }
+}
+
+// Evaluations per second over batches of 256 successor states
+void reportEval() {
+  auto positions = randomEvalPositions(1 << 16);
+  EvalWeights weights;
+  EvalBatch batch;
+  std::vector<float> scores(256);
+
+  const auto time = [&](bool simd) {
+    size_t total = 0;
+    auto start = Clock::now();
+    for (int round = 0; round < 16; ++round) {
+      for (size_t offset = 0; offset < positions.size(); offset += scores.size()) {
+        batch.clear();
+        for (size_t i = 0; i < scores.size(); ++i) batch.add(positions[offset + i]);
+        batch.score(weights, scores.data(), simd);
+        keep(scores);
+        total += scores.size();
+      }
+    }
+    auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cerr << std::left << std::setw(28) << (simd ? "avx2" : "scalar") << std::right << std::setw(16) << std::fixed << std::setprecision(0)
+              << static_cast<double>(total) / seconds << std::endl;
+  };
+
+  std::cerr << std::endl << std::left << std::setw(28) << "eval" << std::right << std::setw(16) << "evals/s" << std::endl;
+  time(false);
+  if (EvalBatch::simdAvailable()) time(true);
+}
+
+// Moves per second over random positions: hands of 6 to 18 cards, attacks of one to four cards of a rank
+void reportMoveGen() {
+  struct Position {
+    CardMask hand;
+    std::array<uint8_t, kSuitCount> attack;
+    size_t count;
+    uint8_t trump;
+  };
+
+  Rng rng(1);
+  std::array<uint8_t, kDeckSize> deck{};
+  for (uint8_t i = 0; i < kDeckSize; ++i) deck[i] = i;
+
+  std::vector<Position> positions(1 << 16);
+  for (auto &position : positions) {
+    rng.shuffle(deck.begin(), deck.end());
+    position.hand = 0;
+    auto size = 6 + rng.below(13);
+    for (size_t i = 0; i < size; ++i) position.hand |= CardMask{1} << deck[i];
+
+    // The attack: cards of the rank of the next card that are not in the hand
+    auto rank = MoveGen::rankMask(deck[size] % kValueCount) & ~position.hand;
+    position.count = 0;
+    for (; rank != 0 && position.count < 1 + rng.below(kSuitCount); rank &= rank - 1) position.attack[position.count++] = lowestCard(rank);
+    position.trump = static_cast<uint8_t>(rng.below(kSuitCount));
+  }
+
+  MoveList moves;
+  const auto time = [&](bool defences) {
+    size_t total = 0;
+    auto start = Clock::now();
+    for (auto &position : positions) {
+      moves.clear();
+      if (defences)
+        MoveGen::defences(position.hand, position.attack.data(), position.count, position.trump, moves);
+      else
+        MoveGen::attacks(position.hand, moves);
+      total += moves.size();
+    }
+    auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cerr << std::left << std::setw(28) << (defences ? "defences" : "attacks") << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << static_cast<double>(total) / static_cast<double>(positions.size()) << std::setw(16) << std::setprecision(0)
+              << static_cast<double>(total) / seconds << std::endl;
+  };
+
+  std::cerr << std::endl << std::left << std::setw(28) << "movegen" << std::right << std::setw(12) << "moves/pos" << std::setw(16) << "moves/s" << std::endl;
+  time(false);
+  time(true);
+}
+
+std::string toJson(const std::vector<Result> &results) {
+  std::ostringstream ss;
+  ss << std::setprecision(4) << std::fixed << "{\"benchmarks\":[";
+  for (size_t i = 0; i < results.size(); ++i) {
+    ss << (i == 0 ? "" : ",") << "\n  {\"name\":\"" << results[i].name << "\",\"ns_per_op\":" << results[i].nsPerOp
+       << ",\"iterations\":" << results[i].iterations << "}";
+  }
+  ss << "\n]}\n";
+  return ss.str();
+}
+
+// Reads back the format written by toJson
+std::vector<Result> fromJson(const std::string &json) {
+  std::vector<Result> results;
+  size_t position = 0;
+
+  for (;;) {
+    auto name = json.find("\"name\":\"", position);
+    if (name == std::string::npos) break;
+    name += 8;
+    auto nameEnd = json.find('"', name);
+    auto value = json.find("\"ns_per_op\":", nameEnd);
+    if (nameEnd == std::string::npos || value == std::string::npos) break;
+
+    Result result;
+    result.name = json.substr(name, nameEnd - name);
+    result.nsPerOp = std::stod(json.substr(value + 12));
+    results.push_back(result);
+    position = value;
+  }
+
+  return results;
+}
+
+bool compare(const std::vector<Result> &baseline, const std::vector<Result> &current, double threshold) {
+  bool regression = false;
+
+  std::cerr << std::endl
+            << std::left << std::setw(28) << "benchmark" << std::right << std::setw(12) << "baseline" << std::setw(12) << "current" << std::setw(10)
+            << "delta" << std::endl;
+
+  for (auto &result : current) {
+    auto base = std::find_if(baseline.begin(), baseline.end(), [&](const Result &item) { return item.name == result.name; });
+    if (base == baseline.end()) {
+      std::cerr << std::left << std::setw(28) << result.name << "  (new)" << std::endl;
+      continue;
+    }
+
+    auto delta = (result.nsPerOp - base->nsPerOp) / base->nsPerOp * 100.0;
+    bool slower = delta > threshold;
+    regression = regression || slower;
+
+    std::cerr << std::left << std::setw(28) << result.name << std::right << std::fixed << std::setprecision(2) << std::setw(12) << base->nsPerOp
+              << std::setw(12) << result.nsPerOp << std::setw(9) << std::showpos << delta << std::noshowpos << "%"
+              << (slower ? "  REGRESSION" : "") << std::endl;
+  }
+
+  return !regression;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string filter, out, baselinePath;
+  double threshold = 10.0;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << option << std::endl;
+      return 2;
+    }
+
+    if (option == "--filter")
+      filter = argv[++i];
+    else if (option == "--out")
+      out = argv[++i];
+    else if (option == "--compare")
+      baselinePath = argv[++i];
+    else if (option == "--threshold")
+      threshold = std::stod(argv[++i]);
+    else {
+      std::cerr << "Unknown option " << option << std::endl;
+      return 2;
+    }
+  }
+
+  auto results = runAll(filter);
+  if (filter.empty() || filter.find("render") != std::string::npos) reportFrameBytes();
+  if (filter.empty() || filter.find("movegen") != std::string::npos) reportMoveGen();
+  if (filter.empty() || filter.find("eval") != std::string::npos) reportEval();
+  auto json = toJson(results);
+
+  if (out.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream file(out, std::ios::binary | std::ios::trunc);
+    file << json;
+  }
+
+  if (!baselinePath.empty()) {
+    std::ifstream file(baselinePath, std::ios::binary);
+    if (!file) {
+      std::cerr << "Failed to open " << baselinePath << std::endl;
+      return 2;
+    }
+    std::string baseline((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!compare(fromJson(baseline), results, threshold)) return 1;
+  }
+
+  return 0;
+}
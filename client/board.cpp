@@ -0,0 +1,335 @@
+#include "board.h"
+
+#include <algorithm>
+
+#include "movegen.h"
+
+using namespace bura;
+
+GameStatus bura::shownStatus(const StateSnapshot &snapshot, const LocalState &local) {
+  if (local.sent && local.sentVersion == snapshot.version) return GameStatus::WaitUpdate;
+  return snapshot.state.status;
+}
+
+void bura::syncCursor(LocalState &local, GameStatus status) {
+  if (!isOurTurn(status)) {
+    local.cardCursor = -1;
+  } else if (local.cardCursor == -1) {
+    local.cardCursor = 0;
+  }
+}
+
+void bura::moveCursor(LocalState &local, const GameState &state, int step) {
+  if (state.my_cards.empty()) return;
+
+  auto size = static_cast<int>(state.my_cards.size());
+  local.cardCursor = ((local.cardCursor + step) % size + size) % size;
+}
+
+void bura::toggleCard(LocalState &local, const GameState &state) {
+  if (local.cardCursor < 0 || static_cast<size_t>(local.cardCursor) >= state.my_cards.size()) return;
+  auto card = state.my_cards.at(local.cardCursor);
+  auto &selectedCards = local.selectedCards;
+
+  auto iterator = std::find_if(selectedCards.begin(), selectedCards.end(), [&](Card &el) { return el.suit == card.suit && el.value == card.value; });
+
+  if (iterator != selectedCards.end()) {
+    selectedCards.erase(iterator);
+  } else {
+    selectedCards.emplace_back(Card(card.suit, card.value));
+  }
+}
+
+const wchar_t *bura::checkMove(const LocalState &local) {
+  const auto &selectedCards = local.selectedCards;
+  if (selectedCards.empty()) return L"You need to choose the cards";
+
+  if (!MoveGen::sameRank(Card::mask(selectedCards))) return L"The cards must be of only one suit";
+
+  return nullptr;
+}
+
+const wchar_t *bura::checkDefence(const LocalState &local, const GameState &state) {
+  const auto &selectedCards = local.selectedCards;
+  if (selectedCards.empty()) return L"You need to choose the cards";
+
+  if (selectedCards.size() != state.attack_cards.size()) return L"You have to beat off all the opponent's cards";
+  if (!MoveGen::beats(selectedCards, state.attack_cards, state.trump.suit)) return L"You can't make such a move";
+
+  return nullptr;
+}
+
+void bura::showError(LocalState &local, const wchar_t *str, std::chrono::milliseconds timeout) {
+  local.errorText = str;
+  local.errorTextDuration = std::chrono::steady_clock::now() + timeout;
+}
+
+// BoardView
+
+std::wstring BoardView::getCardSuitAndValueStr(const Card &card) {
+  std::wstring result;
+  switch (card.value) {
+    case bura::CardValue::Six:
+      result += L"6";
+      break;
+    case bura::CardValue::Seven:
+      result += L"7";
+      break;
+    case bura::CardValue::Eight:
+      result += L"8";
+      break;
+    case bura::CardValue::Nine:
+      result += L"9";
+      break;
+    case bura::CardValue::Ten:
+      result += L"10";
+      break;
+    case bura::CardValue::Jack:
+      result += L"J";
+      break;
+    case bura::CardValue::Queen:
+      result += L"Q";
+      break;
+    case bura::CardValue::King:
+      result += L"K";
+      break;
+    case bura::CardValue::Ace:
+      result += L"A";
+      break;
+    case bura::CardValue::None:
+      break;
+  }
+
+  switch (card.suit) {
+    case bura::CardSuit::Hearts:
+      result += L"♥";
+      break;
+    case bura::CardSuit::Diamonds:
+      result += L"♦";
+      break;
+    case bura::CardSuit::Spades:
+      result += L"♠";
+      break;
+    case bura::CardSuit::Clubs:
+      result += L"♣";
+      break;
+    case bura::CardSuit::None:
+      break;
+  }
+
+  return result;
+}
+
+void BoardView::printCards(int x, int y, const std::vector<Card> &cards, bool activeMoveDown) {
+  auto width = 8;
+  if (cards.size() > 1) width += static_cast<int>(5 * (cards.size() - 1));
+
+  auto isPrevActive = false;
+
+  if (x == -1) {
+    x = (screen.getWidth() - width) / 2;
+  }
+
+  for (size_t i = 0; i < cards.size(); ++i) {
+    auto isActive = cards[i].selected;
+    int dy = isActive ? (activeMoveDown ? 2 : -2) : 0;
+
+    auto cardValue = getCardSuitAndValueStr(cards[i]);
+
+    auto fg = cards[i].active ? COLOR_ACTIVE_CARD_FG : COLOR_DEFAULT_FG;
+
+    if (i == 0) {
+      screen.printText(x, y + dy + 0, L"╔══════╗", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 1, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 2, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 3, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 4, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 5, L"╚══════╝", fg, COLOR_DEFAULT_BG);
+    } else if (isPrevActive == isActive) {
+      screen.printText(x, y + dy + 0, L"╦══════╗", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 1, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 2, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 3, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 4, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 5, L"╩══════╝", fg, COLOR_DEFAULT_BG);
+    } else if (isPrevActive != activeMoveDown) {
+      screen.printText(x, y + dy + 0, L"╔═╩════╗", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 1, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 2, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 3, L"╣      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 4, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 5, L"╚══════╝", fg, COLOR_DEFAULT_BG);
+    } else {
+      screen.printText(x, y + dy + 0, L"╔══════╗", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 1, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 2, L"╣      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 3, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 4, L"║      ║", fg, COLOR_DEFAULT_BG);
+      screen.printText(x, y + dy + 5, L"╚═╦════╝", fg, COLOR_DEFAULT_BG);
+    }
+
+    if (cards[i].hidden) {
+      screen.printText(x + 2, y + dy + 2, L"####", fg, COLOR_DEFAULT_BG);
+      screen.printText(x + 2, y + dy + 3, L"####", fg, COLOR_DEFAULT_BG);
+    } else {
+      auto color = cards[i].suit == bura::CardSuit::Hearts || cards[i].suit == bura::CardSuit::Diamonds ? COLOR_RED_SUIT_FG : fg;
+      screen.printText(x + 1, y + dy + 1, cardValue.c_str(), color, COLOR_DEFAULT_BG);
+      screen.printText(static_cast<int>(x + 7 - cardValue.size()), y + dy + 4, cardValue.c_str(), color, COLOR_DEFAULT_BG);
+    }
+
+    x += 5;
+    isPrevActive = isActive;
+  }
+}
+
+void BoardView::printCardsWithSpace(int x, int y, const std::vector<Card> &cards, int spaceSize, int reserve) {
+  auto width = 8;
+
+  if (reserve < 0 || cards.size() > static_cast<size_t>(reserve)) reserve = static_cast<int>(cards.size());
+
+  if (reserve > 1) width += (spaceSize + 8) * (reserve - 1);
+
+  if (x == -1) {
+    x = (screen.getWidth() - width) / 2;
+  }
+
+  for (const auto &card : cards) {
+    auto cardValue = getCardSuitAndValueStr(card);
+
+    screen.printText(x, y + 0, L"╔══════╗", 0, 0xFFFFFF);
+    screen.printText(x, y + 1, L"║      ║", 0, 0xFFFFFF);
+    screen.printText(x, y + 2, L"║      ║", 0, 0xFFFFFF);
+    screen.printText(x, y + 3, L"║      ║", 0, 0xFFFFFF);
+    screen.printText(x, y + 4, L"║      ║", 0, 0xFFFFFF);
+    screen.printText(x, y + 5, L"╚══════╝", 0, 0xFFFFFF);
+
+    if (card.hidden) {
+      screen.printText(x + 2, y + 2, L"####", 0, 0xFFFFFF);
+      screen.printText(x + 2, y + 3, L"####", 0, 0xFFFFFF);
+    } else {
+      auto color = card.suit == bura::CardSuit::Hearts || card.suit == bura::CardSuit::Diamonds ? COLOR_RED_SUIT_FG : 0;
+      screen.printText(x + 1, y + 1, cardValue.c_str(), color, 0xFFFFFF);
+      screen.printText(static_cast<int>(x + 7 - cardValue.size()), y + 4, cardValue.c_str(), color, 0xFFFFFF);
+    }
+
+    x += 8 + spaceSize;
+  }
+}
+
+void BoardView::draw(const StateSnapshot &snapshot, const LocalState &localState, bool isExit) {
+  auto cells = static_cast<size_t>(screen.getWidth() * screen.getHeight());
+  if (bgFill.size() != cells) bgFill.assign(cells, ' ');
+  screen.printText(0, 0, bgFill.c_str(), COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+
+  const auto &gameState = snapshot.state;
+  const auto status = shownStatus(snapshot, localState);
+
+  if (isExit) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, screen.getHeight() / 2 - 2, L"Exit...", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    return;
+  }
+
+  if (status == GameStatus::None) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, screen.getHeight() / 2 - 2, L"Loading...", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    return;
+  }
+
+  if (status == GameStatus::Connecting) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, screen.getHeight() / 2, L"Connecting...", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    return;
+  }
+
+  if (status == GameStatus::Idle) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, screen.getHeight() / 2, L"Wait opponent...", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    return;
+  }
+
+  if (status == GameStatus::Win) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, screen.getHeight() / 2, L"You WIN!!!", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    return;
+  }
+
+  if (status == GameStatus::Lose) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, screen.getHeight() / 2, L"You lose :(", 0xFF0000, COLOR_DEFAULT_BG);
+    return;
+  }
+
+  screen.printText(1, 0, L"ESC - Выход\nLeft/Right - Выбор карты\nSpace - Играть карту\nEnter - Завершить ход\nBackspace - Забрать карты",
+            COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+
+  std::vector<Card> heap;
+
+  if (gameState.inHeap > 0) {
+    heap.emplace_back(gameState.trump);
+  }
+
+  if (gameState.inHeap > 1) {
+    heap.emplace_back(Card(CardSuit::None, CardValue::None, true));
+  }
+
+  // Heap
+  printCards(screen.getWidth() - 14, (screen.getHeight() / 2) - 3, heap);
+
+  std::wstring inHeap = L"In Heap: " + std::to_wstring(gameState.inHeap);
+  std::wstring inFall = L"In Fall: " + std::to_wstring(gameState.inFall);
+
+  screen.printText(screen.getWidth() - 14, (screen.getHeight() / 2) + 3, inHeap.c_str(), COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+  screen.printText(screen.getWidth() - 14, (screen.getHeight() / 2) + 4, inFall.c_str(), COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+
+
+  screen.printTextAlignCenter(screen.getWidth() / 2, 1, gameState.opponentNickname.c_str(), COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+  printCards(-1, 2, gameState.opponent_cards);
+
+  myCards.clear();
+  int cursor = isOurTurn(status) ? std::max(localState.cardCursor, 0) : -1;
+  int i = 0;
+  for (const auto &item : gameState.my_cards) {
+    Card wrap = Card(item.suit, item.value);
+    wrap.selected = i == cursor;
+    wrap.active = std::any_of(localState.selectedCards.begin(), localState.selectedCards.end(),
+                              [&](const Card &card) { return card.suit == item.suit && card.value == item.value; });
+    myCards.emplace_back(wrap);
+    ++i;
+  }
+
+  printCards(-1, screen.getHeight() - 6, myCards);
+
+  if (status == GameStatus::MoveLog) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) - 10, L"Attack cards", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+
+    printCardsWithSpace(-1, (screen.getHeight() / 2) - 8, gameState.attack_cards, 2);
+
+    if (gameState.defend_cards.empty()) {
+      screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) + 1, L"Pass", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    } else {
+      screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) + 1, L"Defend cards", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+      printCardsWithSpace(-1, (screen.getHeight() / 2) + 3, gameState.defend_cards, 2);
+    }
+  }
+
+
+  if (status == GameStatus::OpponentMove) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) - 2, L"Opponent Move", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+  }
+
+  if (status == GameStatus::YourMove) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) - 2, L"Your Move", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    printCardsWithSpace(-1, (screen.getHeight() / 2) + 1, localState.selectedCards, 2);
+  }
+
+  if (status == GameStatus::YourDef) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) - 10, L"Attack cards", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    printCardsWithSpace(-1, (screen.getHeight() / 2) - 8, gameState.attack_cards, 2);
+    screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) + 1, L"Your defend move", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    printCardsWithSpace(-1, (screen.getHeight() / 2) + 3, localState.selectedCards, 2);
+  }
+
+  if (status == GameStatus::OpponentDef) {
+    screen.printTextAlignCenter(screen.getWidth() / 2, (screen.getHeight() / 2) - 2, L"Opponent Move", COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+    printCardsWithSpace(-1, (screen.getHeight() / 2) + 1, gameState.attack_cards, 2);
+  }
+
+  if (std::chrono::steady_clock::now() < localState.errorTextDuration) {
+    screen.printText(2, screen.getHeight() - 2, localState.errorText.c_str(), COLOR_DEFAULT_FG, COLOR_DEFAULT_BG);
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef CLIENT_BOARD_H
+#define CLIENT_BOARD_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "screen.h"
+
+// The game board shared by the front ends: layout and the rules of local input. The Windows console and the
+// terminal client only differ in how keys arrive, how requests go out and where frames are written.
+
+namespace bura {
+
+struct StateSnapshot {
+  uint64_t version{0};
+  GameState state;
+};
+
+// What the player is doing locally
+struct LocalState {
+  std::vector<Card> selectedCards;
+  int cardCursor{-1};
+  bool sent{false};  // a move was sent while sentVersion was the newest state: show WaitUpdate until the next one
+  uint64_t sentVersion{0};
+  std::wstring errorText;
+  std::chrono::time_point<std::chrono::steady_clock> errorTextDuration{};
+};
+
+inline bool isOurTurn(GameStatus status) { return status == GameStatus::YourDef || status == GameStatus::YourMove; }
+GameStatus shownStatus(const StateSnapshot &snapshot, const LocalState &local);
+
+// Puts the cursor onto the hand when a turn starts and removes it otherwise
+void syncCursor(LocalState &local, GameStatus status);
+void moveCursor(LocalState &local, const GameState &state, int step);
+void toggleCard(LocalState &local, const GameState &state);
+
+// Error text for a selection that must not be sent, nullptr if it is fine
+const wchar_t *checkMove(const LocalState &local);
+const wchar_t *checkDefence(const LocalState &local, const GameState &state);
+void showError(LocalState &local, const wchar_t *str, std::chrono::milliseconds timeout);
+
+class BoardView final {
+ private:
+  Screen &screen;
+  std::wstring bgFill;
+  std::vector<Card> myCards;
+
+ public:
+  explicit BoardView(Screen &screen) : screen(screen) {}
+
+  static std::wstring getCardSuitAndValueStr(const Card &card);
+  void printCards(int x, int y, const std::vector<Card> &cards, bool activeMoveDown = false);
+  void printCardsWithSpace(int x, int y, const std::vector<Card> &cards, int spaceSize, int reserve = -1);
+
+  void draw(const StateSnapshot &snapshot, const LocalState &localState, bool isExit);
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_BOARD_H
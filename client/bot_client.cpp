@@ -1,109 +1,274 @@
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <thread>
 
+#include "decision_cache.h"
+#include "evaluator.h"
 #include "game.h"
+#include "metrics.h"
+#include "movegen.h"
+#include "poll.h"
+#include "protocol.h"
+#include "record.h"
+#include "scheduler.h"
+#include "strategy.h"
+#include "tasks.h"
+#include "trace.h"
 
 using namespace bura;
 using std::wstring;
 
 
 class BuraBot {
+ public:
+  struct Decision {
+    enum struct Kind { None, Move, Defend, Pass } kind{Kind::None};
+    std::vector<Card> cards;
+  };
+
+  static Decision decide(const GameState &gameState) {
+    auto myCards = gameState.my_cards;
+    auto trump = gameState.trump;
+
+    if (gameState.status == GameStatus::YourMove && !myCards.empty()) {
+      std::sort(myCards.begin(), myCards.end(), [&](Card &a, Card &b) {
+        if (a.suit != trump.suit && b.suit == trump.suit) return true;
+        return a.value > b.value;
+      });
+
+      std::vector<Card> myMove;
+      myMove.emplace_back(myCards.front());
+
+      std::all_of(myCards.begin() + 1, myCards.end(), [&](Card &item) {
+        if (item.value != myMove.front().value) return false;
+        myMove.emplace_back(item);
+        return true;
+      });
+
+      return {Decision::Kind::Move, myMove};
+    }
+    // Beat everything if at all possible, spending as few trumps and as low ranks as it can
+    if (gameState.status == GameStatus::YourDef) {
+      Move defence;
+      if (!MoveGen::cheapestDefence(gameState, defence)) return {Decision::Kind::Pass, {}};
+      return {Decision::Kind::Defend, defence.toCards()};
+    }
+
+    return {};
+  }
+
+  // The greedy decision above as a BuraClient::play strategy, or with evaluator weights the legal move whose
+  // successor scores best
+  struct Strategy {
+    std::shared_ptr<const EvalWeights> weights;
+    EvalBatch batch;
+    MoveList moves;
+    std::vector<float> scores;
+
+    Decision evaluate(const GameState &state) {
+      moves.clear();
+      MoveGen::generate(state, moves);
+      if (state.status == GameStatus::YourDef) moves.emplace_back();  // the pass
+      if (moves.empty()) return {};
+
+      batch.clear();
+      batch.addSuccessors(state, moves);
+      scores.resize(moves.size());
+      batch.score(*weights, scores.data());
+      const auto &best = moves[static_cast<size_t>(std::max_element(scores.begin(), scores.end()) - scores.begin())];
+
+      if (state.status == GameStatus::YourMove) return {Decision::Kind::Move, best.toCards()};
+      if (best.cards == 0) return {Decision::Kind::Pass, {}};
+      return {Decision::Kind::Defend, best.toCards()};
+    }
+    Decision choose(const GameState &state) {
+      TRACE_SCOPE("BuraBot::decide");
+      return weights ? evaluate(state) : decide(state);
+    }
+
+    void onStart(const GameState &) {}
+    void onMove(const GameState &state, std::vector<Card> &yourMove) {
+      auto decision = choose(state);
+      if (decision.kind == Decision::Kind::Move) yourMove = std::move(decision.cards);
+    }
+    bool onDefend(const GameState &state, std::vector<Card> &yourDefence) {
+      auto decision = choose(state);
+      yourDefence = std::move(decision.cards);
+      return decision.kind == Decision::Kind::Defend;
+    }
+    void onEnd(const GameState &) {}
+  };
+
  private:
   std::unique_ptr<std::thread> gameThread;
-  bool isExit = false;
+  std::atomic<bool> isExit{false};
 
   // Game
   std::string ip;
   std::string port;
+  http::TransportKind transport;
 
   BuraClient gameClient;
-  GameState gameState;
+  std::shared_ptr<PollScheduler> pollScheduler;
+  std::shared_ptr<DecisionCache> decisionCache;
+  std::shared_ptr<const EvalWeights> weights;
 
   void game() {
-    gameClient.start(ip);
+    trace::setThreadName("BuraBot::game");
+    gameClient.start(ip, port, transport);
     gameClient.connect("Bot");
 
-    while (!isExit) {
-      try {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-        gameState = gameClient.fetch();
+    PollTimer poll(pollScheduler ? pollScheduler : std::make_shared<PollScheduler>());
+    Strategy strategy;
+    strategy.weights = weights;
+    CachedStrategy<Strategy> cached(strategy, decisionCache);
+    auto &bots = metrics::ClientMetrics::get().bots;
+    bots.add();
+    gameClient.play(cached, poll, isExit);
+    bots.sub();
+    isExit = true;
+  }
 
 
-        auto attackCards = gameState.attack_cards;
-        std::vector<Card> attackCardsSort = attackCards;
-        auto myCards = gameState.my_cards;
-        auto trump = gameState.trump;
+ public:
+  BuraBot(std::string ip, std::string port, http::TransportKind transport = http::TransportKind::Http)
+      : ip(std::move(ip)), port(std::move(port)), transport(transport) {}
 
 
-        if (!attackCardsSort.empty()) {
-          std::sort(attackCardsSort.begin(), attackCardsSort.end(), [&](Card &a, Card &b) {
-            if (a.suit == trump.suit && b.suit != trump.suit) return true;
-            return a.value < b.value;
-          });
-        }
+  void setRecorder(std::shared_ptr<record::GameRecorder> recorder) { gameClient.setRecorder(std::move(recorder)); }
+  void setScheduler(std::shared_ptr<FetchScheduler> scheduler) { gameClient.setScheduler(std::move(scheduler)); }
+  void setPollScheduler(std::shared_ptr<PollScheduler> scheduler) { pollScheduler = std::move(scheduler); }
+  void setDecisionCache(std::shared_ptr<DecisionCache> cache) { decisionCache = std::move(cache); }
+  // Decide by the evaluator with these weights instead of greedily
+  void setWeights(std::shared_ptr<const EvalWeights> evalWeights) { weights = std::move(evalWeights); }
 
-        if (gameState.status == GameStatus::YourMove) {
-          std::sort(myCards.begin(), myCards.end(), [&](Card &a, Card &b) {
-            if (a.suit != trump.suit && b.suit == trump.suit) return true;
-            return a.value > b.value;
-          });
+  void launch() { gameThread = std::make_unique<std::thread>(&BuraBot::game, this); }
+
+  void exit() { isExit = true; }
 
-          std::vector<Card> myMove;
-          myMove.emplace_back(myCards.front());
+  void join() { gameThread->join(); }
+};
 
-          std::all_of(myCards.begin() + 1, myCards.end(), [&](Card &item) {
-            if (item.value != myMove.front().value) return false;
-            myMove.emplace_back(item);
-            return true;
-          });
+// BuraBot as a TaskPool task for bot farms: the same strategy, but every wait returns to the pool instead of
+// blocking a thread, and all I/O goes through the FetchScheduler.
+class BuraBotTask final : public Task {
+ private:
+  enum struct Stage : uint8_t { Connect, Connected, Poll, Fetch, Fetched, Acted };
 
-          gameClient.finishMove(myMove);
-        }
-        if (gameState.status == GameStatus::YourDef) {
-          if (attackCards.size() > myCards.size()) {
-            gameClient.passDef();
-            return;
-          }
+  TaskPool &pool;
+  std::shared_ptr<FetchScheduler> scheduler;
+  PollTimer poll;
+  BuraBot::Strategy strategy;
+  CachedStrategy<BuraBot::Strategy> cached;
+  StrategyDriver<CachedStrategy<BuraBot::Strategy>> driver{cached};
 
-          std::sort(myCards.begin(), myCards.end(), [&](Card &a, Card &b) {
-            if (a.suit != trump.suit && b.suit == trump.suit) return true;
-            return a.value > b.value;
-          });
+  GameState state;
+  Stage stage{Stage::Connect};
+  FetchResult result;  // written by the scheduler thread before it wakes the task
 
-          for (const auto &item : attackCardsSort) {
-            auto it = std::find_if(myCards.begin(), myCards.end(), [&](Card &mCard) { return Card::canUseCard(mCard, item, trump.suit); });
+  TaskStep submit(uint16_t code, std::vector<uint8_t> payload) {
+    scheduler->call(code, std::move(payload), [this](FetchResult reply) {
+      result = std::move(reply);
+      pool.wake(this);
+    });
+    return TaskStep::wait();
+  }
 
-            if (it != myCards.end()) {
-              auto rit = std::find_if(attackCards.begin(), attackCards.end(),
-                                      [&](Card &card) { return card.suit == item.suit && card.value == item.value; });
+  bool failed() {
+    if (!result.error) return false;
 
-              (*rit) = (*it);
-              myCards.erase(it);
-            } else {
-              gameClient.passDef();
-              return;
-            }
-          }
-          gameClient.finishDef(attackCards);
-        }
-        if (gameState.status == GameStatus::Lose || gameState.status == GameStatus::Win) {
-          isExit = true;
-        }
-      } catch (std::exception &err) {
-        std::cout << err.what() << std::endl;
-      }
+    try {
+      std::rethrow_exception(result.error);
+    } catch (std::exception &err) {
+      BuraClient::countError(err);
+      std::cout << err.what() << std::endl;
     }
+    poll.failed();
+    return true;
   }
 
-
  public:
-  BuraBot(std::string ip, std::string port) : ip(std::move(ip)), port(std::move(port)) {}
+  BuraBotTask(TaskPool &pool, std::shared_ptr<FetchScheduler> scheduler, std::shared_ptr<PollScheduler> pollScheduler,
+              std::shared_ptr<DecisionCache> decisionCache = nullptr, std::shared_ptr<const EvalWeights> weights = nullptr)
+      : pool(pool), scheduler(std::move(scheduler)), poll(std::move(pollScheduler)), cached(strategy, std::move(decisionCache)) {
+    strategy.weights = std::move(weights);
+    metrics::ClientMetrics::get().bots.add();
+  }
+  ~BuraBotTask() override { metrics::ClientMetrics::get().bots.sub(); }
+
+  TaskStep resume() override {
+    switch (stage) {
+      case Stage::Connect: {
+        state.id = generateRandomString(8);
+        stage = Stage::Connected;
+        return submit(2, proto::ConnectRequest::encode(proto::Connect{state.id, "Bot"}));
+      }
+      case Stage::Connected:
+        stage = failed() ? Stage::Connect : Stage::Poll;
+        return TaskStep::sleep(poll.due());
+      case Stage::Poll: {
+        stage = Stage::Fetch;
+        auto delay = poll.begin();
+        if (delay > TaskClock::duration::zero()) return TaskStep::sleep(TaskClock::now() + delay);
+      }
+        [[fallthrough]];
+      case Stage::Fetch:
+        stage = Stage::Fetched;
+        scheduler->fetch(state.id, [this](FetchResult reply) {
+          result = std::move(reply);
+          pool.wake(this);
+        });
+        return TaskStep::wait();
+      case Stage::Fetched: {
+        stage = Stage::Poll;
+        if (failed()) return TaskStep::sleep(poll.due());
 
+        if (result.status == 0) {
+          TRACE_SCOPE("decode");
+          if (!BuraClient::decodeState(result.data.data(), result.data.size(), state)) {
+            metrics::ClientMetrics::get().protocolErrors.add();
+            poll.failed();
+            return TaskStep::sleep(poll.due());
+          }
+        }
+        poll.observe(state);
 
-  void launch() { gameThread = std::make_unique<std::thread>(&BuraBot::game, this); }
+        auto action = driver.next(state);
+        std::vector<uint8_t> payload;
 
-  void exit() { isExit = true; }
+        switch (action.kind) {
+          case Action::Kind::None:
+            return TaskStep::sleep(poll.due());
+          case Action::Kind::End:
+            return TaskStep::done();
+          case Action::Kind::Move:
+            proto::MoveRequest::encode(proto::Move{state.id, std::move(action.cards)}, payload);
+            break;
+          case Action::Kind::Defend:
+            proto::DefendRequest::encode(proto::Defend{state.id, 1, std::move(action.cards)}, payload);
+            break;
+          case Action::Kind::Pass:
+            proto::PassRequest::encode(proto::Pass{state.id}, payload);
+            break;
+        }
+
+        stage = Stage::Acted;
+        return submit(action.kind == Action::Kind::Move ? 4 : 5, std::move(payload));
+      }
+      case Stage::Acted:
+        driver.sent();
+        if (!failed()) {
+          if (result.status == 0)
+            poll.nudge();
+          else
+            metrics::ClientMetrics::get().rejected.add();
+        }
+        stage = Stage::Poll;
+        return TaskStep::sleep(poll.due());
+    }
+
+    return TaskStep::done();
+  }
+};
 
-  void join() { gameThread->join(); }
-};
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "decision_cache.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace bura;
+
+namespace {
+
+constexpr CardMask kSuitBits = (CardMask{1} << kValueCount) - 1;
+
+uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+uint32_t suitBits(CardMask mask, uint8_t suit) { return static_cast<uint32_t>((mask >> (suit * kValueCount)) & kSuitBits); }
+
+}  // namespace
+
+uint64_t StateKey::hash() const {
+  uint64_t packed = 0;
+  for (auto card : attack) packed = packed << 8 | card;
+  packed = packed << 8 | static_cast<uint8_t>(status);
+  packed = packed << 8 | trump;
+  packed = packed << 8 | opponentCards;
+  packed = packed << 8 | inHeap;
+  // Collisions only cost a compare, the table checks the whole key
+  return mix(hand ^ mix(packed ^ static_cast<uint64_t>(inFall) << 56));
+}
+
+CanonicalState CanonicalState::of(const GameState &state) {
+  CanonicalState result;
+  if (state.attack_cards.size() > kSuitCount) return result;
+
+  // What the hand holds of every suit, and where the suit plays in the attack (all attack cards share a rank)
+  CardMask hand = 0;
+  for (const auto &card : state.my_cards) {
+    if (card.index() == kNoCard) return result;
+    hand |= card.mask();
+  }
+  std::array<uint32_t, kSuitCount> signature{};
+  for (uint8_t suit = 0; suit < kSuitCount; ++suit) signature[suit] = suitBits(hand, suit);
+  for (size_t i = 0; i < state.attack_cards.size(); ++i) {
+    auto card = state.attack_cards[i].index();
+    if (card == kNoCard) return result;
+    signature[card / kValueCount] |= static_cast<uint32_t>(kSuitCount - i) << kValueCount;
+  }
+
+  // The trump first, then the other suits by their signature, so the same pattern under other suit names sorts
+  // the same way; suits that still tie are interchangeable
+  const auto trumpSuit = static_cast<uint8_t>(state.trump.suit);
+  std::array<uint8_t, kSuitCount> order{0, 1, 2, 3};
+  std::sort(order.begin(), order.end(), [&](uint8_t a, uint8_t b) {
+    if ((a == trumpSuit) != (b == trumpSuit)) return a == trumpSuit;
+    return signature[a] != signature[b] ? signature[a] > signature[b] : a < b;
+  });
+  for (uint8_t i = 0; i < kSuitCount; ++i) result.suits[order[i]] = i;
+
+  auto &key = result.key;
+  for (uint8_t suit = 0; suit < kSuitCount; ++suit) key.hand |= CardMask{suitBits(hand, suit)} << (result.suits[suit] * kValueCount);
+  for (size_t i = 0; i < state.attack_cards.size(); ++i) key.attack[i] = result.toCanonical(state.attack_cards[i].index());
+  key.status = state.status;
+  key.trump = trumpSuit < kSuitCount ? 1 : 0;
+  key.inHeap = state.inHeap;
+  key.inFall = state.inFall;
+  key.opponentCards = static_cast<uint8_t>(state.opponent_cards.size());
+
+  result.hash = key.hash();
+  result.cacheable = true;
+  return result;
+}
+
+uint8_t CanonicalState::toCanonical(uint8_t card) const {
+  if (card >= kDeckSize) return kNoCard;
+  return static_cast<uint8_t>(suits[card / kValueCount] * kValueCount + card % kValueCount);
+}
+
+uint8_t CanonicalState::fromCanonical(uint8_t card) const {
+  if (card >= kDeckSize) return kNoCard;
+  auto suit = static_cast<uint8_t>(std::find(suits.begin(), suits.end(), card / kValueCount) - suits.begin());
+  return static_cast<uint8_t>(suit * kValueCount + card % kValueCount);
+}
+
+bool CachedDecision::of(Kind kind, const std::vector<Card> &cards, const CanonicalState &state, CachedDecision &decision) {
+  if (cards.size() > kSuitCount) return false;
+
+  decision.kind = kind;
+  decision.count = static_cast<uint8_t>(cards.size());
+  for (size_t i = 0; i < cards.size(); ++i) {
+    decision.cards[i] = state.toCanonical(cards[i].index());
+    if (decision.cards[i] == kNoCard) return false;
+  }
+  return true;
+}
+
+std::vector<Card> CachedDecision::toCards(const CanonicalState &state) const {
+  std::vector<Card> result;
+  result.reserve(count);
+  for (uint8_t i = 0; i < count; ++i) result.push_back(Card::fromIndex(state.fromCanonical(cards[i])));
+  return result;
+}
+
+// DecisionCache
+
+DecisionCache::DecisionCache(size_t capacity, size_t shards)
+    : shards(std::make_unique<Shard[]>(std::max<size_t>(shards, 1))),
+      shardCount(std::max<size_t>(shards, 1)),
+      shardCapacity(std::max<size_t>(capacity / std::max<size_t>(shards, 1), 1)) {}
+
+bool DecisionCache::find(const CanonicalState &state, CachedDecision &decision) {
+  auto &table = shard(state.hash);
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  auto found = table.index.find(state.key);
+  if (found == table.index.end()) {
+    ++table.misses;
+    return false;
+  }
+
+  ++table.hits;
+  table.entries.splice(table.entries.begin(), table.entries, found->second);
+  decision = found->second->decision;
+  return true;
+}
+
+void DecisionCache::insert(const CanonicalState &state, const CachedDecision &decision) {
+  auto &table = shard(state.hash);
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  auto found = table.index.find(state.key);
+  if (found != table.index.end()) {
+    // Another bot got there first
+    found->second->decision = decision;
+    table.entries.splice(table.entries.begin(), table.entries, found->second);
+    return;
+  }
+
+  if (table.entries.size() >= shardCapacity) {
+    table.index.erase(table.entries.back().key);
+    table.entries.pop_back();
+    ++table.evictions;
+  }
+  table.entries.push_front(Entry{state.key, decision});
+  table.index.emplace(state.key, table.entries.begin());
+}
+
+DecisionCacheStats DecisionCache::stats() {
+  DecisionCacheStats result;
+  for (size_t i = 0; i < shardCount; ++i) {
+    std::lock_guard<std::mutex> lock(shards[i].mutex);
+    result.hits += shards[i].hits;
+    result.misses += shards[i].misses;
+    result.evictions += shards[i].evictions;
+    result.size += shards[i].entries.size();
+  }
+  return result;
+}
+
+std::string DecisionCache::report() {
+  auto current = stats();
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1) << "decision cache: hits " << current.hits << ", misses " << current.misses << " ("
+     << current.hitRate() * 100.0 << "% hit), evictions " << current.evictions << ", entries " << current.size;
+  return ss.str();
+}
@@ -0,0 +1,159 @@
+#ifndef CLIENT_DECISION_CACHE_H
+#define CLIENT_DECISION_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+
+// Strategy decisions remembered by game state, shared by every bot of a process.
+// States are canonicalized first: the trump becomes suit 0 and the other suits are ordered by what the hand and
+// the attack hold of them, so positions that differ only in suit names share one entry. That is only right for
+// strategies that play by rank and trumpness, not by the name of a suit.
+
+namespace bura {
+
+// Everything a decision may depend on, with the suits relabelled
+struct StateKey {
+  CardMask hand{0};
+  std::array<uint8_t, kSuitCount> attack{kNoCard, kNoCard, kNoCard, kNoCard};  // in play order
+  GameStatus status{GameStatus::None};
+  uint8_t trump{0};  // 1 if there is a trump, which is then suit 0
+  uint8_t inHeap{0};
+  uint8_t inFall{0};
+  uint8_t opponentCards{0};
+
+  bool operator==(const StateKey &other) const {
+    return hand == other.hand && attack == other.attack && status == other.status && trump == other.trump && inHeap == other.inHeap &&
+           inFall == other.inFall && opponentCards == other.opponentCards;
+  }
+  [[nodiscard]] uint64_t hash() const;
+};
+
+struct StateKeyHash {
+  size_t operator()(const StateKey &key) const { return static_cast<size_t>(key.hash()); }
+};
+
+struct CanonicalState {
+  StateKey key;
+  uint64_t hash{0};
+  std::array<uint8_t, kSuitCount> suits{0, 1, 2, 3};  // the canonical suit of every real one
+  bool cacheable{false};  // false for states with unknown cards or more attack cards than a rank has
+
+  static CanonicalState of(const GameState &state);
+
+  [[nodiscard]] uint8_t toCanonical(uint8_t card) const;
+  [[nodiscard]] uint8_t fromCanonical(uint8_t card) const;
+};
+
+// A decision in canonical cards, in the order the strategy gave them
+struct CachedDecision {
+  enum struct Kind : uint8_t { Move, Defend, Pass } kind{Kind::Pass};
+  uint8_t count{0};
+  std::array<uint8_t, kSuitCount> cards{};
+
+  // False if the cards do not fit, e.g. a move of more cards than a rank has
+  static bool of(Kind kind, const std::vector<Card> &cards, const CanonicalState &state, CachedDecision &decision);
+  [[nodiscard]] std::vector<Card> toCards(const CanonicalState &state) const;
+};
+
+struct DecisionCacheStats {
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t evictions{0};
+  size_t size{0};
+
+  [[nodiscard]] double hitRate() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses); }
+};
+
+// LRU over `capacity` entries, split into shards by hash so bots on different threads rarely share a mutex
+class DecisionCache final {
+ private:
+  struct Entry {
+    StateKey key;
+    CachedDecision decision;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::list<Entry> entries;  // most recently used first
+    std::unordered_map<StateKey, std::list<Entry>::iterator, StateKeyHash> index;
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t evictions{0};
+  };
+
+  std::unique_ptr<Shard[]> shards;
+  size_t shardCount;
+  size_t shardCapacity;
+
+  // The high bits, as the shard's own table uses the low ones
+  Shard &shard(uint64_t hash) { return shards[(hash >> 32) % shardCount]; }
+
+ public:
+  explicit DecisionCache(size_t capacity = 65536, size_t shards = 64);
+
+  bool find(const CanonicalState &state, CachedDecision &decision);
+  void insert(const CanonicalState &state, const CachedDecision &decision);
+
+  DecisionCacheStats stats();
+  std::string report();
+};
+
+// A strategy with the cache in front of its onMove and onDefend; without a cache it only forwards
+template <typename Strategy>
+class CachedStrategy final {
+ private:
+  Strategy &strategy;
+  std::shared_ptr<DecisionCache> cache;
+
+ public:
+  CachedStrategy(Strategy &strategy, std::shared_ptr<DecisionCache> cache) : strategy(strategy), cache(std::move(cache)) {}
+
+  void onStart(const GameState &state) { strategy.onStart(state); }
+
+  void onMove(const GameState &state, std::vector<Card> &yourMove) {
+    if (!cache) return strategy.onMove(state, yourMove);
+
+    auto canonical = CanonicalState::of(state);
+    CachedDecision decision;
+    if (canonical.cacheable && cache->find(canonical, decision)) {
+      yourMove = decision.toCards(canonical);
+      return;
+    }
+
+    strategy.onMove(state, yourMove);
+    // An empty move is asked again on the next poll, nothing to remember
+    if (canonical.cacheable && !yourMove.empty() && CachedDecision::of(CachedDecision::Kind::Move, yourMove, canonical, decision))
+      cache->insert(canonical, decision);
+  }
+
+  bool onDefend(const GameState &state, std::vector<Card> &yourDefence) {
+    if (!cache) return strategy.onDefend(state, yourDefence);
+
+    auto canonical = CanonicalState::of(state);
+    CachedDecision decision;
+    if (canonical.cacheable && cache->find(canonical, decision)) {
+      yourDefence = decision.toCards(canonical);
+      return decision.kind == CachedDecision::Kind::Defend;
+    }
+
+    auto defend = strategy.onDefend(state, yourDefence);
+    auto kind = defend ? CachedDecision::Kind::Defend : CachedDecision::Kind::Pass;
+    if (canonical.cacheable && CachedDecision::of(kind, defend ? yourDefence : std::vector<Card>{}, canonical, decision)) cache->insert(canonical, decision);
+    return defend;
+  }
+
+  void onEnd(const GameState &state) { strategy.onEnd(state); }
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_DECISION_CACHE_H
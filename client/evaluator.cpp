@@ -0,0 +1,366 @@
+#include "evaluator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BURA_EVAL_AVX2
+#endif
+
+using namespace bura;
+
+namespace {
+
+constexpr CardMask kSuitBits = (CardMask{1} << kValueCount) - 1;
+
+#pragma pack(push, 1)
+struct EvalWeightsHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t width;
+};
+#pragma pack(pop)
+
+// Length, rank-weighted strength and the ranks one nibble each, of every set of cards of one suit: adding the
+// nibbles of all four suits counts the cards of every rank at once. `spread` is the same for the eight highest
+// ranks only, as 32 bits is what an AVX2 lane holds.
+struct SuitTables {
+  std::array<uint32_t, 1 << kValueCount> length{};
+  std::array<float, 1 << kValueCount> strength{};
+  std::array<uint64_t, 1 << kValueCount> nibbles{};
+  std::array<uint32_t, 1 << 8> spread{};
+
+  constexpr SuitTables() {
+    for (size_t cards = 0; cards < length.size(); ++cards) {
+      for (int value = 0; value < kValueCount; ++value) {
+        if ((cards >> value & 1) == 0) continue;
+        ++length[cards];
+        strength[cards] += static_cast<float>(kValueCount - value) / kValueCount;
+        nibbles[cards] |= uint64_t{1} << (4 * value);
+      }
+      if (cards < spread.size()) spread[cards] = static_cast<uint32_t>(nibbles[cards]);
+    }
+  }
+};
+
+constexpr SuitTables kSuit{};
+
+constexpr std::array<float, kEvalWidth> defaultWeights() {
+  std::array<float, kEvalWidth> weights{};
+  // The one who empties the hand first wins: every card held is a cost, strong cards and trumps less so
+  weights[kEvalHandCards] = -1.0f;
+  weights[kEvalTrumps] = 0.4f;
+  weights[kEvalTrumpStrength] = 0.3f;
+  weights[kEvalPlainStrength] = 0.15f;
+  weights[kEvalGroups] = 0.25f;
+  weights[kEvalTableCards] = 0.5f;
+  weights[kEvalTableTrumps] = 0.3f;
+  weights[kEvalTableStrength] = 0.2f;
+  weights[kEvalOpponentCards] = 0.8f;
+  weights[kEvalEndgameCards] = -0.5f;
+  return weights;
+}
+
+// Writes the features of one position into column `lane` of a tile of kLanes columns
+inline __attribute__((always_inline)) void extract(const EvalPosition &position, float *tile, size_t lane) {
+  const auto column = [&](size_t feature) -> float & { return tile[feature * EvalBatch::kLanes + lane]; };
+
+  std::array<uint32_t, kSuitCount> suits{}, table{};
+  for (uint8_t suit = 0; suit < kSuitCount; ++suit) {
+    suits[suit] = static_cast<uint32_t>(position.hand >> (suit * kValueCount) & kSuitBits);
+    table[suit] = static_cast<uint32_t>(position.table >> (suit * kValueCount) & kSuitBits);
+  }
+
+  const bool hasTrump = position.trumpSuit < kSuitCount;
+  const auto trumps = hasTrump ? suits[position.trumpSuit] : 0;
+  const auto tableTrumps = hasTrump ? table[position.trumpSuit] : 0;
+
+  uint32_t handCards = 0, tableCards = 0;
+  float strength = 0, tableStrength = 0;
+  uint64_t ranks = 0;
+  std::array<uint32_t, kSuitCount> plain{};
+  for (uint8_t suit = 0; suit < kSuitCount; ++suit) {
+    handCards += kSuit.length[suits[suit]];
+    tableCards += kSuit.length[table[suit]];
+    strength += kSuit.strength[suits[suit]];
+    tableStrength += kSuit.strength[table[suit]];
+    ranks += kSuit.nibbles[suits[suit]];
+    plain[suit] = suit == position.trumpSuit ? 0 : kSuit.length[suits[suit]];
+  }
+
+  float groups = 0;
+  for (int value = 0; value < kValueCount; ++value) {
+    const auto count = static_cast<uint32_t>(ranks >> (4 * value) & 0xF);
+    column(kEvalRanks + value) = static_cast<float>(count);
+    groups += count >= 2 ? 1.0f : 0.0f;
+  }
+
+  // Longest first, the trump counted as empty: the three other suits, or the longest three without a trump
+  const auto order = [&](size_t a, size_t b) {
+    const auto high = std::max(plain[a], plain[b]);
+    plain[b] = std::min(plain[a], plain[b]);
+    plain[a] = high;
+  };
+  order(0, 1);
+  order(2, 3);
+  order(0, 2);
+  order(1, 3);
+  order(1, 2);
+
+  const float heapEmpty = position.inHeap == 0 ? 1.0f : 0.0f;
+  column(kEvalBias) = 1.0f;
+  column(kEvalHandCards) = static_cast<float>(handCards);
+  column(kEvalTrumps) = static_cast<float>(kSuit.length[trumps]);
+  column(kEvalTrumpStrength) = kSuit.strength[trumps];
+  column(kEvalPlainStrength) = strength - kSuit.strength[trumps];
+  column(kEvalLongSuit) = static_cast<float>(plain[0]);
+  column(kEvalMiddleSuit) = static_cast<float>(plain[1]);
+  column(kEvalShortSuit) = static_cast<float>(plain[2]);
+  column(kEvalGroups) = groups;
+  column(kEvalTableCards) = static_cast<float>(tableCards);
+  column(kEvalTableTrumps) = static_cast<float>(kSuit.length[tableTrumps]);
+  column(kEvalTableStrength) = tableStrength;
+  column(kEvalHeap) = static_cast<float>(position.inHeap) / kDeckSize;
+  column(kEvalFall) = static_cast<float>(position.inFall) / kDeckSize;
+  column(kEvalOpponentCards) = position.opponentCards;
+  column(kEvalHeapEmpty) = heapEmpty;
+  column(kEvalEndgameCards) = heapEmpty * static_cast<float>(handCards);
+}
+
+void scoreScalar(const EvalPosition *positions, size_t count, const float *weights, float *scores) {
+  alignas(32) std::array<float, kEvalWidth * EvalBatch::kLanes> tile{};
+
+  for (size_t base = 0; base < count; base += EvalBatch::kLanes) {
+    const auto lanes = std::min(EvalBatch::kLanes, count - base);
+    for (size_t lane = 0; lane < lanes; ++lane) extract(positions[base + lane], tile.data(), lane);
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      float sum = 0;
+      for (size_t feature = 0; feature < kEvalFeatureCount; ++feature) sum += weights[feature] * tile[feature * EvalBatch::kLanes + lane];
+      scores[base + lane] = sum;
+    }
+  }
+}
+
+#ifdef BURA_EVAL_AVX2
+// The features of a whole block at once, from table gathers, then the dot products
+__attribute__((target("avx2,fma"))) void scoreAvx2(const EvalBatch::Block *blocks, size_t count, const float *weights, float *scores) {
+  const auto *lengths = reinterpret_cast<const int *>(kSuit.length.data());
+  const auto *spreads = reinterpret_cast<const int *>(kSuit.spread.data());
+  const auto one = _mm256_set1_epi32(1);
+  const auto lowRanks = _mm256_set1_epi32(0xFF);
+  __m256 features[kEvalFeatureCount];
+  alignas(32) std::array<float, EvalBatch::kLanes> tail{};
+
+  for (size_t base = 0; base < count; base += EvalBatch::kLanes) {
+    const auto &block = blocks[base / EvalBatch::kLanes];
+
+    const auto trumps = _mm256_load_si256(reinterpret_cast<const __m256i *>(block.trumps.data()));
+    auto handCards = _mm256_i32gather_epi32(lengths, trumps, 4);
+    auto plainStrength = _mm256_setzero_ps();
+    auto spread = _mm256_i32gather_epi32(spreads, _mm256_and_si256(trumps, lowRanks), 4);
+    auto sixes = _mm256_srli_epi32(trumps, 8);
+    __m256i plain[kSuitCount];
+    for (size_t suit = 0; suit < kSuitCount; ++suit) {
+      const auto cards = _mm256_load_si256(reinterpret_cast<const __m256i *>(block.plain[suit].data()));
+      plain[suit] = _mm256_i32gather_epi32(lengths, cards, 4);
+      handCards = _mm256_add_epi32(handCards, plain[suit]);
+      plainStrength = _mm256_add_ps(plainStrength, _mm256_i32gather_ps(kSuit.strength.data(), cards, 4));
+      spread = _mm256_add_epi32(spread, _mm256_i32gather_epi32(spreads, _mm256_and_si256(cards, lowRanks), 4));
+      sixes = _mm256_add_epi32(sixes, _mm256_srli_epi32(cards, 8));
+    }
+
+    auto groups = _mm256_setzero_si256();
+    for (int value = 0; value < kValueCount; ++value) {
+      const auto count = value + 1 < kValueCount ? _mm256_and_si256(_mm256_srlv_epi32(spread, _mm256_set1_epi32(4 * value)), _mm256_set1_epi32(0xF)) : sixes;
+      features[kEvalRanks + value] = _mm256_cvtepi32_ps(count);
+      groups = _mm256_sub_epi32(groups, _mm256_cmpgt_epi32(count, one));
+    }
+
+    // Plain suit lengths longest first, as extract() sorts them
+    const auto order = [](__m256i &high, __m256i &low) __attribute__((target("avx2"))) {
+      const auto max = _mm256_max_epi32(high, low);
+      low = _mm256_min_epi32(high, low);
+      high = max;
+    };
+    order(plain[0], plain[1]);
+    order(plain[2], plain[3]);
+    order(plain[0], plain[2]);
+    order(plain[1], plain[3]);
+    order(plain[1], plain[2]);
+
+    const auto hand = _mm256_cvtepi32_ps(handCards);
+    const auto heapEmpty = _mm256_load_ps(block.heapEmpty.data());
+    features[kEvalBias] = _mm256_set1_ps(1.0f);
+    features[kEvalHandCards] = hand;
+    features[kEvalTrumps] = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(lengths, trumps, 4));
+    features[kEvalTrumpStrength] = _mm256_i32gather_ps(kSuit.strength.data(), trumps, 4);
+    features[kEvalPlainStrength] = plainStrength;
+    features[kEvalLongSuit] = _mm256_cvtepi32_ps(plain[0]);
+    features[kEvalMiddleSuit] = _mm256_cvtepi32_ps(plain[1]);
+    features[kEvalShortSuit] = _mm256_cvtepi32_ps(plain[2]);
+    features[kEvalGroups] = _mm256_cvtepi32_ps(groups);
+    features[kEvalTableCards] = _mm256_load_ps(block.tableCards.data());
+    features[kEvalTableTrumps] = _mm256_load_ps(block.tableTrumps.data());
+    features[kEvalTableStrength] = _mm256_load_ps(block.tableStrength.data());
+    features[kEvalHeap] = _mm256_load_ps(block.heap.data());
+    features[kEvalFall] = _mm256_load_ps(block.fall.data());
+    features[kEvalOpponentCards] = _mm256_load_ps(block.opponentCards.data());
+    features[kEvalHeapEmpty] = heapEmpty;
+    features[kEvalEndgameCards] = _mm256_mul_ps(heapEmpty, hand);
+
+    auto sum = _mm256_setzero_ps();
+    for (size_t feature = 0; feature < kEvalFeatureCount; ++feature) sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[feature]), features[feature], sum);
+
+    // Lanes past the end are empty positions; their scores are dropped
+    const auto lanes = std::min(EvalBatch::kLanes, count - base);
+    if (lanes == EvalBatch::kLanes) {
+      _mm256_storeu_ps(scores + base, sum);
+    } else {
+      _mm256_store_ps(tail.data(), sum);
+      std::copy(tail.begin(), tail.begin() + lanes, scores + base);
+    }
+  }
+}
+#endif
+
+}  // namespace
+
+// EvalWeights
+
+EvalWeights::EvalWeights() : owned(defaultWeights()) {}
+
+EvalWeights::EvalWeights(const std::array<float, kEvalWidth> &values) : owned(values) {}
+
+EvalWeights::EvalWeights(const std::string &path) : file(path) {
+  EvalWeightsHeader header{};
+  if (file.size() < sizeof(header)) throw std::runtime_error("Invalid weights file " + path);
+  std::memcpy(&header, file.begin(), sizeof(header));
+
+  if (header.magic != kMagic || header.version != kVersion || header.width != kEvalWidth || file.size() < sizeof(header) + kEvalWidth * sizeof(float))
+    throw std::runtime_error("Invalid weights file " + path);
+  // The header keeps the floats 4-byte aligned in the page-aligned mapping
+  weights = reinterpret_cast<const float *>(file.begin() + sizeof(header));
+}
+
+EvalWeights::EvalWeights(EvalWeights &&other) noexcept : file(std::move(other.file)), owned(other.owned) {
+  weights = other.weights == other.owned.data() ? owned.data() : other.weights;
+  other.weights = other.owned.data();
+}
+
+EvalWeights &EvalWeights::operator=(EvalWeights &&other) noexcept {
+  if (this == &other) return *this;
+  file = std::move(other.file);
+  owned = other.owned;
+  weights = other.weights == other.owned.data() ? owned.data() : other.weights;
+  other.weights = other.owned.data();
+  return *this;
+}
+
+void EvalWeights::save(const std::string &path, const std::array<float, kEvalWidth> &values) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("Failed to open " + path);
+
+  EvalWeightsHeader header{kMagic, kVersion, static_cast<uint16_t>(kEvalWidth)};
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(float)));
+  if (!out) throw std::runtime_error("Failed to write " + path);
+}
+
+// EvalBatch
+
+void EvalBatch::features(const EvalPosition &position, float *out) {
+  std::array<float, kEvalWidth * kLanes> tile{};
+  extract(position, tile.data(), 0);
+  for (size_t feature = 0; feature < kEvalWidth; ++feature) out[feature] = tile[feature * kLanes];
+}
+
+size_t EvalBatch::add(const EvalPosition &position) {
+  const auto index = positions.size();
+  const auto lane = index % kLanes;
+  positions.push_back(position);
+  if (lane == 0) blocks.emplace_back();
+  auto &block = blocks.back();
+
+  const bool hasTrump = position.trumpSuit < kSuitCount;
+  size_t plain = 0;
+  block.trumps[lane] = 0;
+  block.plain[kSuitCount - 1][lane] = 0;
+  uint32_t tableCards = 0;
+  float tableStrength = 0;
+  for (uint8_t suit = 0; suit < kSuitCount; ++suit) {
+    const auto cards = static_cast<uint32_t>(position.hand >> (suit * kValueCount) & kSuitBits);
+    if (hasTrump && suit == position.trumpSuit)
+      block.trumps[lane] = cards;
+    else
+      block.plain[plain++][lane] = cards;
+
+    const auto table = static_cast<uint32_t>(position.table >> (suit * kValueCount) & kSuitBits);
+    tableCards += kSuit.length[table];
+    tableStrength += kSuit.strength[table];
+  }
+
+  block.tableCards[lane] = static_cast<float>(tableCards);
+  block.tableTrumps[lane] = hasTrump ? static_cast<float>(kSuit.length[position.table >> (position.trumpSuit * kValueCount) & kSuitBits]) : 0.0f;
+  block.tableStrength[lane] = tableStrength;
+  block.heap[lane] = static_cast<float>(position.inHeap) / kDeckSize;
+  block.fall[lane] = static_cast<float>(position.inFall) / kDeckSize;
+  block.opponentCards[lane] = position.opponentCards;
+  block.heapEmpty[lane] = position.inHeap == 0 ? 1.0f : 0.0f;
+  return index;
+}
+
+void EvalBatch::addSuccessors(const GameState &state, const MoveList &moves) {
+  EvalPosition current;
+  current.hand = Card::mask(state.my_cards);
+  current.trumpSuit = static_cast<uint8_t>(state.trump.suit);
+  current.inHeap = state.inHeap;
+  current.inFall = state.inFall;
+  current.opponentCards = static_cast<uint8_t>(state.opponent_cards.size());
+  addSuccessors(current, Card::mask(state.attack_cards), state.status == GameStatus::YourMove, moves);
+}
+
+void EvalBatch::addSuccessors(const Position &position, const MoveList &moves) {
+  EvalPosition current;
+  current.hand = position.hands[position.seat];
+  current.trumpSuit = position.trumpSuit;
+  current.inHeap = position.inHeap();
+  current.inFall = position.inFall();
+  current.opponentCards = static_cast<uint8_t>(cardCount(position.hands[1 - position.seat]));
+  addSuccessors(current, position.attackCards, position.phase == Position::Phase::Attack, moves);
+}
+
+void EvalBatch::addSuccessors(const EvalPosition &current, CardMask attack, bool attacking, const MoveList &moves) {
+  for (const auto &move : moves) {
+    auto position = current;
+    if (attacking) {
+      position.hand &= ~move.cards;
+      position.table = move.cards;
+    } else if (move.cards == 0) {
+      position.hand |= attack;
+    } else {
+      position.hand &= ~move.cards;
+      position.inFall = static_cast<uint8_t>(position.inFall + 2 * cardCount(move.cards));
+    }
+    add(position);
+  }
+}
+
+bool EvalBatch::simdAvailable() {
+#ifdef BURA_EVAL_AVX2
+  static const bool available = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return available;
+#else
+  return false;
+#endif
+}
+
+void EvalBatch::score(const EvalWeights &weights, float *scores, bool simd) const {
+#ifdef BURA_EVAL_AVX2
+  if (simd && simdAvailable()) return scoreAvx2(blocks.data(), positions.size(), weights.data(), scores);
+#endif
+  scoreScalar(positions.data(), positions.size(), weights.data(), scores);
+}
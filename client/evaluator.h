@@ -0,0 +1,134 @@
+#ifndef CLIENT_EVALUATOR_H
+#define CLIENT_EVALUATOR_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "mapped_file.h"
+#include "movegen.h"
+#include "position.h"
+
+// A linear static evaluator: features of a position as one player sees it, dotted with a weights vector. Higher
+// is better for that player. Positions are stored and scored eight at a time by column, so that on CPUs with
+// AVX2 the features of eight positions are built together and every one of them is a single multiply-add.
+
+namespace bura {
+
+enum EvalFeature : uint8_t {
+  kEvalBias,
+  kEvalHandCards,
+  kEvalTrumps,
+  kEvalTrumpStrength,  // trumps weighted by rank, an Ace is 1
+  kEvalPlainStrength,  // the same for the other suits
+  kEvalRanks,          // cards of each rank, Aces first
+  kEvalLongSuit = kEvalRanks + kValueCount,  // lengths of the three other suits, longest first
+  kEvalMiddleSuit,
+  kEvalShortSuit,
+  kEvalGroups,  // ranks with two or more cards, the attacks of several cards
+  kEvalTableCards,
+  kEvalTableTrumps,
+  kEvalTableStrength,
+  kEvalHeap,
+  kEvalFall,
+  kEvalOpponentCards,
+  kEvalHeapEmpty,
+  kEvalEndgameCards,  // cards in hand once the heap is empty
+  kEvalFeatureCount
+};
+
+// Weights and features are padded to this, the rest stays zero
+constexpr size_t kEvalWidth = 32;
+static_assert(kEvalFeatureCount <= kEvalWidth, "evaluator features do not fit");
+
+// What a player knows of a position: the own hand, the cards on the table the opponent has to answer, and counts
+struct EvalPosition {
+  CardMask hand{0};
+  CardMask table{0};
+  uint8_t trumpSuit{kNoCard};
+  uint8_t inHeap{0};
+  uint8_t inFall{0};
+  uint8_t opponentCards{0};
+};
+
+// Built-in weights, or a weights file mapped read-only:
+// EvalWeightsHeader followed by kEvalWidth little-endian floats.
+class EvalWeights final {
+ private:
+  MappedFile file;
+  std::array<float, kEvalWidth> owned{};
+  const float *weights{owned.data()};
+
+ public:
+  static constexpr uint32_t kMagic = 0x57564542;  // "BEVW"
+  static constexpr uint16_t kVersion = 1;
+
+  EvalWeights();
+  explicit EvalWeights(const std::array<float, kEvalWidth> &values);
+  // Throws std::runtime_error if the file is not a weights file of this layout
+  explicit EvalWeights(const std::string &path);
+  EvalWeights(EvalWeights &&other) noexcept;
+  EvalWeights &operator=(EvalWeights &&other) noexcept;
+
+  static void save(const std::string &path, const std::array<float, kEvalWidth> &values);
+
+  [[nodiscard]] const float *data() const { return weights; }
+  [[nodiscard]] float operator[](size_t feature) const { return weights[feature]; }
+};
+
+class EvalBatch final {
+ public:
+  static constexpr size_t kLanes = 8;
+
+  // Eight positions by column: the suits as trump and plain (without a trump all four are plain, with one the
+  // fourth is empty), the table and the counts as floats
+  struct alignas(32) Block {
+    std::array<uint32_t, kLanes> trumps;
+    std::array<std::array<uint32_t, kLanes>, kSuitCount> plain;
+    std::array<float, kLanes> tableCards;
+    std::array<float, kLanes> tableTrumps;
+    std::array<float, kLanes> tableStrength;
+    std::array<float, kLanes> heap;
+    std::array<float, kLanes> fall;
+    std::array<float, kLanes> opponentCards;
+    std::array<float, kLanes> heapEmpty;
+  };
+
+ private:
+  std::vector<EvalPosition> positions;
+  std::vector<Block> blocks;
+
+ public:
+  // The feature vector of one position, kEvalWidth floats
+  static void features(const EvalPosition &position, float *out);
+
+  void clear() {
+    positions.clear();
+    blocks.clear();
+  }
+  void reserve(size_t count) {
+    positions.reserve(count);
+    blocks.reserve((count + kLanes - 1) / kLanes);
+  }
+  size_t add(const EvalPosition &position);
+  // The position after each move as the player who makes it sees it, before the heap refills the hands:
+  // attacks leave the cards on the table, defences send both sides to the fall, a pass (no cards) takes the attack
+  void addSuccessors(const EvalPosition &current, CardMask attack, bool attacking, const MoveList &moves);
+  void addSuccessors(const GameState &state, const MoveList &moves);
+  // For the player to act, who sees only the size of the other hand
+  void addSuccessors(const Position &position, const MoveList &moves);
+
+  [[nodiscard]] size_t size() const { return positions.size(); }
+  [[nodiscard]] const EvalPosition &operator[](size_t i) const { return positions[i]; }
+
+  // One score per position, in the order they were added; `scores` needs size() floats.
+  // Uses AVX2 where the CPU has it unless `simd` is false.
+  void score(const EvalWeights &weights, float *scores, bool simd = true) const;
+  static bool simdAvailable();
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_EVALUATOR_H
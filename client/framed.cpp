@@ -0,0 +1,222 @@
+#include "framed.h"
+
+#include <array>
+
+#include "metrics.h"
+#include "shm.h"
+
+void http::appendFrame(uint16_t code, const std::vector<uint8_t>& payload, std::vector<uint8_t>& buffer) {
+  auto length = static_cast<uint32_t>(payload.size());
+  std::array<uint8_t, kFrameHeaderSize> header{};
+  std::memcpy(header.data(), &code, sizeof(code));
+  std::memcpy(header.data() + sizeof(code), &length, sizeof(length));
+
+  buffer.reserve(buffer.size() + kFrameHeaderSize + payload.size());
+  buffer.insert(buffer.end(), header.begin(), header.end());
+  buffer.insert(buffer.end(), payload.begin(), payload.end());
+}
+
+// FramedSession
+
+http::FramedSession::FramedSession(const std::string& host, const std::string& port, std::chrono::milliseconds timeout)
+    : Transport(timeout), domain(host), port(port) {}
+
+void http::FramedSession::open(LatencyProbe& probe, int64_t ms_timeout) {
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo* info;
+  if (auto code = getaddrinfo(domain.c_str(), port.c_str(), &hints, &info); code != 0) throwAddressError(code, domain);
+
+  const std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addressInfo{info, freeaddrinfo};
+  probe.mark(Phase::Resolve);
+
+  auto newSocket = std::make_unique<Socket>();
+  newSocket->connect(addressInfo->ai_addr, static_cast<socklen_t>(addressInfo->ai_addrlen), ms_timeout);
+  newSocket->setNoDelay(true);
+  probe.mark(Phase::Connect);
+
+  socket = std::move(newSocket);
+  received.clear();
+
+  if (opened) bura::metrics::ClientMetrics::get().reconnects.add();
+  opened = true;
+}
+
+std::optional<http::Response> http::FramedSession::exchange(uint16_t code, const std::vector<uint8_t>& payload, LatencyProbe& probe,
+                                                            const std::chrono::milliseconds timeout) {
+  const auto stopTime = std::chrono::steady_clock::now() + timeout;
+  const auto remainingTime = [&]() -> int64_t { return (timeout.count() >= 0) ? getRemainingMilliseconds(stopTime) : -1; };
+
+  if (!socket) open(probe, remainingTime());
+
+  std::vector<uint8_t> frame;
+  appendFrame(code, payload, frame);
+
+  auto remaining = frame.size();
+  auto sendData = frame.data();
+
+  while (remaining > 0) {
+    const auto size = socket->send(sendData, remaining, remainingTime());
+    remaining -= size;
+    sendData += size;
+  }
+  bytesSent += frame.size();
+  probe.mark(Phase::Send);
+
+  std::array<std::uint8_t, 4096> tempBuffer{};
+  bool firstByte = true;
+
+  for (;;) {
+    if (received.size() >= kFrameHeaderSize) {
+      uint16_t status;
+      uint32_t size;
+      std::memcpy(&status, received.data(), sizeof(status));
+      std::memcpy(&size, received.data() + sizeof(status), sizeof(size));
+
+      if (received.size() >= kFrameHeaderSize + size) {
+        Response response;
+        response.status = status;
+        response.data.assign(received.begin() + kFrameHeaderSize, received.begin() + kFrameHeaderSize + size);
+        received.erase(received.begin(), received.begin() + kFrameHeaderSize + size);
+        probe.mark(Phase::Body);
+        return response;
+      }
+    }
+
+    const auto size = socket->read(tempBuffer.data(), tempBuffer.size(), remainingTime());
+
+    if (size == 0) {
+      socket.reset();
+      received.clear();
+      // Closed before answering: the server dropped the connection, the request was not handled
+      if (firstByte) return std::nullopt;
+      throw httpResponseError("Connection closed in the middle of a frame");
+    }
+
+    if (firstByte) {
+      probe.mark(Phase::FirstByte);
+      firstByte = false;
+    }
+
+    bytesReceived += size;
+    received.insert(received.end(), tempBuffer.begin(), tempBuffer.begin() + size);
+  }
+}
+
+http::Response http::FramedSession::call(uint16_t code, const std::vector<uint8_t>& payload, std::chrono::milliseconds timeout) {
+  LatencyProbe probe(code);
+  const bool reused = socket != nullptr;
+
+  try {
+    auto response = exchange(code, payload, probe, timeout);
+
+    // A kept-alive connection may have been closed by the server in the meantime, reconnect once
+    if (!response && reused) response = exchange(code, payload, probe, timeout);
+    if (!response) throw httpResponseError("Connection closed");
+
+    probe.finish();
+    return std::move(*response);
+  } catch (...) {
+    // The connection state is unknown after a failure, a late reply must not be read as the next response
+    socket.reset();
+    received.clear();
+    throw;
+  }
+}
+
+// FramedConnection
+
+http::FramedConnection::FramedConnection(const std::string& host, const std::string& port, std::chrono::milliseconds timeout) {
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo* info;
+  if (auto code = getaddrinfo(host.c_str(), port.c_str(), &hints, &info); code != 0) throwAddressError(code, host);
+
+  const std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addressInfo{info, freeaddrinfo};
+  socket.connect(addressInfo->ai_addr, static_cast<socklen_t>(addressInfo->ai_addrlen), timeout.count());
+  socket.setNoDelay(true);
+}
+
+void http::FramedConnection::call(uint16_t code, const std::vector<uint8_t>& payload, Callback callback) {
+  appendFrame(code, payload, outgoing);
+  pending.emplace_back(LatencyProbe(code), std::move(callback));
+  onWritable();
+}
+
+void http::FramedConnection::onWritable() {
+  while (wantsWrite()) {
+    auto size = socket.trySend(outgoing.data() + written, outgoing.size() - written);
+    if (!size) break;
+    written += *size;
+  }
+
+  if (!wantsWrite()) {
+    outgoing.clear();
+    written = 0;
+  }
+}
+
+void http::FramedConnection::onReadable() {
+  std::array<std::uint8_t, 4096> tempBuffer{};
+
+  for (;;) {
+    auto size = socket.tryRead(tempBuffer.data(), tempBuffer.size());
+    if (!size) break;
+    if (*size == 0) throw httpResponseError(pending.empty() ? "Connection closed" : "Connection closed with requests in flight");
+
+    received.insert(received.end(), tempBuffer.begin(), tempBuffer.begin() + static_cast<std::ptrdiff_t>(*size));
+  }
+
+  while (received.size() - consumed >= kFrameHeaderSize) {
+    uint16_t status;
+    uint32_t size;
+    std::memcpy(&status, received.data() + consumed, sizeof(status));
+    std::memcpy(&size, received.data() + consumed + sizeof(status), sizeof(size));
+    if (received.size() - consumed < kFrameHeaderSize + size) break;
+    if (pending.empty()) throw httpResponseError("Reply without a request");
+
+    Response response;
+    response.status = status;
+    response.data.assign(received.begin() + static_cast<std::ptrdiff_t>(consumed + kFrameHeaderSize),
+                         received.begin() + static_cast<std::ptrdiff_t>(consumed + kFrameHeaderSize + size));
+    consumed += kFrameHeaderSize + size;
+
+    auto [probe, callback] = std::move(pending.front());
+    pending.pop_front();
+    probe.finish();
+    callback(std::move(response));
+  }
+
+  // Keep the partial frame at the start of the buffer
+  received.erase(received.begin(), received.begin() + static_cast<std::ptrdiff_t>(consumed));
+  consumed = 0;
+}
+
+// Transport selection
+
+// For the shared-memory transport the "port" is the server's Unix socket
+const char* http::defaultPort(TransportKind kind) {
+  switch (kind) {
+    case TransportKind::Framed:
+      return "2022";
+    case TransportKind::Shm:
+      return kShmSocketPath;
+    default:
+      return "2021";
+  }
+}
+
+std::unique_ptr<http::Transport> http::makeTransport(TransportKind kind, const std::string& host, const std::string& port,
+                                                     std::chrono::milliseconds timeout) {
+  if (kind == TransportKind::Framed) return std::make_unique<FramedSession>(host, port, timeout);
+#ifndef _WIN32
+  if (kind == TransportKind::Shm) return std::make_unique<ShmTransport>(port, timeout);
+#else
+  if (kind == TransportKind::Shm) throw std::invalid_argument("The shared memory transport needs Linux");
+#endif
+  return std::make_unique<Session>(host, port, timeout);
+}
@@ -0,0 +1,76 @@
+#ifndef CLIENT_FRAMED_H
+#define CLIENT_FRAMED_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "http.h"
+
+namespace http {
+
+// u16 code + u32 payload length, see server/src/socketHandler.ts
+constexpr size_t kFrameHeaderSize = sizeof(uint16_t) + sizeof(uint32_t);
+
+// Raw TCP transport: one persistent connection, each call is a request frame answered by one response frame
+// whose code carries the status.
+class FramedSession final : public Transport {
+ private:
+  WSA winSock;
+  std::string domain;
+  std::string port;
+
+  std::unique_ptr<Socket> socket;
+  std::vector<uint8_t> received;
+  bool opened{false};
+
+  void open(LatencyProbe& probe, int64_t ms_timeout);
+  std::optional<Response> exchange(uint16_t code, const std::vector<uint8_t>& payload, LatencyProbe& probe, std::chrono::milliseconds timeout);
+
+ public:
+  using Transport::call;
+
+  FramedSession(const std::string& host, const std::string& port, std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+  Response call(uint16_t code, const std::vector<uint8_t>& payload, std::chrono::milliseconds timeout) override;
+};
+
+// Non-blocking form of FramedSession for single-threaded event loops. Calls are pipelined on one connection and
+// answered in order; the loop waits on handle() itself, for writing only while wantsWrite().
+class FramedConnection final {
+ public:
+  using Callback = std::function<void(Response)>;
+
+ private:
+  WSA winSock;
+  Socket socket;
+  std::vector<uint8_t> outgoing;
+  size_t written{0};
+  std::vector<uint8_t> received;
+  size_t consumed{0};
+  std::deque<std::pair<LatencyProbe, Callback>> pending;
+
+ public:
+  // Connects before returning, blocking for up to timeout
+  FramedConnection(const std::string& host, const std::string& port, std::chrono::milliseconds timeout);
+
+  // Queues the request frame; callback runs from onReadable once the reply arrived
+  void call(uint16_t code, const std::vector<uint8_t>& payload, Callback callback);
+
+  [[nodiscard]] SOCKET handle() const { return socket.handle(); }
+  [[nodiscard]] bool wantsWrite() const { return written < outgoing.size(); }
+  [[nodiscard]] size_t inFlight() const { return pending.size(); }
+
+  void onWritable();
+  // Runs the callbacks of every complete reply; throws httpResponseError once the server closed the connection
+  void onReadable();
+};
+
+void appendFrame(uint16_t code, const std::vector<uint8_t>& payload, std::vector<uint8_t>& buffer);
+
+const char* defaultPort(TransportKind kind);
+std::unique_ptr<Transport> makeTransport(TransportKind kind, const std::string& host, const std::string& port, std::chrono::milliseconds timeout);
+
+}  // namespace http
+
+#endif  // CLIENT_FRAMED_H
@@ -1,8 +1,12 @@
 #include "game.h"
 
-#include <cstdlib>
-#include <random>
-#include <sstream>
+#include "framed.h"
+#include "metrics.h"
+#include "protocol.h"
+#include "record.h"
+#include "rng.h"
+#include "scheduler.h"
+#include "trace.h"
 
 using namespace bura;
 
@@ -15,165 +19,120 @@ Card::Card(bura::CardType type, bool hidden) : hidden(hidden) {
   value = static_cast<CardValue>(type & 0xFF);
 }
 CardType Card::type() const { return static_cast<uint16_t>(static_cast<int>(suit) << 8 | (static_cast<int>(value))); }
+uint8_t Card::index() const {
+  if (suit == CardSuit::None || value == CardValue::None) return kNoCard;
+  return static_cast<uint8_t>(static_cast<int>(suit) * kValueCount + static_cast<int>(value));
+}
+CardMask Card::mask() const {
+  auto i = index();
+  return i == kNoCard ? 0 : CardMask{1} << i;
+}
+Card Card::fromIndex(uint8_t index, bool hidden) {
+  if (index >= kDeckSize) return Card(CardSuit::None, CardValue::None, hidden);
+  return Card(static_cast<CardSuit>(index / kValueCount), static_cast<CardValue>(index % kValueCount), hidden);
+}
+CardMask Card::mask(const std::vector<Card> &cards) {
+  CardMask result = 0;
+  for (const auto &card : cards) result |= card.mask();
+  return result;
+}
 
-std::string generateRandomString(size_t length) {
+std::string bura::generateRandomString(size_t length) {
   const char *charmap = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
   const size_t charmapLength = strlen(charmap);
-  auto generator = [&]() {
-    std::default_random_engine dre(std::random_device{}());
-    std::uniform_int_distribution<> dist(0, charmapLength - 1);
+  auto &rng = threadRng();
 
-    return charmap[dist(dre)];
-  };
   std::string result;
   result.reserve(length);
-  generate_n(back_inserter(result), length, generator);
+  for (size_t i = 0; i < length; ++i) result.push_back(charmap[rng.below(charmapLength)]);
   return result;
 }
 
-void BuraClient::start(const std::string &host) {
+void BuraClient::start(const std::string &host, const std::string &port, http::TransportKind transport) {
   std::lock_guard<std::mutex> sLock(tcpMutex);
   state.id = generateRandomString(8);
-  session = std::make_unique<http::Session>(host, "2021", std::chrono::seconds(5));
+  session = http::makeTransport(transport, host, port, std::chrono::seconds(5));
 }
 
-int BuraClient::connect(const std::string &nickname) {
+void BuraClient::start(std::unique_ptr<http::Transport> transport) {
   std::lock_guard<std::mutex> sLock(tcpMutex);
-  auto result = session->call(2, [&](std::ostringstream &ss) {
-    ss << state.id;
-
-    auto wchar = strdup(nickname.c_str());
-    uint32_t len = nickname.size();
-    ss.write(reinterpret_cast<char *>(&len), sizeof(len));
-    ss.write(reinterpret_cast<char *>(wchar), sizeof(char) * len);
-    free(wchar);
-  });
-
-  return result.status;
+  state.id = generateRandomString(8);
+  session = std::move(transport);
 }
 
-
-GameState BuraClient::fetch() {
+int BuraClient::connect(const std::string &nickname) {
+  TRACE_SCOPE("BuraClient::connect");
   std::lock_guard<std::mutex> sLock(tcpMutex);
+  auto result = session->call(2, proto::ConnectRequest::encode(proto::Connect{state.id, nickname}));
 
-  auto result = session->call(
-      3, [&](auto &ss) { ss << state.id; },
-      [&](std::istringstream &r, auto error) {
-        if (error != 0) return;
-
-        CardType tmpCardType{};
-        uint32_t tmpSize;
-
-        r.read(reinterpret_cast<char *>(&state.status), sizeof(int8_t));
-
-        r.read(reinterpret_cast<char *>(&tmpCardType), sizeof(CardType));
-        state.trump = Card(tmpCardType);
-
-        r.read(reinterpret_cast<char *>(&state.inHeap), sizeof(uint8_t));
-        r.read(reinterpret_cast<char *>(&state.inFall), sizeof(uint8_t));
-
-        // My Cards
-        r.read(reinterpret_cast<char *>(&tmpSize), sizeof(uint32_t));
-
-        state.my_cards.clear();
-        state.my_cards.reserve(tmpSize);
-
-        for (uint32_t i = 0; i < tmpSize; ++i) {
-          r.read(reinterpret_cast<char *>(&tmpCardType), sizeof(CardType));
-          state.my_cards.emplace_back(tmpCardType);
-        }
-
-        // Opponent Cards
-        r.read(reinterpret_cast<char *>(&tmpSize), sizeof(uint32_t));
-
-        state.opponent_cards.clear();
-        state.opponent_cards.reserve(tmpSize);
-
-        for (uint32_t i = 0; i < tmpSize; ++i) {
-          r.read(reinterpret_cast<char *>(&tmpCardType), sizeof(CardType));
-          state.opponent_cards.emplace_back(Card(tmpCardType, true));
-        }
-
-        // Attack Cards
-        r.read(reinterpret_cast<char *>(&tmpSize), sizeof(uint32_t));
-
-        state.attack_cards.clear();
-        state.attack_cards.reserve(tmpSize);
-
-        for (uint32_t i = 0; i < tmpSize; ++i) {
-          r.read(reinterpret_cast<char *>(&tmpCardType), sizeof(CardType));
-          state.attack_cards.emplace_back(tmpCardType);
-        }
-
-        // Defend Cards
-        r.read(reinterpret_cast<char *>(&tmpSize), sizeof(uint32_t));
-
-        state.defend_cards.clear();
-        state.defend_cards.reserve(tmpSize);
-
-        for (uint32_t i = 0; i < tmpSize; ++i) {
-          r.read(reinterpret_cast<char *>(&tmpCardType), sizeof(CardType));
-          state.defend_cards.emplace_back(tmpCardType);
-        }
-
-        // opponent nik
-        r.read(reinterpret_cast<char *>(&tmpSize), sizeof(uint32_t));
-
-        char *oppNickname = new char[tmpSize + 1];
+  return result.status;
+}
 
-        r.read(oppNickname, sizeof(char) * tmpSize);
+bool BuraClient::decodeState(const uint8_t *data, size_t size, GameState &state) { return proto::StateReply::decode(data, size, state); }
 
-        oppNickname[tmpSize] = '\0';
-        wchar_t *wnickname = new wchar_t[strlen(oppNickname) + 1];
+void BuraClient::countError(const std::exception &err) {
+  auto &counters = metrics::ClientMetrics::get();
+  if (dynamic_cast<const http::httpResponseError *>(&err) || dynamic_cast<const http::httpRequestError *>(&err))
+    counters.protocolErrors.add();
+  else
+    counters.transportErrors.add();
+}
 
-        mbstowcs(wnickname, oppNickname, strlen(oppNickname));
+void BuraClient::applyState(const std::vector<uint8_t> &data) {
+  TRACE_SCOPE("decode");
+  if (!decodeState(data.data(), data.size(), state)) throw http::httpResponseError("Truncated state reply");
 
-        wnickname[strlen(oppNickname)] = L'\0';
-        state.opponentNickname = wnickname;
+  if (recorder) recorder->state(state);
+}
 
-        delete[] oppNickname;
-        delete[] wnickname;
-      });
+GameState BuraClient::fetch() {
+  TRACE_SCOPE("BuraClient::fetch");
+  std::lock_guard<std::mutex> sLock(tcpMutex);
 
+  FetchResult result;
+  if (scheduler) {
+    result = scheduler->fetch(state.id).get();
+  } else {
+    auto response = session->call(3, proto::FetchRequest::encode(proto::Fetch{state.id}));
+    result.status = response.status;
+    result.data = std::move(response.data);
+    metrics::ClientMetrics::get().fetches.add();
+  }
+
+  if (result.status == 0) applyState(result.data);
   return state;
 }
 int BuraClient::finishMove(std::vector<Card> cards) {
+  TRACE_SCOPE("BuraClient::finishMove");
   std::lock_guard<std::mutex> sLock(tcpMutex);
-  auto result = session->call(4, [&](std::ostringstream &ss) {
-    ss << state.id;
-    uint32_t size = static_cast<uint32_t>(cards.size());
-    ss.write(reinterpret_cast<char *>(&size), sizeof(uint32_t));
-    for (auto &item : cards) {
-      auto type = item.type();
-      ss.write(reinterpret_cast<char *>(&type), sizeof(CardType));
-    }
-  });
+  auto result = session->call(4, proto::MoveRequest::encode(proto::Move{state.id, cards}));
 
+  if (recorder) recorder->move(state.id, record::EventKind::Move, cards, result.status);
   return result.status;
 }
 int BuraClient::passDef() {
+  TRACE_SCOPE("BuraClient::passDef");
   std::lock_guard<std::mutex> sLock(tcpMutex);
-  auto result = session->call(5, [&](std::ostringstream &ss) {
-    ss << state.id;
-    uint8_t pass = 0;
-    ss.write(reinterpret_cast<char *>(&pass), sizeof(uint8_t));
-  });
+  auto result = session->call(5, proto::PassRequest::encode(proto::Pass{state.id}));
 
+  if (recorder) recorder->move(state.id, record::EventKind::Pass, {}, result.status);
   return result.status;
 }
 int BuraClient::finishDef(std::vector<Card> cards) {
+  TRACE_SCOPE("BuraClient::finishDef");
   std::lock_guard<std::mutex> sLock(tcpMutex);
-  auto result = session->call(5, [&](std::ostringstream &ss) {
-    ss << state.id;
-    uint8_t pass = 1;
-    ss.write(reinterpret_cast<char *>(&pass), sizeof(uint8_t));
-    auto size = static_cast<uint32_t>(cards.size());
-    ss.write(reinterpret_cast<char *>(&size), sizeof(uint32_t));
-    for (auto &item : cards) {
-      auto type = item.type();
-      ss.write(reinterpret_cast<char *>(&type), sizeof(CardType));
-    }
-  });
+  auto result = session->call(5, proto::DefendRequest::encode(proto::Defend{state.id, 1, cards}));
 
+  if (recorder) recorder->move(state.id, record::EventKind::Defend, cards, result.status);
   return result.status;
 }
+
+void BuraClient::setRecorder(std::shared_ptr<record::GameRecorder> gameRecorder) {
+  std::lock_guard<std::mutex> sLock(tcpMutex);
+  recorder = std::move(gameRecorder);
+}
+
+void BuraClient::setScheduler(std::shared_ptr<FetchScheduler> fetchScheduler) {
+  std::lock_guard<std::mutex> sLock(tcpMutex);
+  scheduler = std::move(fetchScheduler);
+}
@@ -1,5 +1,6 @@
 #ifndef CLIENT_GAME_H
 #define CLIENT_GAME_H
+#include <atomic>
 #include <iostream>
 #include <shared_mutex>
 #include <vector>
@@ -45,6 +46,15 @@ enum struct GameStatus : int8_t {
 };
 
 using CardType = uint16_t;
+using CardMask = uint64_t;
+
+constexpr int kSuitCount = 4;
+constexpr int kValueCount = 9;
+constexpr int kDeckSize = kSuitCount * kValueCount;
+constexpr uint8_t kNoCard = 0xFF;
+
+inline uint8_t lowestCard(CardMask mask) { return static_cast<uint8_t>(__builtin_ctzll(mask)); }
+inline int cardCount(CardMask mask) { return __builtin_popcountll(mask); }
 
 struct Card {
   CardSuit suit;
@@ -60,6 +70,11 @@ struct Card {
   Card();
 
   [[nodiscard]] CardType type() const;
+  [[nodiscard]] uint8_t index() const;
+  [[nodiscard]] CardMask mask() const;
+
+  static Card fromIndex(uint8_t index, bool hidden = false);
+  static CardMask mask(const std::vector<Card> &cards);
 
   static bool canUseCard(const Card &a, const Card &b, CardSuit trump) {
     if (a.suit == CardSuit::None || b.suit == CardSuit::None) return false;
@@ -87,19 +102,35 @@ struct GameState {
   Card trump{};  // козырь
 };
 
-using MoveFunctionPtr = void (*)(std::vector<CardType> &yourMove);
-using StartFunctionPtr = void (*)();
-using EndFunctionPtr = void (*)();
+// Strategy callbacks for BuraClient::play, see strategy.h
+using StartFunctionPtr = void (*)(const GameState &state);
+using MoveFunctionPtr = void (*)(const GameState &state, std::vector<Card> &yourMove);
+using DefendFunctionPtr = bool (*)(const GameState &state, std::vector<Card> &yourDefence);
+using EndFunctionPtr = void (*)(const GameState &state);
+
+namespace record {
+class GameRecorder;
+}
+
+class FetchScheduler;
+class PollTimer;
+
+std::string generateRandomString(size_t length);
 
 class BuraClient {
  private:
   GameState state{};
   std::mutex tcpMutex{};
-  std::unique_ptr<http::Session> session{};
+  std::unique_ptr<http::Transport> session{};
+  std::shared_ptr<record::GameRecorder> recorder{};
+  std::shared_ptr<FetchScheduler> scheduler{};
 
+  void applyState(const std::vector<uint8_t> &data);
 
  public:
-  void start(const std::string &host);
+  void start(const std::string &host, const std::string &port = "2021", http::TransportKind transport = http::TransportKind::Http);
+  // Any other transport, e.g. http::LoopbackTransport
+  void start(std::unique_ptr<http::Transport> transport);
   int connect(const std::string &nickname);
 
   GameState fetch();
@@ -108,6 +139,16 @@ class BuraClient {
   int passDef();
 
   GameState getState() { return state; }
+  // Opcode 3 reply, see protocol.h; false if it is truncated
+  static bool decodeState(const uint8_t *data, size_t size, GameState &state);
+  // Counts a failed call in metrics::ClientMetrics: replies that do not parse as protocol errors, the rest as transport
+  static void countError(const std::exception &err);
+
+  void setRecorder(std::shared_ptr<record::GameRecorder> gameRecorder);
+  void setScheduler(std::shared_ptr<FetchScheduler> fetchScheduler);
+
+  template <typename Strategy>
+  void play(Strategy &strategy, PollTimer &poll, const std::atomic<bool> &stop);
 };
 
 }  // namespace bura
@@ -1,16 +1,68 @@
 #include "http.h"
 
-#include <iostream>
 #include <sstream>
 
+#ifndef _WIN32
+#include <fcntl.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+constexpr int kInterrupted = WSAEINTR;
+constexpr int kInProgress = WSAEWOULDBLOCK;
+constexpr int kWouldBlock = WSAEWOULDBLOCK;
+constexpr int kSendFlags = 0;
+
+void closeSocket(SOCKET endpoint) { closesocket(endpoint); }
+
+bool setNonBlocking(SOCKET endpoint) {
+  ULONG mode = 1;
+  return ioctlsocket(endpoint, FIONBIO, &mode) == 0;
+}
+#else
+constexpr int kInterrupted = EINTR;
+constexpr int kInProgress = EINPROGRESS;
+constexpr int kWouldBlock = EWOULDBLOCK;
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // a closed peer is reported as EPIPE instead of killing the process
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+void closeSocket(SOCKET endpoint) { ::close(endpoint); }
+
+bool setNonBlocking(SOCKET endpoint) {
+  int flags = fcntl(endpoint, F_GETFL, 0);
+  return flags != -1 && fcntl(endpoint, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+}  // namespace
+
 http::httpRequestError::httpRequestError(const char* str) : std::logic_error{str} {}
 http::httpRequestError::httpRequestError(const std::string& str) : std::logic_error{str} {}
 
 http::httpResponseError::httpResponseError(const char* str) : std::logic_error{str} {}
 http::httpResponseError::httpResponseError(const std::string& str) : std::logic_error{str} {}
 
+void http::throwAddressError(int code, const std::string& host) {
+  throw std::runtime_error("Failed to get address info of " + host + ": " + gai_strerror(code));
+}
+
+int http::lastSocketError() {
+#ifdef _WIN32
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
 // WSA
 
+#ifdef _WIN32
 http::WSA::WSA() {
   WSADATA wsa_data;
   WORD version = MAKEWORD(2, 2);
@@ -39,28 +91,34 @@ http::WSA& http::WSA::operator=(WSA&& other) noexcept {
   other.is_started = false;
   return *this;
 }
+#else
+http::WSA::WSA() = default;
+http::WSA::WSA(WSA&& other) noexcept = default;
+http::WSA::~WSA() = default;
+http::WSA& http::WSA::operator=(WSA&& other) noexcept = default;
+#endif
 
 // Socket
 
 http::Socket::Socket() : endpoint{socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)} {
-  if (endpoint == INVALID_SOCKET) throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to create socket");
+  if (endpoint == INVALID_SOCKET) throw std::system_error(lastSocketError(), std::system_category(), "Failed to create socket");
 
-  ULONG mode = 1;
-  if (ioctlsocket(endpoint, FIONBIO, &mode) != 0) {
-    closesocket(endpoint);
-    throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to get socket flags");
+  if (!setNonBlocking(endpoint)) {
+    auto error = lastSocketError();
+    closeSocket(endpoint);
+    throw std::system_error(error, std::system_category(), "Failed to get socket flags");
   }
 }
 
 http::Socket::Socket(Socket&& other) noexcept : endpoint{other.endpoint} { other.endpoint = INVALID_SOCKET; }
 
 http::Socket::~Socket() {
-  if (endpoint != INVALID_SOCKET) closesocket(endpoint);
+  if (endpoint != INVALID_SOCKET) closeSocket(endpoint);
 }
 
 http::Socket& http::Socket::operator=(Socket&& other) noexcept {
   if (&other == this) return *this;
-  if (endpoint != INVALID_SOCKET) closesocket(endpoint);
+  if (endpoint != INVALID_SOCKET) closeSocket(endpoint);
   endpoint = other.endpoint;
   other.endpoint = INVALID_SOCKET;
   return *this;
@@ -69,19 +127,19 @@ http::Socket& http::Socket::operator=(Socket&& other) noexcept {
 void http::Socket::connect(const struct sockaddr* address, const socklen_t address_size, const uint64_t ms_timeout) {
   int result = ::connect(endpoint, address, address_size);
 
-  while (result == -1 && WSAGetLastError() == WSAEINTR) {
+  while (result == -1 && lastSocketError() == kInterrupted) {
     result = ::connect(endpoint, address, address_size);
   }
 
   if (result == SOCKET_ERROR) {
-    if (WSAGetLastError() != WSAEWOULDBLOCK) throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to connect");
+    if (lastSocketError() != kInProgress) throw std::system_error(lastSocketError(), std::system_category(), "Failed to connect");
 
     select_write(ms_timeout);
 
     char socketErrorPointer[sizeof(int)];
     socklen_t optionLength = sizeof(socketErrorPointer);
     if (getsockopt(endpoint, SOL_SOCKET, SO_ERROR, socketErrorPointer, &optionLength) == SOCKET_ERROR)
-      throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to get socket option");
+      throw std::system_error(lastSocketError(), std::system_category(), "Failed to get socket option");
 
     int socketError;
     std::memcpy(&socketError, socketErrorPointer, sizeof(socketErrorPointer));
@@ -90,13 +148,20 @@ void http::Socket::connect(const struct sockaddr* address, const socklen_t addre
   }
 }
 
+void http::Socket::setNoDelay(bool enabled) {
+  int value = enabled ? 1 : 0;
+  if (setsockopt(endpoint, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&value), sizeof(value)) == SOCKET_ERROR)
+    throw std::system_error(lastSocketError(), std::system_category(), "Failed to set TCP_NODELAY");
+}
+
 size_t http::Socket::send(const void* buffer, size_t length, uint64_t timeout) {
   select_write(timeout);
-  int result = ::send(endpoint, reinterpret_cast<const char*>(buffer), static_cast<int>(length), 0);
-
-  while (result == -1 && WSAGetLastError() == WSAEINTR) result = ::send(endpoint, reinterpret_cast<const char*>(buffer), static_cast<int>(length), 0);
+  int result;
+  do {
+    result = ::send(endpoint, reinterpret_cast<const char*>(buffer), static_cast<int>(length), kSendFlags);
+  } while (result == -1 && lastSocketError() == kInterrupted);
 
-  if (result == -1) throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to send data");
+  if (result == -1) throw std::system_error(lastSocketError(), std::system_category(), "Failed to send data");
 
   return static_cast<size_t>(result);
 }
@@ -105,9 +170,33 @@ size_t http::Socket::read(void* buffer, size_t length, const uint64_t timeout) {
   select_read(timeout);
   int result = ::recv(endpoint, reinterpret_cast<char*>(buffer), static_cast<int>(length), 0);
 
-  while (result == -1 && WSAGetLastError() == WSAEINTR) result = ::recv(endpoint, reinterpret_cast<char*>(buffer), static_cast<int>(length), 0);
+  while (result == -1 && lastSocketError() == kInterrupted) result = ::recv(endpoint, reinterpret_cast<char*>(buffer), static_cast<int>(length), 0);
+
+  if (result == -1) throw std::system_error(lastSocketError(), std::system_category(), "Failed to read data");
+
+  return static_cast<size_t>(result);
+}
+
+std::optional<size_t> http::Socket::trySend(const void* buffer, size_t length) {
+  int result;
+  do {
+    result = ::send(endpoint, reinterpret_cast<const char*>(buffer), static_cast<int>(length), kSendFlags);
+  } while (result == -1 && lastSocketError() == kInterrupted);
+
+  if (result == -1 && lastSocketError() == kWouldBlock) return std::nullopt;
+  if (result == -1) throw std::system_error(lastSocketError(), std::system_category(), "Failed to send data");
+
+  return static_cast<size_t>(result);
+}
+
+std::optional<size_t> http::Socket::tryRead(void* buffer, size_t length) {
+  int result;
+  do {
+    result = ::recv(endpoint, reinterpret_cast<char*>(buffer), static_cast<int>(length), 0);
+  } while (result == -1 && lastSocketError() == kInterrupted);
 
-  if (result == -1) throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to read data");
+  if (result == -1 && lastSocketError() == kWouldBlock) return std::nullopt;
+  if (result == -1) throw std::system_error(lastSocketError(), std::system_category(), "Failed to read data");
 
   return static_cast<size_t>(result);
 }
@@ -117,13 +206,14 @@ void http::Socket::select_write(const int64_t ms_timeout) {
   FD_ZERO(&set);
   FD_SET(endpoint, &set);
 
-  TIMEVAL timeout{static_cast<LONG>((ms_timeout / 1000)), static_cast<LONG>((ms_timeout % 1000) * 1000)};
-
-  int result = select(0, nullptr, &set, nullptr, (ms_timeout >= 0) ? &timeout : nullptr);
+  timeval timeout{static_cast<long>((ms_timeout / 1000)), static_cast<long>((ms_timeout % 1000) * 1000)};
 
-  while (result == SOCKET_ERROR && WSAGetLastError() == WSAEINTR) result = select(0, nullptr, &set, nullptr, (ms_timeout >= 0) ? &timeout : nullptr);
+  int result;
+  do {
+    result = select(static_cast<int>(endpoint) + 1, nullptr, &set, nullptr, (ms_timeout >= 0) ? &timeout : nullptr);
+  } while (result == SOCKET_ERROR && lastSocketError() == kInterrupted);
 
-  if (result == SOCKET_ERROR) throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to select write socket");
+  if (result == SOCKET_ERROR) throw std::system_error(lastSocketError(), std::system_category(), "Failed to select write socket");
   if (result == 0) throw httpResponseError("Timeout");
 }
 
@@ -132,28 +222,67 @@ void http::Socket::select_read(const int64_t ms_timeout) {
   FD_ZERO(&set);
   FD_SET(endpoint, &set);
 
-  TIMEVAL timeout{static_cast<LONG>((ms_timeout / 1000)), static_cast<LONG>((ms_timeout % 1000) * 1000)};
+  timeval timeout{static_cast<long>((ms_timeout / 1000)), static_cast<long>((ms_timeout % 1000) * 1000)};
 
-  int result = select(0, &set, nullptr, nullptr, (ms_timeout >= 0) ? &timeout : nullptr);
+  int result;
+  do {
+    result = select(static_cast<int>(endpoint) + 1, &set, nullptr, nullptr, (ms_timeout >= 0) ? &timeout : nullptr);
+  } while (result == SOCKET_ERROR && lastSocketError() == kInterrupted);
 
-  while (result == SOCKET_ERROR && WSAGetLastError() == WSAEINTR) result = select(0, &set, nullptr, nullptr, (ms_timeout >= 0) ? &timeout : nullptr);
-
-  if (result == SOCKET_ERROR) throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to select read socket");
+  if (result == SOCKET_ERROR) throw std::system_error(lastSocketError(), std::system_category(), "Failed to select read socket");
   if (result == 0) throw httpResponseError("Timeout");
 }
 
+// Transport
+
+http::Transport::Transport(std::chrono::milliseconds timeout) : timeout_default(timeout) {}
+
+http::Response http::Transport::call(uint16_t code, const std::vector<uint8_t>& payload) { return call(code, payload, timeout_default); }
+http::Response http::Transport::call(uint16_t code, const uint8_t* payload, size_t length, std::chrono::milliseconds timeout) {
+  std::vector<uint8_t> vec(&payload[0], &payload[length]);
+  return call(code, vec, timeout);
+}
+http::Response http::Transport::call(uint16_t code, const uint8_t* payload, size_t length) { return call(code, payload, length, timeout_default); }
+http::Response http::Transport::call(uint16_t code, const std::string& str, std::chrono::milliseconds timeout) {
+  return call(code, reinterpret_cast<const uint8_t*>(str.c_str()), str.length(), timeout);
+}
+http::Response http::Transport::call(uint16_t code, const std::string& str) { return call(code, str, timeout_default); }
+http::Response http::Transport::call(uint16_t code, const http::StreamBuilder& builder, std::chrono::milliseconds timeout,
+                                     const http::StreamReader& reader) {
+  std::ostringstream ss;
+
+  if (!builder) throw std::invalid_argument("builder is nullptr");
+
+  builder(ss);
+
+  auto result = call(code, ss.str(), timeout);
+
+  std::istringstream in(std::string(result.data.begin(), result.data.end()));
+
+  if (reader) {
+    reader(in, result.status);
+  }
+
+  return result;
+}
+
+http::Response http::Transport::call(uint16_t code, const http::StreamBuilder& builder, const http::StreamReader& reader) {
+  return call(code, builder, timeout_default, reader);
+}
+
 // Session
 
-std::int64_t getRemainingMilliseconds(const std::chrono::steady_clock::time_point time) noexcept {
+std::int64_t http::getRemainingMilliseconds(const std::chrono::steady_clock::time_point time) noexcept {
   const auto now = std::chrono::steady_clock::now();
   const auto remainingTime = std::chrono::duration_cast<std::chrono::milliseconds>(time - now);
   return (remainingTime.count() > 0) ? remainingTime.count() : 0;
 }
 
 http::Session::Session(const std::string& host, const std::string& port, std::chrono::milliseconds timeout)
-    : domain(host), port(port), host(host + ":" + port), timeout_default(timeout) {}
+    : Transport(timeout), host(host + ":" + port), domain(host), port(port) {}
 
 http::Response http::Session::call(uint16_t code, const std::vector<uint8_t>& payload, std::chrono::milliseconds timeout) {
+  LatencyProbe probe(code);
   Response response;
 
   std::vector<uint8_t> data = payload;
@@ -164,7 +293,8 @@ http::Response http::Session::call(uint16_t code, const std::vector<uint8_t>& pa
   auto str = oss.str();
   data.insert(data.begin(), str.begin(), str.end());
 
-  auto result = send("GET", data, timeout);
+  auto result = send("GET", data, probe, timeout);
+  probe.mark(Phase::Body);
 
   data.clear();
 
@@ -174,48 +304,13 @@ http::Response http::Session::call(uint16_t code, const std::vector<uint8_t>& pa
 
   response.data.assign(result.data.begin() + 2, result.data.end());
 
+  probe.finish();
 
   return response;
 }
 
-http::Response http::Session::call(uint16_t code, const std::vector<uint8_t>& payload) { return call(code, payload, timeout_default); }
-http::Response http::Session::call(uint16_t code, const uint8_t* payload, size_t length, std::chrono::milliseconds timeout) {
-  std::vector<uint8_t> vec(&payload[0], &payload[length]);
-  return call(code, vec, timeout);
-}
-http::Response http::Session::call(uint16_t code, const uint8_t* payload, size_t length) { return call(code, payload, length, timeout_default); }
-http::Response http::Session::call(uint16_t code, const std::string& str, std::chrono::milliseconds timeout) {
-  return call(code, reinterpret_cast<const uint8_t*>(str.c_str()), str.length(), timeout);
-}
-http::Response http::Session::call(uint16_t code, const std::string& str) { return call(code, str, timeout_default); }
-http::Response http::Session::call(uint16_t code, const http::StreamBuilder& builder, std::chrono::milliseconds timeout,
-                                   const http::StreamReader& reader) {
-  std::ostringstream ss;
-
-  if (!builder) throw std::invalid_argument("builder is nullptr");
-
-  builder(ss);
-
-  auto result = call(code, ss.str(), timeout);
-
-
-  for (const auto& item : result.data) std::cout << static_cast<int>(item) << " ";
-
-  std::cout << std::endl;
-
-  std::istringstream in(std::string(result.data.begin(), result.data.end()));
-
-  if (reader) {
-    reader(in, result.status);
-  }
-
-  return result;
-}
-
-http::Response http::Session::call(uint16_t code, const http::StreamBuilder& builder, const http::StreamReader& reader) {
-  return call(code, builder, timeout_default, reader);
-}
-http::Response http::Session::send(const std::string& method, const std::vector<uint8_t>& body, const std::chrono::milliseconds timeout) {
+http::Response http::Session::send(const std::string& method, const std::vector<uint8_t>& body, LatencyProbe& probe,
+                                   const std::chrono::milliseconds timeout) {
   const auto stopTime = std::chrono::steady_clock::now() + timeout;
 
 
@@ -224,10 +319,10 @@ http::Response http::Session::send(const std::string& method, const std::vector<
   hints.ai_socktype = SOCK_STREAM;
 
   addrinfo* info;
-  if (getaddrinfo(domain.c_str(), port.c_str(), &hints, &info) != 0)
-    throw std::system_error(WSAGetLastError(), std::system_category(), "Failed to get address info of " + domain);
+  if (auto code = getaddrinfo(domain.c_str(), port.c_str(), &hints, &info); code != 0) throwAddressError(code, domain);
 
   const std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addressInfo{info, freeaddrinfo};
+  probe.mark(Phase::Resolve);
 
   // RFC 7230, 3.1.1. Request Line
   std::string headerData = method + " " + path + " HTTP/1.1\r\n";
@@ -248,6 +343,7 @@ http::Response http::Session::send(const std::string& method, const std::vector<
   // take the first address from the list
   socket.connect(addressInfo->ai_addr, static_cast<socklen_t>(addressInfo->ai_addrlen),
                  (timeout.count() >= 0) ? getRemainingMilliseconds(stopTime) : -1);
+  probe.mark(Phase::Connect);
 
   auto remaining = requestData.size();
   auto sendData = requestData.data();
@@ -258,123 +354,137 @@ http::Response http::Session::send(const std::string& method, const std::vector<
     remaining -= size;
     sendData += size;
   }
+  bytesSent += requestData.size();
+  probe.mark(Phase::Send);
 
   std::array<std::uint8_t, 4096> tempBuffer{};
-  constexpr std::array<std::uint8_t, 2> crlf = {'\r', '\n'};
-  Response response;
-  std::vector<std::uint8_t> responseData;
-  enum class State { parsingStatusLine, parsingHeaders, parsingBody } state = State::parsingStatusLine;
-  bool contentLengthReceived = false;
-  std::size_t contentLength = 0;
-  bool chunkedResponse = false;
-  std::size_t expectedChunkSize = 0;
-  bool removeCrlfAfterChunk = false;
+  ResponseParser parser;
+  bool firstByte = true;
 
   // read the response
   for (;;) {
     const auto size = socket.read(tempBuffer.data(), tempBuffer.size(), (timeout.count() >= 0) ? getRemainingMilliseconds(stopTime) : -1);
-    if (size == 0) return response;
+    if (firstByte) {
+      probe.mark(Phase::FirstByte);
+      firstByte = false;
+    }
+    bytesReceived += size;
+    if (size == 0 || parser.feed(tempBuffer.data(), size)) return parser.take();
+  }
+}
 
-    responseData.insert(responseData.end(), tempBuffer.begin(), tempBuffer.begin() + size);
+// ResponseParser
 
-    if (state != State::parsingBody)
-      for (;;) {
-        const auto i = std::search(responseData.begin(), responseData.end(), crlf.begin(), crlf.end());
+bool http::ResponseParser::feed(const std::uint8_t* data, std::size_t size) {
+  constexpr std::array<std::uint8_t, 2> crlf = {'\r', '\n'};
 
-        if (i == responseData.end()) break;
+  if (complete) return true;
 
-        const std::string line(responseData.begin(), i);
-        responseData.erase(responseData.begin(), i + 2);
+  responseData.insert(responseData.end(), data, data + size);
 
-        if (line.empty()) {
-          state = State::parsingBody;
-          break;
-        } else if (state == State::parsingStatusLine) {
-          state = State::parsingHeaders;
+  if (state != State::parsingBody)
+    for (;;) {
+      const auto i = std::search(responseData.begin(), responseData.end(), crlf.begin(), crlf.end());
 
-          const auto httpEndIterator = std::find(line.begin(), line.end(), ' ');
+      if (i == responseData.end()) break;
 
-          if (httpEndIterator != line.end()) {
-            const auto statusStartIterator = httpEndIterator + 1;
-            const auto statusEndIterator = std::find(statusStartIterator, line.end(), ' ');
-            const std::string status{statusStartIterator, statusEndIterator};
-            response.status = std::stoi(status);
-          }
-        } else if (state == State::parsingHeaders) {
-          const auto colonPosition = line.find(':');
+      const std::string line(responseData.begin(), i);
+      responseData.erase(responseData.begin(), i + 2);
 
-          if (colonPosition == std::string::npos) throw httpResponseError("Invalid header: " + line);
+      if (line.empty()) {
+        state = State::parsingBody;
+        break;
+      } else if (state == State::parsingStatusLine) {
+        state = State::parsingHeaders;
 
-          auto headerName = line.substr(0, colonPosition);
+        const auto httpEndIterator = std::find(line.begin(), line.end(), ' ');
 
-          const auto toLower = [](const char c) { return (c >= 'A' && c <= 'Z') ? c - ('A' - 'a') : c; };
+        if (httpEndIterator != line.end()) {
+          const auto statusStartIterator = httpEndIterator + 1;
+          const auto statusEndIterator = std::find(statusStartIterator, line.end(), ' ');
+          const std::string status{statusStartIterator, statusEndIterator};
+          response.status = std::stoi(status);
+        }
+      } else if (state == State::parsingHeaders) {
+        const auto colonPosition = line.find(':');
 
-          std::transform(headerName.begin(), headerName.end(), headerName.begin(), toLower);
+        if (colonPosition == std::string::npos) throw httpResponseError("Invalid header: " + line);
 
-          auto headerValue = line.substr(colonPosition + 1);
+        auto headerName = line.substr(0, colonPosition);
 
-          const auto isNotWhitespace = [](const char c) { return c != ' ' && c != '\t'; };
+        const auto toLower = [](const char c) { return (c >= 'A' && c <= 'Z') ? c - ('A' - 'a') : c; };
 
-          // ltrim
-          headerValue.erase(headerValue.begin(), std::find_if(headerValue.begin(), headerValue.end(), isNotWhitespace));
+        std::transform(headerName.begin(), headerName.end(), headerName.begin(), toLower);
 
-          // rtrim
-          headerValue.erase(std::find_if(headerValue.rbegin(), headerValue.rend(), isNotWhitespace).base(), headerValue.end());
+        auto headerValue = line.substr(colonPosition + 1);
 
-          if (headerName == "content-length") {
-            contentLength = std::stoul(headerValue);
-            contentLengthReceived = true;
-            response.data.reserve(contentLength);
-          } else if (headerName == "transfer-encoding") {
-            if (headerValue == "chunked")
-              chunkedResponse = true;
-            else
-              throw httpResponseError("Unsupported transfer encoding: " + headerValue);
-          }
-        }
-      }
+        const auto isNotWhitespace = [](const char c) { return c != ' ' && c != '\t'; };
 
-    if (state == State::parsingBody) {
-      if (chunkedResponse) {
-        for (;;) {
-          if (expectedChunkSize > 0) {
-            const auto toWrite = std::min(expectedChunkSize, responseData.size());
-            response.data.insert(response.data.end(), responseData.begin(), responseData.begin() + static_cast<std::ptrdiff_t>(toWrite));
-            responseData.erase(responseData.begin(), responseData.begin() + static_cast<std::ptrdiff_t>(toWrite));
-            expectedChunkSize -= toWrite;
+        // ltrim
+        headerValue.erase(headerValue.begin(), std::find_if(headerValue.begin(), headerValue.end(), isNotWhitespace));
 
-            if (expectedChunkSize == 0) removeCrlfAfterChunk = true;
-            if (responseData.empty()) break;
-          } else {
-            if (removeCrlfAfterChunk) {
-              if (responseData.size() < 2) break;
+        // rtrim
+        headerValue.erase(std::find_if(headerValue.rbegin(), headerValue.rend(), isNotWhitespace).base(), headerValue.end());
 
-              if (!std::equal(crlf.begin(), crlf.end(), responseData.begin())) throw httpResponseError("Invalid chunk");
+        if (headerName == "content-length") {
+          contentLength = std::stoul(headerValue);
+          contentLengthReceived = true;
+          response.data.reserve(contentLength);
+        } else if (headerName == "transfer-encoding") {
+          if (headerValue == "chunked")
+            chunkedResponse = true;
+          else
+            throw httpResponseError("Unsupported transfer encoding: " + headerValue);
+        }
+      }
+    }
 
-              removeCrlfAfterChunk = false;
-              responseData.erase(responseData.begin(), responseData.begin() + 2);
-            }
+  if (state == State::parsingBody) {
+    if (chunkedResponse) {
+      for (;;) {
+        if (expectedChunkSize > 0) {
+          const auto toWrite = std::min(expectedChunkSize, responseData.size());
+          response.data.insert(response.data.end(), responseData.begin(), responseData.begin() + static_cast<std::ptrdiff_t>(toWrite));
+          responseData.erase(responseData.begin(), responseData.begin() + static_cast<std::ptrdiff_t>(toWrite));
+          expectedChunkSize -= toWrite;
+
+          if (expectedChunkSize == 0) removeCrlfAfterChunk = true;
+          if (responseData.empty()) break;
+        } else {
+          if (removeCrlfAfterChunk) {
+            if (responseData.size() < 2) break;
+
+            if (!std::equal(crlf.begin(), crlf.end(), responseData.begin())) throw httpResponseError("Invalid chunk");
+
+            removeCrlfAfterChunk = false;
+            responseData.erase(responseData.begin(), responseData.begin() + 2);
+          }
 
-            const auto i = std::search(responseData.begin(), responseData.end(), crlf.begin(), crlf.end());
+          const auto i = std::search(responseData.begin(), responseData.end(), crlf.begin(), crlf.end());
 
-            if (i == responseData.end()) break;
+          if (i == responseData.end()) break;
 
-            const std::string line(responseData.begin(), i);
-            responseData.erase(responseData.begin(), i + 2);
+          const std::string line(responseData.begin(), i);
+          responseData.erase(responseData.begin(), i + 2);
 
-            expectedChunkSize = std::stoul(line, nullptr, 16);
-            if (expectedChunkSize == 0) return response;
-          }
+          expectedChunkSize = std::stoul(line, nullptr, 16);
+          if (expectedChunkSize == 0) return complete = true;
         }
-      } else {
-        response.data.insert(response.data.end(), responseData.begin(), responseData.end());
-        responseData.clear();
-
-        // got the whole content
-        if (contentLengthReceived && response.data.size() >= contentLength) return response;
       }
+    } else {
+      response.data.insert(response.data.end(), responseData.begin(), responseData.end());
+      responseData.clear();
+
+      // got the whole content
+      if (contentLengthReceived && response.data.size() >= contentLength) return complete = true;
     }
   }
 
-  return response;
+  return false;
+}
+
+http::Response http::ResponseParser::take() {
+  Response result = std::move(response);
+  *this = ResponseParser();
+  return result;
 }
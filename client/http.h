@@ -16,6 +16,7 @@
 #include <system_error>
 #include <vector>
 
+#ifdef _WIN32
 #pragma push_macro("WIN32_LEAN_AND_MEAN")
 #pragma push_macro("NOMINMAX")
 
@@ -30,11 +31,27 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 
-#include <istream>
-
 #pragma comment(lib, "Ws2_32.lib")
 #pragma comment(lib, "Mswsock.lib")
 #pragma comment(lib, "AdvApi32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using SOCKET = int;
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+#endif
+
+#include <istream>
+#include <optional>
+
+#include "latency.h"
 
 namespace http {
 
@@ -51,6 +68,12 @@ class httpResponseError final : public std::logic_error {
   explicit httpResponseError(const std::string& str);
 };
 
+// errno, or WSAGetLastError on Windows
+int lastSocketError();
+// getaddrinfo reports its own EAI_* codes, not errno or the WSA error
+[[noreturn]] void throwAddressError(int code, const std::string& host);
+
+// Starts WinSock; nothing to do elsewhere
 class WSA final {
  private:
   bool is_started = false;
@@ -76,8 +99,14 @@ class Socket final {
 
   Socket& operator=(Socket&& other) noexcept;
   void connect(const struct sockaddr* address, socklen_t address_size, uint64_t ms_timeout);
+  void setNoDelay(bool enabled);
   size_t send(const void* buffer, size_t length, uint64_t timeout);
   size_t read(void* buffer, size_t length, const uint64_t timeout);
+
+  // For event loops that wait on handle() themselves: never block, nullopt if the call would have to
+  [[nodiscard]] SOCKET handle() const { return endpoint; }
+  std::optional<size_t> trySend(const void* buffer, size_t length);
+  std::optional<size_t> tryRead(void* buffer, size_t length);
 };
 
 
@@ -86,25 +115,44 @@ struct Response final {
   std::vector<uint8_t> data;
 };
 
+// Incremental HTTP/1.1 response parser, fed with whatever the socket returned
+class ResponseParser final {
+ private:
+  enum class State { parsingStatusLine, parsingHeaders, parsingBody } state = State::parsingStatusLine;
+  Response response;
+  std::vector<std::uint8_t> responseData;
+  bool contentLengthReceived = false;
+  std::size_t contentLength = 0;
+  bool chunkedResponse = false;
+  std::size_t expectedChunkSize = 0;
+  bool removeCrlfAfterChunk = false;
+  bool complete = false;
+
+ public:
+  // Returns true once the whole response has been received
+  bool feed(const std::uint8_t* data, std::size_t size);
+  Response take();
+};
+
 using StreamBuilder = std::function<void(std::ostringstream& oss)>;
 using StreamReader = std::function<void(std::istringstream& iss, uint16_t error)>;
 
-class Session final {
- private:
-  WSA winSock;
-  std::string host;
-  std::string domain;
-  std::string port;
-  std::string path{"/"};
+enum class TransportKind : uint8_t { Http, Framed, Shm };
 
-  std::chrono::milliseconds timeout_default;
+std::int64_t getRemainingMilliseconds(std::chrono::steady_clock::time_point time) noexcept;
 
-
-  Response send(const std::string& method, const std::vector<uint8_t>& body, std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+// Carries one opcode call to the server; implementations differ only in how the bytes are framed.
+class Transport {
+ protected:
+  std::chrono::milliseconds timeout_default;
+  uint64_t bytesSent{0};
+  uint64_t bytesReceived{0};
 
  public:
-  Session(const std::string& host, const std::string& port, std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
-  Response call(uint16_t code, const std::vector<uint8_t>& payload, std::chrono::milliseconds timeout);
+  explicit Transport(std::chrono::milliseconds timeout);
+  virtual ~Transport() = default;
+
+  virtual Response call(uint16_t code, const std::vector<uint8_t>& payload, std::chrono::milliseconds timeout) = 0;
   Response call(uint16_t code, const std::vector<uint8_t>& payload);
   Response call(uint16_t code, const uint8_t* payload, size_t length, std::chrono::milliseconds timeout);
   Response call(uint16_t code, const uint8_t* payload, size_t length);
@@ -113,6 +161,27 @@ class Session final {
 
   Response call(uint16_t code, const StreamBuilder& builder, std::chrono::milliseconds timeout, const StreamReader& reader = nullptr);
   Response call(uint16_t code, const StreamBuilder& builder, const StreamReader& reader = nullptr);
+
+  [[nodiscard]] uint64_t getBytesSent() const { return bytesSent; }
+  [[nodiscard]] uint64_t getBytesReceived() const { return bytesReceived; }
+};
+
+class Session final : public Transport {
+ private:
+  WSA winSock;
+  std::string host;
+  std::string domain;
+  std::string port;
+  std::string path{"/"};
+
+  Response send(const std::string& method, const std::vector<uint8_t>& body, LatencyProbe& probe,
+                std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+
+ public:
+  using Transport::call;
+
+  Session(const std::string& host, const std::string& port, std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+  Response call(uint16_t code, const std::vector<uint8_t>& payload, std::chrono::milliseconds timeout) override;
 };
 
 }  // namespace http
@@ -0,0 +1,221 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<http::LatencyRecorder>> registry;
+
+struct RecorderLease {
+  http::LatencyRecorder* recorder{nullptr};
+
+  ~RecorderLease() {
+    if (recorder) recorder->inUse.store(false, std::memory_order_release);
+  }
+};
+
+constexpr std::array<double, 5> kPercentiles = {0.5, 0.9, 0.99, 0.999, 1.0};
+constexpr std::array<const char*, 5> kPercentileNames = {"p50", "p90", "p99", "p999", "max"};
+
+size_t slotIndex(uint16_t code, http::Phase phase) {
+  auto op = code < http::kOpcodeCount ? code : 0;
+  return op * http::kPhaseCount + static_cast<size_t>(phase);
+}
+
+}  // namespace
+
+size_t http::latencyBucket(uint64_t us) {
+  if (us < kSubBucketCount) return static_cast<size_t>(us);
+
+  auto msb = 63 - __builtin_clzll(us);
+  auto shift = msb - kSubBucketBits + 1;
+  auto bucket = kSubBucketCount + (shift - 1) * kSubBucketHalf + ((us >> shift) - kSubBucketHalf);
+  return std::min(bucket, kBucketCount - 1);
+}
+
+uint64_t http::latencyBucketValue(size_t bucket) {
+  if (bucket < kSubBucketCount) return bucket;
+
+  auto k = bucket - kSubBucketCount;
+  auto shift = k / kSubBucketHalf + 1;
+  auto mantissa = kSubBucketHalf + k % kSubBucketHalf;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+const char* http::phaseName(Phase phase) {
+  switch (phase) {
+    case Phase::Resolve:
+      return "resolve";
+    case Phase::Connect:
+      return "connect";
+    case Phase::Send:
+      return "send";
+    case Phase::FirstByte:
+      return "ttfb";
+    case Phase::Body:
+      return "body";
+    case Phase::Total:
+      return "total";
+  }
+  return "unknown";
+}
+
+// Histogram
+
+uint64_t http::Histogram::percentile(double q) const {
+  if (total == 0) return 0;
+  if (q >= 1.0) return max;
+
+  auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    seen += counts[i];
+    if (seen >= rank) return std::min(latencyBucketValue(i), max);
+  }
+  return max;
+}
+
+// LatencySnapshot
+
+const http::Histogram& http::LatencySnapshot::get(uint16_t code, Phase phase) const {
+  return histograms[code < kOpcodeCount ? code : 0][static_cast<size_t>(phase)];
+}
+
+std::string http::LatencySnapshot::toText() const {
+  std::ostringstream ss;
+  ss << std::left << std::setw(8) << "opcode" << std::setw(10) << "phase" << std::right << std::setw(10) << "count" << std::setw(10) << "mean";
+  for (auto name : kPercentileNames) ss << std::setw(10) << name;
+  ss << "  (us)\n";
+
+  for (uint16_t code = 0; code < kOpcodeCount; ++code) {
+    for (size_t p = 0; p < kPhaseCount; ++p) {
+      auto& histogram = histograms[code][p];
+      if (histogram.total == 0) continue;
+
+      ss << std::left << std::setw(8) << code << std::setw(10) << phaseName(static_cast<Phase>(p)) << std::right << std::setw(10) << histogram.total
+         << std::setw(10) << static_cast<uint64_t>(histogram.mean());
+      for (auto q : kPercentiles) ss << std::setw(10) << histogram.percentile(q);
+      ss << "\n";
+    }
+  }
+
+  return ss.str();
+}
+
+std::string http::LatencySnapshot::toJson() const {
+  std::ostringstream ss;
+  ss << "{";
+
+  bool firstCode = true;
+  for (uint16_t code = 0; code < kOpcodeCount; ++code) {
+    bool firstPhase = true;
+
+    for (size_t p = 0; p < kPhaseCount; ++p) {
+      auto& histogram = histograms[code][p];
+      if (histogram.total == 0) continue;
+
+      if (firstPhase) {
+        ss << (firstCode ? "" : ",") << "\"" << code << "\":{";
+        firstCode = false;
+      }
+
+      ss << (firstPhase ? "" : ",") << "\"" << phaseName(static_cast<Phase>(p)) << "\":{\"count\":" << histogram.total
+         << ",\"mean\":" << static_cast<uint64_t>(histogram.mean());
+      for (size_t i = 0; i < kPercentiles.size(); ++i) ss << ",\"" << kPercentileNames[i] << "\":" << histogram.percentile(kPercentiles[i]);
+      ss << "}";
+      firstPhase = false;
+    }
+
+    if (!firstPhase) ss << "}";
+  }
+
+  ss << "}";
+  return ss.str();
+}
+
+// LatencyRecorder
+
+http::LatencyRecorder::~LatencyRecorder() {
+  for (auto& slot : slots) delete slot.load(std::memory_order_relaxed);
+}
+
+void http::LatencyRecorder::record(uint16_t code, Phase phase, uint64_t us) {
+  auto& slot = slots[slotIndex(code, phase)];
+  auto counters = slot.load(std::memory_order_relaxed);
+
+  if (counters == nullptr) {
+    counters = new Counters();
+    slot.store(counters, std::memory_order_release);
+  }
+
+  // Only the owning thread writes, so plain load/store pairs are enough
+  auto& bucket = counters->counts[latencyBucket(us)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  counters->sum.store(counters->sum.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+  if (us > counters->max.load(std::memory_order_relaxed)) counters->max.store(us, std::memory_order_relaxed);
+  counters->total.store(counters->total.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void http::LatencyRecorder::mergeInto(LatencySnapshot& snapshot) const {
+  for (uint16_t code = 0; code < kOpcodeCount; ++code) {
+    for (size_t p = 0; p < kPhaseCount; ++p) {
+      auto counters = slots[slotIndex(code, static_cast<Phase>(p))].load(std::memory_order_acquire);
+      if (counters == nullptr) continue;
+
+      auto& histogram = snapshot.histograms[code][p];
+      histogram.total += counters->total.load(std::memory_order_acquire);
+      histogram.sum += counters->sum.load(std::memory_order_relaxed);
+      histogram.max = std::max(histogram.max, counters->max.load(std::memory_order_relaxed));
+      for (size_t i = 0; i < kBucketCount; ++i) histogram.counts[i] += counters->counts[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+http::LatencyRecorder& http::LatencyRecorder::local() {
+  thread_local RecorderLease lease;
+  if (lease.recorder) return *lease.recorder;
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  // Reuse the recorder of a finished thread before allocating a new one
+  for (auto& recorder : registry) {
+    bool expected = false;
+    if (recorder->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      lease.recorder = recorder.get();
+      return *lease.recorder;
+    }
+  }
+
+  registry.emplace_back(std::make_unique<LatencyRecorder>());
+  lease.recorder = registry.back().get();
+  lease.recorder->inUse.store(true, std::memory_order_relaxed);
+  return *lease.recorder;
+}
+
+http::LatencySnapshot http::latencySnapshot() {
+  LatencySnapshot snapshot;
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (auto& recorder : registry) recorder->mergeInto(snapshot);
+  return snapshot;
+}
+
+// LatencyProbe
+
+http::LatencyProbe::LatencyProbe(uint16_t code)
+    : recorder(LatencyRecorder::local()), code(code), start(std::chrono::steady_clock::now()), last(start) {}
+
+void http::LatencyProbe::mark(Phase phase) {
+  auto now = std::chrono::steady_clock::now();
+  recorder.record(code, phase, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - last).count()));
+  last = now;
+}
+
+void http::LatencyProbe::finish() {
+  auto now = std::chrono::steady_clock::now();
+  recorder.record(code, Phase::Total, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - start).count()));
+}
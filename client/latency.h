@@ -0,0 +1,97 @@
+#ifndef CLIENT_LATENCY_H
+#define CLIENT_LATENCY_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace http {
+
+enum class Phase : uint8_t { Resolve = 0, Connect = 1, Send = 2, FirstByte = 3, Body = 4, Total = 5 };
+
+constexpr size_t kPhaseCount = 6;
+constexpr size_t kOpcodeCount = 16;  // opcodes above 15 share slot 0
+
+// Log-linear buckets over microseconds: exact below 32 us, then 16 buckets per power of two (~6% width)
+constexpr int kSubBucketBits = 5;
+constexpr size_t kSubBucketCount = size_t{1} << kSubBucketBits;
+constexpr size_t kSubBucketHalf = kSubBucketCount / 2;
+constexpr size_t kBucketCount = kSubBucketCount + kSubBucketHalf * 40;
+
+size_t latencyBucket(uint64_t us);
+uint64_t latencyBucketValue(size_t bucket);
+
+const char* phaseName(Phase phase);
+
+struct Histogram {
+  std::array<uint64_t, kBucketCount> counts{};
+  uint64_t total{0};
+  uint64_t sum{0};
+  uint64_t max{0};
+
+  [[nodiscard]] uint64_t percentile(double q) const;
+  [[nodiscard]] double mean() const { return total == 0 ? 0 : static_cast<double>(sum) / static_cast<double>(total); }
+};
+
+class LatencySnapshot final {
+ private:
+  std::array<std::array<Histogram, kPhaseCount>, kOpcodeCount> histograms{};
+
+  friend class LatencyRecorder;
+
+ public:
+  [[nodiscard]] const Histogram& get(uint16_t code, Phase phase) const;
+
+  [[nodiscard]] std::string toText() const;
+  [[nodiscard]] std::string toJson() const;
+};
+
+// Single-writer histograms owned by one thread; readers merge them with relaxed loads.
+class LatencyRecorder final {
+ private:
+  struct Counters {
+    std::array<std::atomic<uint64_t>, kBucketCount> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+  };
+
+  std::array<std::atomic<Counters*>, kOpcodeCount * kPhaseCount> slots{};
+
+ public:
+  std::atomic<bool> inUse{false};
+
+  LatencyRecorder() = default;
+  LatencyRecorder(const LatencyRecorder&) = delete;
+  ~LatencyRecorder();
+
+  void record(uint16_t code, Phase phase, uint64_t us);
+  void mergeInto(LatencySnapshot& snapshot) const;
+
+  static LatencyRecorder& local();
+};
+
+LatencySnapshot latencySnapshot();
+
+// Marks consecutive phases of one call; each mark records the time since the previous one.
+class LatencyProbe final {
+ private:
+  LatencyRecorder& recorder;
+  uint16_t code;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point last;
+
+ public:
+  explicit LatencyProbe(uint16_t code);
+
+  void mark(Phase phase);
+  void finish();
+};
+
+}  // namespace http
+
+#endif  // CLIENT_LATENCY_H
@@ -0,0 +1,319 @@
+#include "loopback.h"
+
+#include <algorithm>
+
+#include "movegen.h"
+#include "protocol.h"
+#include "trace.h"
+
+using namespace bura;
+
+namespace {
+
+constexpr size_t kMinCardsInHand = 6;
+
+bool sameCard(const Card &a, const Card &b) { return a.suit == b.suit && a.value == b.value; }
+
+bool holds(const std::vector<Card> &hand, const Card &card) {
+  return std::any_of(hand.begin(), hand.end(), [&](const Card &held) { return sameCard(held, card); });
+}
+
+void removeCards(std::vector<Card> &hand, const std::vector<Card> &cards) {
+  hand.erase(std::remove_if(hand.begin(), hand.end(), [&](const Card &held) { return holds(cards, held); }), hand.end());
+}
+
+}  // namespace
+
+// LocalServer
+
+LocalServer::LocalServer(LocalServerConfig config)
+    : config(config), shards(std::make_unique<Shard[]>(std::max<size_t>(config.shards, 1))), rng(config.seed) {
+  this->config.shards = std::max<size_t>(config.shards, 1);
+}
+
+LocalServer::Player LocalServer::find(const std::string &id) {
+  auto &table = shard(id);
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  auto found = table.players.find(id);
+  return found == table.players.end() ? Player{} : found->second;
+}
+
+std::shared_ptr<LocalServer::Lobby> LocalServer::createLobby() {
+  auto lobby = std::make_shared<Lobby>();
+  for (uint8_t i = 0; i < kDeckSize; ++i) lobby->cards.push_back(Card::fromIndex(i));
+  rng.shuffle(lobby->cards.begin(), lobby->cards.end());
+  lobby->trump = lobby->cards.back();
+  lobby->seats.reserve(2);
+  return lobby;
+}
+
+void LocalServer::giveCards(Lobby &lobby) {
+  bool stillNeed = true;
+
+  while (stillNeed && !lobby.cards.empty()) {
+    stillNeed = false;
+
+    for (auto &seat : lobby.seats) {
+      if (lobby.cards.empty()) break;
+      if (seat.cards.size() < kMinCardsInHand - 1) stillNeed = true;
+
+      if (seat.cards.size() < kMinCardsInHand) {
+        seat.cards.push_back(lobby.cards.front());
+        lobby.cards.erase(lobby.cards.begin());
+      }
+    }
+  }
+}
+
+// The server sorts with a comparator that is not a strict ordering; this keeps its intent:
+// trumps last, weaker cards first
+void LocalServer::sortCards(Lobby &lobby) {
+  const auto trump = lobby.trump.suit;
+  for (auto &seat : lobby.seats) {
+    std::stable_sort(seat.cards.begin(), seat.cards.end(), [trump](const Card &a, const Card &b) {
+      if ((a.suit == trump) != (b.suit == trump)) return b.suit == trump;
+      return a.value > b.value;
+    });
+  }
+}
+
+// What the server's MoveLog timer does, run by the first request after it would have fired
+void LocalServer::settle(Lobby &lobby) {
+  if (lobby.phase != Phase::MoveLog || Clock::now() < lobby.moveLogUntil) return;
+
+  lobby.phase = Phase::Move;
+  for (size_t i = 0; i < lobby.seats.size(); ++i) {
+    if (lobby.seats[i].cards.empty()) {
+      lobby.winner = i;
+      lobby.phase = Phase::Finish;
+      break;
+    }
+  }
+}
+
+int LocalServer::connect(const std::string &id, const std::string &nickname) {
+  Player player;
+  {
+    std::lock_guard<std::mutex> lock(matchmaking);
+    if (!lastLobby) lastLobby = createLobby();
+
+    player.lobby = lastLobby;
+    std::lock_guard<std::mutex> lobbyLock(lastLobby->mutex);
+    player.seat = lastLobby->seats.size();
+    lastLobby->seats.push_back(Seat{id, nickname, {}});
+
+    if (lastLobby->seats.size() == 2) {
+      giveCards(*lastLobby);
+      sortCards(*lastLobby);
+      lastLobby->phase = Phase::Move;
+      lastLobby->playerMove = 0;
+      lastLobby.reset();
+    }
+  }
+
+  auto &table = shard(id);
+  std::lock_guard<std::mutex> lock(table.mutex);
+  table.players[id] = std::move(player);
+  return 0;
+}
+
+int LocalServer::buildState(const std::string &id, std::vector<uint8_t> &reply) {
+  auto player = find(id);
+  if (!player.lobby) return 1;
+
+  auto &lobby = *player.lobby;
+  std::lock_guard<std::mutex> lock(lobby.mutex);
+  settle(lobby);
+
+  const auto &self = lobby.seats[player.seat];
+  const Seat *other = nullptr;
+  for (const auto &seat : lobby.seats)
+    if (seat.id != id) other = &seat;
+
+  // Reused by every request on this thread, so encoding does not allocate once the vectors have grown
+  thread_local GameState state;
+  switch (lobby.phase) {
+    case Phase::Idle:
+      state.status = GameStatus::Idle;
+      break;
+    case Phase::Move:
+      state.status = lobby.playerMove == player.seat ? GameStatus::YourMove : GameStatus::OpponentMove;
+      break;
+    case Phase::Def:
+      state.status = lobby.playerMove == player.seat ? GameStatus::YourDef : GameStatus::OpponentDef;
+      break;
+    case Phase::MoveLog:
+      state.status = GameStatus::MoveLog;
+      break;
+    case Phase::Finish:
+      state.status = lobby.winner == player.seat ? GameStatus::Win : GameStatus::Lose;
+      break;
+  }
+
+  state.trump = lobby.trump;
+  state.inHeap = static_cast<uint8_t>(lobby.cards.size());
+  state.inFall = static_cast<uint8_t>(lobby.fall.size());
+  state.my_cards = self.cards;
+  state.opponent_cards.assign(other ? other->cards.size() : 0, Card());
+  if (other)
+    state.opponentNickname = proto::fromUtf8(other->nickname);
+  else
+    state.opponentNickname.clear();
+  state.attack_cards = lobby.phase == Phase::MoveLog ? lobby.attackHist : lobby.attack;
+  if (lobby.phase == Phase::MoveLog)
+    state.defend_cards = lobby.defendHist;
+  else
+    state.defend_cards.clear();
+
+  proto::StateReply::encode(state, reply);
+  return 0;
+}
+
+int LocalServer::move(const std::string &id, const std::vector<Card> &cards) {
+  auto player = find(id);
+  if (!player.lobby) return 1;
+
+  auto &lobby = *player.lobby;
+  std::lock_guard<std::mutex> lock(lobby.mutex);
+  settle(lobby);
+  if (lobby.phase != Phase::Move) return 2;
+  if (lobby.playerMove != player.seat) return 3;
+  if (lobby.seats.size() < 2) return 5;
+
+  auto &self = lobby.seats[player.seat];
+  if (cards.empty()) return 4;
+  // One card twice would be played once but stay twice on the table
+  auto mask = Card::mask(cards);
+  if (!MoveGen::isAttack(Card::mask(self.cards), mask) || cardCount(mask) != static_cast<int>(cards.size())) return 1;
+
+  lobby.attack = cards;
+  removeCards(self.cards, cards);
+
+  lobby.playerMove = 1 - player.seat;
+  lobby.phase = Phase::Def;
+
+  sortCards(lobby);
+  return 0;
+}
+
+int LocalServer::defend(const std::string &id, bool pass, const std::vector<Card> &cards) {
+  auto player = find(id);
+  if (!player.lobby) return 1;
+
+  auto &lobby = *player.lobby;
+  std::lock_guard<std::mutex> lock(lobby.mutex);
+  settle(lobby);
+  if (lobby.phase != Phase::Def) return 2;
+  if (lobby.playerMove != player.seat) return 3;
+  if (lobby.seats.size() < 2) return 5;
+
+  auto &self = lobby.seats[player.seat];
+  if (pass) {
+    self.cards.insert(self.cards.end(), lobby.attack.begin(), lobby.attack.end());
+    lobby.attackHist = std::move(lobby.attack);
+    lobby.defendHist.clear();
+    lobby.attack.clear();
+    lobby.playerMove = 1 - player.seat;
+  } else {
+    // As with a move, one card twice would beat two attack cards but leave the hand once
+    if (cards.size() != lobby.attack.size() || cardCount(Card::mask(cards)) != static_cast<int>(cards.size())) return 1;
+    if (std::any_of(cards.begin(), cards.end(), [&](const Card &card) { return !holds(self.cards, card); })) return 6;
+
+    if (!MoveGen::beats(cards, lobby.attack, lobby.trump.suit)) return 7;
+
+    lobby.attackHist = lobby.attack;
+    lobby.defendHist = cards;
+
+    removeCards(self.cards, cards);
+    lobby.fall.insert(lobby.fall.end(), lobby.attack.begin(), lobby.attack.end());
+    lobby.fall.insert(lobby.fall.end(), cards.begin(), cards.end());
+
+    lobby.playerMove = player.seat;
+  }
+
+  giveCards(lobby);
+  sortCards(lobby);
+
+  lobby.phase = Phase::MoveLog;
+  lobby.moveLogUntil = Clock::now() + config.moveLogBase + config.moveLogPerCard * static_cast<int64_t>(lobby.attackHist.size());
+  return 0;
+}
+
+int LocalServer::batchFetch(const uint8_t *payload, size_t length, std::vector<uint8_t> &reply) {
+  uint32_t count = 0;
+  if (length >= sizeof(count)) std::memcpy(&count, payload, sizeof(count));
+  count = static_cast<uint32_t>(std::min<size_t>(count, (length - std::min(length, sizeof(count))) / proto::PlayerId::minSize));
+
+  auto offset = reply.size();
+  reply.resize(offset + sizeof(count));
+  std::memcpy(reply.data() + offset, &count, sizeof(count));
+
+  std::string id(proto::PlayerId::minSize, '\0');
+  for (uint32_t i = 0; i < count; ++i) {
+    std::memcpy(id.data(), payload + sizeof(count) + i * proto::PlayerId::minSize, proto::PlayerId::minSize);
+
+    // u16 code + u32 length, filled in once the state is written behind them
+    auto meta = reply.size();
+    reply.resize(meta + sizeof(uint16_t) + sizeof(uint32_t));
+    auto code = static_cast<uint16_t>(buildState(id, reply));
+    auto size = static_cast<uint32_t>(reply.size() - meta - sizeof(uint16_t) - sizeof(uint32_t));
+
+    std::memcpy(reply.data() + meta, &code, sizeof(code));
+    std::memcpy(reply.data() + meta + sizeof(code), &size, sizeof(size));
+  }
+
+  return 0;
+}
+
+int LocalServer::handle(uint16_t code, const uint8_t *payload, size_t length, std::vector<uint8_t> &reply) {
+  TRACE_SCOPE("LocalServer::handle");
+  if (length < proto::PlayerId::minSize) return 1;
+
+  const std::string id(reinterpret_cast<const char *>(payload), proto::PlayerId::minSize);
+  switch (code) {
+    case 2: {
+      proto::Connect request;
+      if (!proto::ConnectRequest::decode(payload, length, request)) return 1;
+      return connect(id, request.nickname);
+    }
+    case 3:
+      return buildState(id, reply);
+    case 4: {
+      proto::Move request;
+      if (!proto::MoveRequest::decode(payload, length, request)) return 1;
+      return move(id, request.cards);
+    }
+    case 5: {
+      proto::Pass pass;
+      if (!proto::PassRequest::decode(payload, length, pass)) return 1;
+      if (pass.defend == 0) return defend(id, true, {});
+
+      proto::Defend request;
+      if (!proto::DefendRequest::decode(payload, length, request)) return 1;
+      return defend(id, false, request.cards);
+    }
+    case 8:
+      return batchFetch(payload + proto::PlayerId::minSize, length - proto::PlayerId::minSize, reply);
+    default:
+      return 1;
+  }
+}
+
+http::Response LocalServer::handle(uint16_t code, const uint8_t *payload, size_t length) {
+  http::Response response;
+  response.status = handle(code, payload, length, response.data);
+  return response;
+}
+
+// LoopbackTransport
+
+http::LoopbackTransport::LoopbackTransport(std::shared_ptr<bura::LocalServer> server)
+    : Transport(std::chrono::milliseconds{-1}), server(std::move(server)) {}
+
+http::Response http::LoopbackTransport::call(uint16_t code, const std::vector<uint8_t> &payload, std::chrono::milliseconds) {
+  bytesSent += sizeof(code) + payload.size();
+  auto response = server->handle(code, payload.data(), payload.size());
+  bytesReceived += sizeof(uint16_t) + response.data.size();
+  return response;
+}
@@ -0,0 +1,164 @@
+#ifndef CLIENT_LOOPBACK_H
+#define CLIENT_LOOPBACK_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "game.h"
+#include "http.h"
+#include "rng.h"
+#include "strategy.h"
+
+// The game server in the same process: a C++ port of the lobby and game rules of server/src/requests.ts behind a
+// Transport, so BuraClient tests and bot evaluation run without sockets or the Node server.
+
+namespace bura {
+
+struct LocalServerConfig {
+  // The server shows MoveLog for moveLogBase + moveLogPerCard * attack cards; zero ends it on the next request
+  std::chrono::milliseconds moveLogBase{1000};
+  std::chrono::milliseconds moveLogPerCard{2000};
+  uint64_t seed{threadRng()()};
+  size_t shards{64};  // player tables, each behind its own mutex
+};
+
+// Safe to call from many threads: players are spread over shards by id and every lobby has its own mutex,
+// so requests of different games only meet in matchmaking.
+class LocalServer final {
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Lobby status as the server keeps it; buildState turns it into the player's GameStatus
+  enum struct Phase : uint8_t { Idle, Move, Def, MoveLog, Finish };
+
+  struct Seat {
+    std::string id;
+    std::string nickname;
+    std::vector<Card> cards;
+  };
+
+  struct Lobby {
+    std::mutex mutex;
+    Phase phase{Phase::Idle};
+    std::vector<Card> cards;
+    std::vector<Card> fall;
+    std::vector<Card> attack;
+    std::vector<Card> attackHist;
+    std::vector<Card> defendHist;
+    Card trump;
+    std::vector<Seat> seats;
+    size_t playerMove{0};
+    size_t winner{0};
+    Clock::time_point moveLogUntil{};
+  };
+
+  struct Player {
+    std::shared_ptr<Lobby> lobby;
+    size_t seat{0};
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, Player> players;
+  };
+
+  LocalServerConfig config;
+  std::unique_ptr<Shard[]> shards;
+
+  std::mutex matchmaking;
+  Rng rng;
+  std::shared_ptr<Lobby> lastLobby;
+
+  Shard &shard(const std::string &id) { return shards[std::hash<std::string>{}(id) % config.shards]; }
+  Player find(const std::string &id);
+
+  std::shared_ptr<Lobby> createLobby();
+  static void giveCards(Lobby &lobby);
+  static void sortCards(Lobby &lobby);
+  static void settle(Lobby &lobby);
+
+  int connect(const std::string &id, const std::string &nickname);
+  int buildState(const std::string &id, std::vector<uint8_t> &reply);
+  int move(const std::string &id, const std::vector<Card> &cards);
+  int defend(const std::string &id, bool pass, const std::vector<Card> &cards);
+  int batchFetch(const uint8_t *payload, size_t length, std::vector<uint8_t> &reply);
+
+ public:
+  explicit LocalServer(LocalServerConfig config = {});
+
+  // One request as the server's RequestHandler sees it: payload starts with the 8-byte player id.
+  // Appends the reply data to `reply` and returns the status code.
+  int handle(uint16_t code, const uint8_t *payload, size_t length, std::vector<uint8_t> &reply);
+  http::Response handle(uint16_t code, const uint8_t *payload, size_t length);
+};
+
+}  // namespace bura
+
+namespace http {
+
+class LoopbackTransport final : public Transport {
+ private:
+  std::shared_ptr<bura::LocalServer> server;
+
+ public:
+  using Transport::call;
+
+  explicit LoopbackTransport(std::shared_ptr<bura::LocalServer> server);
+  Response call(uint16_t code, const std::vector<uint8_t> &payload, std::chrono::milliseconds timeout) override;
+};
+
+}  // namespace http
+
+namespace bura {
+
+// Plays one game between two strategies on the server, both clients fetching in turn instead of polling.
+// Returns the final status of the first player (Win or Lose), None if nobody won within maxRounds.
+template <typename First, typename Second>
+GameStatus playLocalGame(const std::shared_ptr<LocalServer> &server, First &first, Second &second, size_t maxRounds = 10000) {
+  BuraClient clients[2];
+  clients[0].start(std::make_unique<http::LoopbackTransport>(server));
+  clients[1].start(std::make_unique<http::LoopbackTransport>(server));
+  clients[0].connect("First");
+  clients[1].connect("Second");
+
+  StrategyDriver<First> firstDriver(first);
+  StrategyDriver<Second> secondDriver(second);
+
+  const auto turn = [](BuraClient &client, auto &driver) {
+    auto current = client.fetch();
+    auto action = driver.next(current);
+
+    switch (action.kind) {
+      case Action::Kind::None:
+      case Action::Kind::End:
+        return current.status;
+      case Action::Kind::Move:
+        client.finishMove(std::move(action.cards));
+        break;
+      case Action::Kind::Defend:
+        client.finishDef(std::move(action.cards));
+        break;
+      case Action::Kind::Pass:
+        client.passDef();
+        break;
+    }
+    driver.sent();
+    return current.status;
+  };
+
+  for (size_t i = 0; i < maxRounds; ++i) {
+    auto status = turn(clients[0], firstDriver);
+    turn(clients[1], secondDriver);
+    if (status == GameStatus::Win || status == GameStatus::Lose) return status;
+  }
+  return GameStatus::None;
+}
+
+}  // namespace bura
+
+#endif  // CLIENT_LOOPBACK_H
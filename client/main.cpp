@@ -1,11 +1,23 @@
 #include <iostream>
 #include "console_client.cpp"
 #include "bot_client.cpp"
+#include "framed.h"
+
+int main(int argc, char* argv[]) {
+    const char* tracePath = std::getenv("BURA_TRACE");
+    if(tracePath) trace::enable();
+
+    if(argc > 2 && std::string(argv[1]) == "replay") {
+        BuraConsole console("", "");
+        console.replay(argv[2], argc > 3 ? std::stoul(argv[3]) : 0);
+        return 0;
+    }
 
-int main() {
     int bot = -1;
     std::unique_ptr<BuraBot> bot_instance;
+    std::shared_ptr<record::GameRecorder> recorder;
     std::string ip{"cards.igerbit.ru"};
+    http::TransportKind transport = http::TransportKind::Http;
 
     std::string answer;
 
@@ -14,6 +26,17 @@ int main() {
     if(!answer.empty()) ip = answer;
 
 
+    std::cout << "Transport (http/tcp | default: http): ";
+    std::getline(std::cin, answer);
+    if(answer == "tcp") transport = http::TransportKind::Framed;
+    std::string port = http::defaultPort(transport);
+
+    std::cout << "Colors (truecolor/256/16 | default: truecolor): ";
+    std::getline(std::cin, answer);
+    ColorMode colorMode = ColorMode::TrueColor;
+    if(answer == "256") colorMode = ColorMode::Palette256;
+    if(answer == "16") colorMode = ColorMode::Palette16;
+
     while (bot == -1) {
         std::cout << "Enable bot (Y/N | default: Yes): ";
         std::getline(std::cin, answer);
@@ -21,10 +44,21 @@ int main() {
         if(answer == "Y") bot = 1;
     }
 
-    BuraConsole console(ip, "2021");
+    std::cout << "Record games to file (default: none): ";
+    std::getline(std::cin, answer);
+    if(!answer.empty()) recorder = std::make_shared<record::GameRecorder>(answer);
+
+    auto pollScheduler = std::make_shared<PollScheduler>();
+
+    BuraConsole console(ip, port, transport);
+    console.setRecorder(recorder);
+    console.setColorMode(colorMode);
+    console.setPollScheduler(pollScheduler);
 
     if(bot == 1) {
-        bot_instance = std::make_unique<BuraBot>(ip, "2021");
+        bot_instance = std::make_unique<BuraBot>(ip, port, transport);
+        bot_instance->setRecorder(recorder);
+        bot_instance->setPollScheduler(pollScheduler);
         bot_instance->launch();
     }
 
@@ -38,5 +72,9 @@ int main() {
         bot_instance->join();
     }
 
+    std::cout << pollScheduler->report() << std::endl;
+
+    if(tracePath) trace::writeChrome(tracePath);
+
     return 0;
 }
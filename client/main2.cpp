@@ -1,18 +1,44 @@
 #include <iostream>
 #include "bot_client.cpp"
+#include "framed.h"
 
 
 int main(int argc, char* argv[]) {
+    const char* tracePath = std::getenv("BURA_TRACE");
+    if(tracePath) trace::enable();
+
+    // Metrics go to stderr on SIGUSR1, and to scrapers on the Unix socket BURA_METRICS if it is set
+    std::unique_ptr<metrics::Exporter> exporter;
+    try {
+        const char* metricsPath = std::getenv("BURA_METRICS");
+        exporter = std::make_unique<metrics::Exporter>(metricsPath ? metricsPath : "");
+    } catch(std::exception& err) {
+        std::cout << err.what() << std::endl;
+        return 1;
+    }
 
     bool bot = true;
     std::unique_ptr<BuraBot> bot_instance;
+    size_t farmSize = 0;
     bool startServer = true;
     std::string ip{"127.0.0.1"};
+    http::TransportKind transport = http::TransportKind::Http;
 
     if(argc > 1) {
         if(std::string(argv[1]) == "host") {
             bot = false;
         }
+        else if(std::string(argv[1]) == "tcp") {
+            transport = http::TransportKind::Framed;
+        }
+        else if(std::string(argv[1]) == "shm") {
+            transport = http::TransportKind::Shm;
+        }
+        else if(std::string(argv[1]) == "farm" && argc > 2) {
+            bot = false;
+            farmSize = std::stoul(argv[2]);
+            if(argc > 3 && std::string(argv[3]) == "tcp") transport = http::TransportKind::Framed;
+        }
         else {
             ip = std::string(argv[1]);
             bot = false;
@@ -21,8 +47,24 @@ int main(int argc, char* argv[]) {
     }
 
 
+    // Shared by every bot of this process
+    auto decisionCache = std::make_shared<DecisionCache>();
+
+    // Evaluator weights written by client_trainer, mapped once for every bot
+    std::shared_ptr<const EvalWeights> weights;
+    if(const char* weightsPath = std::getenv("BURA_WEIGHTS")) {
+        try {
+            weights = std::make_shared<const EvalWeights>(std::string(weightsPath));
+        } catch(std::exception& err) {
+            std::cout << err.what() << std::endl;
+            return 1;
+        }
+    }
+
     if(bot) {
-        bot_instance = std::make_unique<BuraBot>(ip, "2021");
+        bot_instance = std::make_unique<BuraBot>(ip, http::defaultPort(transport), transport);
+        bot_instance->setDecisionCache(decisionCache);
+        bot_instance->setWeights(weights);
         bot_instance->launch();
     }
 
@@ -31,5 +73,23 @@ int main(int argc, char* argv[]) {
         bot_instance->join();
     }
 
+    // Bot farm: every bot is a task on a small worker pool and polls through one scheduler, which sends their
+    // fetches as batches
+    if(farmSize > 0) {
+        auto scheduler = std::make_shared<FetchScheduler>(ip, http::defaultPort(transport), transport);
+        auto pollScheduler = std::make_shared<PollScheduler>();
+        TaskPool pool;
+
+        for(size_t i = 0; i < farmSize; ++i) pool.spawn(std::make_unique<BuraBotTask>(pool, scheduler, pollScheduler, decisionCache, weights));
+        pool.join();
+
+        std::cout << "fetches: " << scheduler->getFetches() << ", batches: " << scheduler->getBatches() << std::endl;
+        std::cout << "workers: " << pool.size() << ", resumes: " << pool.getResumes() << ", steals: " << pool.getSteals() << std::endl;
+        std::cout << pollScheduler->report() << std::endl;
+        std::cout << decisionCache->report() << std::endl;
+    }
+
+    if(tracePath) trace::writeChrome(tracePath);
+
     return 0;
 }
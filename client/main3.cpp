@@ -0,0 +1,54 @@
+#include <iostream>
+#include "terminal_client.cpp"
+
+int main() {
+    const char* tracePath = std::getenv("BURA_TRACE");
+    if(tracePath) trace::enable();
+
+    std::shared_ptr<record::GameRecorder> recorder;
+    std::string ip{"cards.igerbit.ru"};
+    std::string port = http::defaultPort(http::TransportKind::Framed);
+
+    std::string answer;
+
+    std::cout << "Ip (default: " << ip << "): ";
+    std::getline(std::cin, answer);
+    if(!answer.empty()) ip = answer;
+
+    std::cout << "Port (default: " << port << "): ";
+    std::getline(std::cin, answer);
+    if(!answer.empty()) port = answer;
+
+    std::cout << "Colors (truecolor/256/16 | default: truecolor): ";
+    std::getline(std::cin, answer);
+    ColorMode colorMode = ColorMode::TrueColor;
+    if(answer == "256") colorMode = ColorMode::Palette256;
+    if(answer == "16") colorMode = ColorMode::Palette16;
+
+    std::cout << "Record games to file (default: none): ";
+    std::getline(std::cin, answer);
+    if(!answer.empty()) recorder = std::make_shared<record::GameRecorder>(answer);
+
+    std::string nickname;
+    std::cout << "Enter your nickname: ";
+    std::getline(std::cin, nickname);
+
+    auto pollScheduler = std::make_shared<PollScheduler>();
+
+    BuraTerminal terminal(ip, port);
+    terminal.setRecorder(recorder);
+    terminal.setColorMode(colorMode);
+    terminal.setPollScheduler(pollScheduler);
+    try {
+        terminal.launch(nickname);
+    } catch(std::exception& err) {
+        std::cout << err.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << pollScheduler->report() << std::endl;
+
+    if(tracePath) trace::writeChrome(tracePath);
+
+    return 0;
+}
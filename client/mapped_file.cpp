@@ -0,0 +1,138 @@
+#include "mapped_file.h"
+
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif  // WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif  // NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+using namespace bura;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) {
+  fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (fileHandle == INVALID_HANDLE_VALUE) {
+    fileHandle = nullptr;
+    throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Failed to open " + path);
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(fileHandle, &fileSize)) {
+    auto error = static_cast<int>(GetLastError());
+    close();
+    throw std::system_error(error, std::system_category(), "Failed to get size of " + path);
+  }
+
+  length = static_cast<size_t>(fileSize.QuadPart);
+  if (length == 0) return;
+
+  mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappingHandle == nullptr) {
+    auto error = static_cast<int>(GetLastError());
+    close();
+    throw std::system_error(error, std::system_category(), "Failed to map " + path);
+  }
+
+  data = static_cast<const uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+  if (data == nullptr) {
+    auto error = static_cast<int>(GetLastError());
+    close();
+    throw std::system_error(error, std::system_category(), "Failed to map view of " + path);
+  }
+}
+
+void MappedFile::close() noexcept {
+  if (data != nullptr) UnmapViewOfFile(data);
+  if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+  if (fileHandle != nullptr) CloseHandle(fileHandle);
+  data = nullptr;
+  mappingHandle = nullptr;
+  fileHandle = nullptr;
+  length = 0;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data{other.data}, length{other.length}, fileHandle{other.fileHandle}, mappingHandle{other.mappingHandle} {
+  other.data = nullptr;
+  other.length = 0;
+  other.fileHandle = nullptr;
+  other.mappingHandle = nullptr;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (&other == this) return *this;
+  close();
+  data = std::exchange(other.data, nullptr);
+  length = std::exchange(other.length, 0);
+  fileHandle = std::exchange(other.fileHandle, nullptr);
+  mappingHandle = std::exchange(other.mappingHandle, nullptr);
+  return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) throw std::system_error(errno, std::system_category(), "Failed to open " + path);
+
+  struct stat info {};
+  if (fstat(fd, &info) == -1) {
+    auto error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::system_category(), "Failed to get size of " + path);
+  }
+
+  length = static_cast<size_t>(info.st_size);
+
+  if (length > 0) {
+    void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      auto error = errno;
+      ::close(fd);
+      length = 0;
+      throw std::system_error(error, std::system_category(), "Failed to map " + path);
+    }
+    madvise(address, length, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t *>(address);
+  }
+
+  ::close(fd);
+}
+
+void MappedFile::close() noexcept {
+  if (data != nullptr) munmap(const_cast<uint8_t *>(data), length);
+  data = nullptr;
+  length = 0;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept : data{other.data}, length{other.length} {
+  other.data = nullptr;
+  other.length = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (&other == this) return *this;
+  close();
+  data = std::exchange(other.data, nullptr);
+  length = std::exchange(other.length, 0);
+  return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() { close(); }
@@ -0,0 +1,37 @@
+#ifndef CLIENT_MAPPED_FILE_H
+#define CLIENT_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bura {
+
+// Read-only memory mapping of a whole file.
+class MappedFile final {
+ private:
+  const uint8_t *data{nullptr};
+  size_t length{0};
+#ifdef _WIN32
+  void *fileHandle{nullptr};
+  void *mappingHandle{nullptr};
+#endif
+
+  void close() noexcept;
+
+ public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &path);
+  MappedFile(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  [[nodiscard]] const uint8_t *begin() const { return data; }
+  [[nodiscard]] const uint8_t *end() const { return data + length; }
+  [[nodiscard]] size_t size() const { return length; }
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_MAPPED_FILE_H
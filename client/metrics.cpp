@@ -0,0 +1,285 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <system_error>
+#endif
+
+using namespace bura;
+using namespace bura::metrics;
+
+namespace {
+
+void writeSeries(std::ostringstream &ss, const std::string &name, const std::string &labels, const std::string &extra = "") {
+  ss << name;
+  if (labels.empty() && extra.empty()) return;
+  ss << '{' << labels << (labels.empty() || extra.empty() ? "" : ",") << extra << '}';
+}
+
+}  // namespace
+
+Registry::Series &Registry::find(const std::string &name, const std::string &help, Type type, const std::string &labels) {
+  auto family = std::find_if(families.begin(), families.end(), [&](const Family &item) { return item.name == name; });
+  if (family == families.end()) {
+    families.push_back({name, help, type, {}});
+    family = families.end() - 1;
+  } else if (family->type != type) {
+    throw std::invalid_argument("Metric " + name + " registered with another type");
+  }
+
+  auto series = std::find_if(family->series.begin(), family->series.end(), [&](const Series &item) { return item.labels == labels; });
+  if (series != family->series.end()) return *series;
+
+  family->series.push_back({labels, nullptr, nullptr, nullptr});
+  auto &created = family->series.back();
+  if (type == Type::Counter) created.counter = std::make_unique<Counter>();
+  if (type == Type::Gauge) created.gauge = std::make_unique<Gauge>();
+  if (type == Type::Histogram) created.histogram = std::make_unique<Histogram>();
+  return created;
+}
+
+Counter &Registry::counter(const std::string &name, const std::string &help, const std::string &labels) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return *find(name, help, Type::Counter, labels).counter;
+}
+
+Gauge &Registry::gauge(const std::string &name, const std::string &help, const std::string &labels) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return *find(name, help, Type::Gauge, labels).gauge;
+}
+
+Histogram &Registry::histogram(const std::string &name, const std::string &help, const std::string &labels) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return *find(name, help, Type::Histogram, labels).histogram;
+}
+
+std::string Registry::text() const {
+  static const char *kTypeNames[] = {"counter", "gauge", "histogram"};
+  std::ostringstream ss;
+  ss << std::setprecision(10);
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (const auto &family : families) {
+    ss << "# HELP " << family.name << ' ' << family.help << '\n';
+    ss << "# TYPE " << family.name << ' ' << kTypeNames[static_cast<size_t>(family.type)] << '\n';
+
+    for (const auto &series : family.series) {
+      if (series.counter) {
+        writeSeries(ss, family.name, series.labels);
+        ss << ' ' << series.counter->get() << '\n';
+      } else if (series.gauge) {
+        writeSeries(ss, family.name, series.labels);
+        ss << ' ' << series.gauge->get() << '\n';
+      } else {
+        // _count is the sum of the buckets as read, so the two agree within a scrape
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket < Histogram::kBucketCount; ++bucket) {
+          cumulative += series.histogram->count(bucket);
+          auto bound = Histogram::bound(bucket);
+          std::ostringstream le;
+          if (bound == 0)
+            le << "le=\"+Inf\"";
+          else
+            le << std::setprecision(10) << "le=\"" << static_cast<double>(bound) * 1e-9 << '"';
+          writeSeries(ss, family.name + "_bucket", series.labels, le.str());
+          ss << ' ' << cumulative << '\n';
+        }
+        writeSeries(ss, family.name + "_sum", series.labels);
+        ss << ' ' << static_cast<double>(series.histogram->total()) * 1e-9 << '\n';
+        writeSeries(ss, family.name + "_count", series.labels);
+        ss << ' ' << cumulative << '\n';
+      }
+    }
+  }
+  return ss.str();
+}
+
+Registry &Registry::global() {
+  static Registry registry;
+  return registry;
+}
+
+ClientMetrics &ClientMetrics::get() {
+  static ClientMetrics metrics = [] {
+    auto &registry = Registry::global();
+    return ClientMetrics{
+        registry.counter("bura_games_total", "Games played to the end"),
+        registry.counter("bura_game_results_total", "Finished games by result", "result=\"win\""),
+        registry.counter("bura_game_results_total", "Finished games by result", "result=\"lose\""),
+        registry.counter("bura_fetches_total", "Game states fetched"),
+        registry.counter("bura_actions_total", "Decisions by kind", "kind=\"move\""),
+        registry.counter("bura_actions_total", "Decisions by kind", "kind=\"defend\""),
+        registry.counter("bura_actions_total", "Decisions by kind", "kind=\"pass\""),
+        registry.counter("bura_errors_total", "Failed calls by type", "type=\"transport\""),
+        registry.counter("bura_errors_total", "Failed calls by type", "type=\"protocol\""),
+        registry.counter("bura_errors_total", "Failed calls by type", "type=\"rejected\""),
+        registry.counter("bura_reconnects_total", "Connections opened again after the previous one was lost"),
+        registry.gauge("bura_bots", "Bots playing"),
+        registry.gauge("bura_scheduler_queue_depth", "Fetches and calls waiting for the fetch scheduler"),
+        registry.gauge("bura_task_queue_depth", "Runnable bot tasks waiting for a worker"),
+        registry.histogram("bura_decision_seconds", "Time to choose a move or defence"),
+    };
+  }();
+  return metrics;
+}
+
+#ifdef _WIN32
+
+Exporter::Exporter(std::string socketPath) : path(std::move(socketPath)) {}
+
+Exporter::~Exporter() = default;
+
+void Exporter::run() {}
+
+void Exporter::serve(int) const {}
+
+#else
+
+namespace {
+
+// The write end of the running exporter's pipe, for the signal handler
+std::atomic<int> signalPipe{-1};
+struct sigaction previousAction {};
+
+void onSignal(int) {
+  const auto saved = errno;
+  auto fd = signalPipe.load(std::memory_order_relaxed);
+  if (fd >= 0) {
+    [[maybe_unused]] auto written = ::write(fd, "d", 1);
+  }
+  errno = saved;
+}
+
+[[noreturn]] void fail(const std::string &what) { throw std::system_error(errno, std::system_category(), what); }
+
+void sendAll(int fd, const std::string &data) {
+  for (size_t sent = 0; sent < data.size();) {
+    auto size = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (size <= 0) return;
+    sent += static_cast<size_t>(size);
+  }
+}
+
+}  // namespace
+
+Exporter::Exporter(std::string socketPath) : path(std::move(socketPath)) {
+  if (::pipe(wakeup.data()) != 0) fail("Failed to create pipe");
+  for (auto fd : wakeup) ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  ::fcntl(wakeup[1], F_SETFL, O_NONBLOCK);
+
+  try {
+    if (!path.empty()) {
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      if (path.size() >= sizeof(address.sun_path)) throw std::invalid_argument("Socket path too long: " + path);
+      std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+      // A socket left behind by an earlier process, but nothing else, is replaced
+      struct stat info {};
+      if (::lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) ::unlink(path.c_str());
+
+      listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (listener < 0) fail("Failed to create socket");
+      if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) fail("Failed to bind " + path);
+      ::chmod(path.c_str(), 0600);
+      if (::listen(listener, 16) != 0) fail("Failed to listen on " + path);
+    }
+  } catch (...) {
+    if (listener >= 0) ::close(listener);
+    for (auto fd : wakeup) ::close(fd);
+    throw;
+  }
+
+  signalPipe.store(wakeup[1], std::memory_order_relaxed);
+  struct sigaction action {};
+  action.sa_handler = onSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  ::sigaction(SIGUSR1, &action, &previousAction);
+
+  worker = std::thread(&Exporter::run, this);
+}
+
+Exporter::~Exporter() {
+  ::sigaction(SIGUSR1, &previousAction, nullptr);
+  signalPipe.store(-1, std::memory_order_relaxed);
+
+  [[maybe_unused]] auto written = ::write(wakeup[1], "q", 1);
+  worker.join();
+
+  if (listener >= 0) {
+    ::close(listener);
+    ::unlink(path.c_str());
+  }
+  for (auto fd : wakeup) ::close(fd);
+}
+
+void Exporter::run() {
+  std::array<pollfd, 2> fds{pollfd{wakeup[0], POLLIN, 0}, pollfd{listener, POLLIN, 0}};
+  const nfds_t count = listener >= 0 ? 2 : 1;
+
+  while (true) {
+    if (::poll(fds.data(), count, -1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      char commands[16];
+      auto size = ::read(wakeup[0], commands, sizeof(commands));
+      for (ssize_t i = 0; i < size; ++i) {
+        if (commands[i] == 'q') return;
+      }
+      if (size > 0) std::cerr << Registry::global().text() << std::flush;
+    }
+
+    if (count > 1 && (fds[1].revents & POLLIN)) {
+      auto client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client < 0) continue;
+      serve(client);
+      ::close(client);
+    }
+  }
+}
+
+void Exporter::serve(int client) const {
+  // A scraper sends a request; a plain `nc -U` or `socat` client may send nothing, and gets the text after a moment
+  std::string request;
+  char buffer[1024];
+  pollfd ready{client, POLLIN, 0};
+  while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos && request.size() < 8192) {
+    if (::poll(&ready, 1, 100) <= 0) break;
+    auto size = ::recv(client, buffer, sizeof(buffer), 0);
+    if (size <= 0) break;
+    request.append(buffer, static_cast<size_t>(size));
+  }
+
+  timeval timeout{1, 0};
+  ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  auto body = Registry::global().text();
+  if (request.compare(0, 4, "GET ") == 0) {
+    std::ostringstream header;
+    header << "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " << body.size()
+           << "\r\nConnection: close\r\n\r\n";
+    sendAll(client, header.str());
+  }
+  sendAll(client, body);
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef CLIENT_METRICS_H
+#define CLIENT_METRICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Process metrics for long-running bots: counters, gauges and histograms that threads update with relaxed
+// atomics, registered once by name and exported in the Prometheus text format. An Exporter serves that text on
+// a Unix domain socket and writes it to stderr on SIGUSR1.
+
+namespace bura::metrics {
+
+class alignas(64) Counter final {
+ private:
+  std::atomic<uint64_t> count{0};
+
+ public:
+  void add(uint64_t n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+  [[nodiscard]] uint64_t get() const { return count.load(std::memory_order_relaxed); }
+};
+
+class alignas(64) Gauge final {
+ private:
+  std::atomic<int64_t> current{0};
+
+ public:
+  void set(int64_t value) { current.store(value, std::memory_order_relaxed); }
+  void add(int64_t n = 1) { current.fetch_add(n, std::memory_order_relaxed); }
+  void sub(int64_t n = 1) { current.fetch_sub(n, std::memory_order_relaxed); }
+  [[nodiscard]] int64_t get() const { return current.load(std::memory_order_relaxed); }
+};
+
+// Durations in nanoseconds, bucketed by powers of two from 256 ns to about a second, exported in seconds
+class alignas(64) Histogram final {
+ public:
+  static constexpr int kFirstShift = 8;
+  static constexpr size_t kBucketCount = 24;  // the last one is +Inf
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> counts{};
+  std::atomic<uint64_t> sum{0};
+
+ public:
+  static size_t bucket(uint64_t ns) {
+    if (ns <= (uint64_t{1} << kFirstShift)) return 0;
+    auto shift = static_cast<size_t>(64 - __builtin_clzll(ns - 1));
+    return std::min(shift - kFirstShift, kBucketCount - 1);
+  }
+  // Upper bound of a bucket in nanoseconds, 0 for +Inf
+  static uint64_t bound(size_t bucket) { return bucket + 1 < kBucketCount ? uint64_t{1} << (bucket + kFirstShift) : 0; }
+
+  void observe(uint64_t ns) {
+    counts[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ns, std::memory_order_relaxed);
+  }
+  void observe(std::chrono::steady_clock::duration duration) {
+    observe(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+  }
+
+  [[nodiscard]] uint64_t count(size_t bucket) const { return counts[bucket].load(std::memory_order_relaxed); }
+  [[nodiscard]] uint64_t total() const { return sum.load(std::memory_order_relaxed); }
+};
+
+// Times a scope into a histogram
+class Timer final {
+ private:
+  Histogram &histogram;
+  std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+
+ public:
+  explicit Timer(Histogram &histogram) : histogram(histogram) {}
+  Timer(const Timer &) = delete;
+  ~Timer() { histogram.observe(std::chrono::steady_clock::now() - start); }
+};
+
+// Metrics by name and labels (`key="value",...`). Registering takes a lock and returns the same object for the
+// same name and labels, so callers keep the reference; updates never lock. Objects live as long as the registry.
+class Registry final {
+ private:
+  enum struct Type : uint8_t { Counter, Gauge, Histogram };
+
+  struct Series {
+    std::string labels;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+  };
+
+  struct Family {
+    std::string name;
+    std::string help;
+    Type type;
+    std::vector<Series> series;
+  };
+
+  mutable std::mutex mutex;
+  std::vector<Family> families;
+
+  Series &find(const std::string &name, const std::string &help, Type type, const std::string &labels);
+
+ public:
+  Counter &counter(const std::string &name, const std::string &help, const std::string &labels = "");
+  Gauge &gauge(const std::string &name, const std::string &help, const std::string &labels = "");
+  Histogram &histogram(const std::string &name, const std::string &help, const std::string &labels = "");
+
+  // Text exposition format 0.0.4
+  [[nodiscard]] std::string text() const;
+
+  static Registry &global();
+};
+
+// What the bots of this process count, in Registry::global()
+struct ClientMetrics {
+  Counter &games;
+  Counter &wins;
+  Counter &losses;
+  Counter &fetches;
+  Counter &moves;
+  Counter &defences;
+  Counter &passes;
+  Counter &transportErrors;
+  Counter &protocolErrors;  // replies that do not parse
+  Counter &rejected;  // actions the server answered with an error status
+  Counter &reconnects;
+  Gauge &bots;
+  Gauge &schedulerQueue;  // fetches and calls waiting in FetchSchedulers
+  Gauge &taskQueue;       // runnable tasks waiting in TaskPools
+  Histogram &decisionTime;
+
+  static ClientMetrics &get();
+};
+
+// Serves Registry::global() on a Unix domain socket, as an HTTP reply to a GET or as plain text to a client that
+// sends nothing, and writes it to stderr on SIGUSR1. Without a path only the signal is handled. Does nothing on
+// Windows, which has neither.
+class Exporter final {
+ private:
+  std::string path;
+  int listener{-1};
+  std::array<int, 2> wakeup{-1, -1};
+  std::thread worker;
+
+  void run();
+  void serve(int client) const;
+
+ public:
+  // Throws std::system_error if the socket cannot be bound, std::invalid_argument if the path is too long
+  explicit Exporter(std::string socketPath = "");
+  Exporter(const Exporter &) = delete;
+  ~Exporter();
+};
+
+}  // namespace bura::metrics
+
+#endif  // CLIENT_METRICS_H
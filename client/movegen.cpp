@@ -0,0 +1,214 @@
+#include "movegen.h"
+
+using namespace bura;
+
+namespace {
+
+constexpr uint16_t kUnreachable = UINT16_MAX;
+
+struct DefenceSearch {
+  const uint8_t *attack;
+  size_t count;
+  uint8_t trumpSuit;
+  MoveList &moves;
+  Move current;
+
+  // Assigns a beater to attack card `position` and on
+  void run(size_t position, CardMask hand) {
+    if (position == count) {
+      moves.push_back(current);
+      return;
+    }
+
+    for (CardMask options = hand & MoveGen::beaters(attack[position], trumpSuit); options != 0; options &= options - 1) {
+      auto card = lowestCard(options);
+      current.beaters[position] = card;
+      current.cards |= CardMask{1} << card;
+      run(position + 1, hand & ~(CardMask{1} << card));
+      current.cards &= ~(CardMask{1} << card);
+    }
+    current.beaters[position] = kNoCard;
+  }
+};
+
+// The `count` cheapest of the options: an optimal defence never needs another card for this attack card, as the
+// other attack cards take fewer than `count` of these and one is always left to swap in
+CardMask cheapest(CardMask options, size_t count, uint8_t trumpSuit) {
+  const auto trumps = trumpSuit < kSuitCount ? MoveGen::suitMask(trumpSuit) : 0;
+  CardMask result = 0;
+  // Weaker cards have higher indices, and trumps cost more than anything else
+  for (auto part : {options & ~trumps, options & trumps}) {
+    for (; part != 0 && count > 0; --count) {
+      auto card = CardMask{1} << (63 - __builtin_clzll(part));
+      result |= card;
+      part &= ~card;
+    }
+  }
+  return result;
+}
+
+// Minimum-cost matching of the attack cards to hand cards: a depth-first search over the attack cards that tries
+// each one's cheapest beaters first and gives up on a branch once it cannot beat the best defence found so far
+struct DefenceMatch {
+  const CardMask *options;  // already cut down to the cheapest few
+  size_t count;
+  uint8_t trumpSuit;
+  std::array<uint16_t, kSuitCount + 1> bound{};  // lower bound on the cost of the attack cards from this one on
+  uint16_t bestCost{kUnreachable};
+  Move best;
+  Move current;
+
+  DefenceMatch(const CardMask *options, size_t count, uint8_t trumpSuit) : options(options), count(count), trumpSuit(trumpSuit) {}
+
+  void run(size_t position, CardMask used, uint16_t spent) {
+    if (position == count) {
+      bestCost = spent;
+      best = current;
+      return;
+    }
+
+    // Non-trumps before trumps, weaker (higher index) cards first: that is increasing cost
+    const auto trumps = trumpSuit < kSuitCount ? MoveGen::suitMask(trumpSuit) : 0;
+    for (auto part : {options[position] & ~used & ~trumps, options[position] & ~used & trumps}) {
+      for (; part != 0; part &= ~(CardMask{1} << (63 - __builtin_clzll(part)))) {
+        const auto card = static_cast<uint8_t>(63 - __builtin_clzll(part));
+        const auto cost = static_cast<uint16_t>(spent + MoveGen::defenceCost(card, trumpSuit));
+        if (cost + bound[position + 1] >= bestCost) return;
+
+        current.beaters[position] = card;
+        run(position + 1, used | CardMask{1} << card, cost);
+      }
+    }
+  }
+};
+
+bool matchDefence(const CardMask *options, size_t count, uint8_t trumpSuit, Move &best) {
+  std::array<CardMask, kSuitCount> cut{};
+  for (size_t i = 0; i < count; ++i) cut[i] = cheapest(options[i], count, trumpSuit);
+
+  DefenceMatch match{cut.data(), count, trumpSuit};
+  for (auto i = count; i-- > 0;) {
+    if (cut[i] == 0) return false;
+    match.bound[i] = static_cast<uint16_t>(match.bound[i + 1] + MoveGen::defenceCost(lowestCard(cheapest(cut[i], 1, trumpSuit)), trumpSuit));
+  }
+  match.run(0, 0, 0);
+  if (match.bestCost == kUnreachable) return false;
+
+  best = match.best;
+  for (size_t i = 0; i < count; ++i) best.cards |= CardMask{1} << best.beaters[i];
+  return true;
+}
+
+// Hall's condition: every group of attack cards has at least as many distinct cards beating one of them
+bool matchable(const CardMask *options, size_t count) {
+  for (size_t group = 1; group < (size_t{1} << count); ++group) {
+    CardMask cards = 0;
+    for (auto rest = group; rest != 0; rest &= rest - 1) cards |= options[__builtin_ctzll(rest)];
+    // At least as many cards as the group has bits, without a popcount: drop one card per bit but the last
+    for (auto rest = group & (group - 1); rest != 0 && cards != 0; rest &= rest - 1) cards &= cards - 1;
+    if (cards == 0) return false;
+  }
+  return true;
+}
+
+// Hand cards beating each attack card; false if it cannot be a defence at all
+bool defenceOptions(CardMask hand, const uint8_t *attack, size_t count, uint8_t trumpSuit, std::array<CardMask, kSuitCount> &options) {
+  if (count == 0 || count > kSuitCount || cardCount(hand) < static_cast<int>(count)) return false;
+  for (size_t i = 0; i < count; ++i) options[i] = hand & MoveGen::beaters(attack[i], trumpSuit);
+  return true;
+}
+
+// Attack cards as indices; false if they cannot be an attack (unknown or more cards than a rank has)
+bool attackIndices(const std::vector<Card> &cards, std::array<uint8_t, kSuitCount> &indices) {
+  if (cards.size() > kSuitCount) return false;
+  for (size_t i = 0; i < cards.size(); ++i) {
+    indices[i] = cards[i].index();
+    if (indices[i] == kNoCard) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::vector<Card> Move::toCards() const {
+  std::vector<Card> result;
+  if (isDefence()) {
+    for (auto card : beaters) {
+      if (card == kNoCard) break;
+      result.push_back(Card::fromIndex(card));
+    }
+    return result;
+  }
+
+  for (auto rest = cards; rest != 0; rest &= rest - 1) result.push_back(Card::fromIndex(lowestCard(rest)));
+  return result;
+}
+
+void MoveGen::attacks(CardMask hand, MoveList &moves) {
+  for (uint8_t value = 0; value < kValueCount; ++value) {
+    const auto rank = hand & rankMask(value);
+    // Every non-empty subset of the rank, largest first
+    for (auto subset = rank; subset != 0; subset = (subset - 1) & rank) {
+      Move move;
+      move.cards = subset;
+      moves.push_back(move);
+    }
+  }
+}
+
+void MoveGen::defences(CardMask hand, const uint8_t *attack, size_t count, uint8_t trumpSuit, MoveList &moves) {
+  if (count == 0 || count > kSuitCount || cardCount(hand) < static_cast<int>(count)) return;
+  DefenceSearch search{attack, count, trumpSuit, moves, {}};
+  search.run(0, hand);
+}
+
+void MoveGen::generate(const GameState &state, MoveList &moves) {
+  const auto hand = Card::mask(state.my_cards);
+
+  if (state.status == GameStatus::YourMove) {
+    attacks(hand, moves);
+  } else if (state.status == GameStatus::YourDef) {
+    std::array<uint8_t, kSuitCount> attack{};
+    if (!attackIndices(state.attack_cards, attack)) return;
+    defences(hand, attack.data(), state.attack_cards.size(), static_cast<uint8_t>(state.trump.suit), moves);
+  }
+}
+
+bool MoveGen::beats(const std::vector<Card> &defence, const std::vector<Card> &attack, CardSuit trump) {
+  if (defence.size() != attack.size()) return false;
+  for (size_t i = 0; i < defence.size(); ++i)
+    if (!Card::canUseCard(defence[i], attack[i], trump)) return false;
+  return true;
+}
+
+bool MoveGen::cheapestDefence(CardMask hand, const uint8_t *attack, size_t count, uint8_t trumpSuit, Move &move) {
+  std::array<CardMask, kSuitCount> options{};
+  return defenceOptions(hand, attack, count, trumpSuit, options) && matchDefence(options.data(), count, trumpSuit, move);
+}
+
+bool MoveGen::cheapestDefence(const GameState &state, Move &move) {
+  std::array<uint8_t, kSuitCount> attack{};
+  if (!attackIndices(state.attack_cards, attack)) return false;
+  return cheapestDefence(Card::mask(state.my_cards), attack.data(), state.attack_cards.size(), static_cast<uint8_t>(state.trump.suit), move);
+}
+
+bool MoveGen::canDefend(CardMask hand, const uint8_t *attack, size_t count, uint8_t trumpSuit) {
+  std::array<CardMask, kSuitCount> options{};
+  return defenceOptions(hand, attack, count, trumpSuit, options) && matchable(options.data(), count);
+}
+
+bool MoveGen::canDefend(CardMask hand, CardMask attack, uint8_t trumpSuit) {
+  if (attack == 0) return true;
+  if (cardCount(attack) > kSuitCount) return false;
+
+  std::array<uint8_t, kSuitCount> cards{};
+  size_t count = 0;
+  for (; attack != 0; attack &= attack - 1) cards[count++] = lowestCard(attack);
+  return canDefend(hand, cards.data(), count, trumpSuit);
+}
+
+bool MoveGen::canDefend(const GameState &state) {
+  std::array<uint8_t, kSuitCount> attack{};
+  if (!attackIndices(state.attack_cards, attack)) return false;
+  return canDefend(Card::mask(state.my_cards), attack.data(), state.attack_cards.size(), static_cast<uint8_t>(state.trump.suit));
+}
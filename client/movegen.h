@@ -0,0 +1,73 @@
+#ifndef CLIENT_MOVEGEN_H
+#define CLIENT_MOVEGEN_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+// The rules of a legal move on card masks (see Card::mask), shared by the board, the bots and the local server.
+// A suit of kNoCard or above means there is no trump.
+
+namespace bura {
+
+// An attack is a set of cards of one rank, so it never has more than kSuitCount cards.
+// A defence also needs the pairing: the server matches defence and attack cards by position, so `beaters`
+// holds the card beating each attack card, in the order the attack was played, and kNoCard after the last.
+struct Move {
+  CardMask cards{0};
+  std::array<uint8_t, kSuitCount> beaters{kNoCard, kNoCard, kNoCard, kNoCard};
+
+  [[nodiscard]] bool isDefence() const { return beaters[0] != kNoCard; }
+  // In the order the server expects them
+  [[nodiscard]] std::vector<Card> toCards() const;
+};
+
+using MoveList = std::vector<Move>;
+
+class MoveGen final {
+ public:
+  static constexpr CardMask kRankMask = CardMask{1} | CardMask{1} << kValueCount | CardMask{1} << 2 * kValueCount | CardMask{1} << 3 * kValueCount;
+
+  static CardMask suitMask(uint8_t suit) { return ((CardMask{1} << kValueCount) - 1) << (suit * kValueCount); }
+  static CardMask rankMask(uint8_t value) { return kRankMask << value; }
+  // Higher cards of the same suit, plus every trump for a card that is not one
+  static CardMask beaters(uint8_t card, uint8_t trumpSuit) {
+    auto suit = static_cast<uint8_t>(card / kValueCount);
+    CardMask result = ((CardMask{1} << (card % kValueCount)) - 1) << (suit * kValueCount);
+    if (suit != trumpSuit && trumpSuit < kSuitCount) result |= suitMask(trumpSuit);
+    return result;
+  }
+
+  // Appends every non-empty set of same-rank cards of the hand
+  static void attacks(CardMask hand, MoveList &moves);
+  // Appends every assignment of distinct hand cards that beats all attack cards (card indices, in play order)
+  static void defences(CardMask hand, const uint8_t *attack, size_t count, uint8_t trumpSuit, MoveList &moves);
+  // Attacks on YourMove, defences on YourDef (where passing is always possible too), nothing otherwise
+  static void generate(const GameState &state, MoveList &moves);
+
+  static bool isAttack(CardMask hand, CardMask cards) { return cards != 0 && (cards & ~hand) == 0 && sameRank(cards); }
+  static bool sameRank(CardMask cards) { return cards != 0 && (cards & rankMask(lowestCard(cards) % kValueCount)) == cards; }
+  // Defence cards beat the attack cards position by position
+  static bool beats(const std::vector<Card> &defence, const std::vector<Card> &attack, CardSuit trump);
+  // What spending a card on defence costs: its rank, and for a trump more than the ranks of any defence without one
+  static uint16_t defenceCost(uint8_t card, uint8_t trumpSuit) {
+    auto cost = static_cast<uint16_t>(kValueCount - 1 - card % kValueCount);
+    return card / kValueCount == trumpSuit ? cost + kSuitCount * kValueCount : cost;
+  }
+
+  // The defence with the lowest total defenceCost, a minimum-cost matching of attack cards to hand cards;
+  // false if the attack cannot be beaten
+  static bool cheapestDefence(CardMask hand, const uint8_t *attack, size_t count, uint8_t trumpSuit, Move &move);
+  static bool cheapestDefence(const GameState &state, Move &move);
+
+  // Whether any defence exists, without listing them
+  static bool canDefend(CardMask hand, const uint8_t *attack, size_t count, uint8_t trumpSuit);
+  static bool canDefend(CardMask hand, CardMask attack, uint8_t trumpSuit);
+  static bool canDefend(const GameState &state);
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_MOVEGEN_H
@@ -0,0 +1,231 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loopback.h"
+#include "position.h"
+#include "rng.h"
+
+using namespace bura;
+
+// Counts the nodes of the complete game tree of attacks, defences and passes from seeded deals, depth by depth,
+// the way chess engines check their move generators.
+//
+// client_perft [--depth N] [--seed S] [--deals D] [--threads T] [--verify G]
+// Deal i is the first lobby of a LocalServer seeded with S + i. With more than one thread the root moves of all
+// deals are shared out between them. --verify G then plays G random games through both Position and the
+// LocalServer and compares every state, so the counts rest on the same rules as the server.
+// The report goes to stderr, JSON to stdout.
+
+namespace {
+
+struct Row {
+  int depth{};
+  uint64_t nodes{};
+  double seconds{};
+};
+
+// One list per ply, so the search does not allocate once they have grown
+uint64_t perft(const Position &position, int depth, std::vector<MoveList> &lists) {
+  auto &moves = lists[depth];
+  moves.clear();
+  position.moves(moves);
+  // Bulk counting: the last ply only needs the number of moves
+  if (depth == 1) return moves.size();
+
+  uint64_t nodes = 0;
+  for (const auto &move : moves) {
+    auto child = position;
+    child.apply(move);
+    nodes += perft(child, depth - 1, lists);
+  }
+  return nodes;
+}
+
+uint64_t perftSerial(const std::vector<Position> &deals, int depth) {
+  std::vector<MoveList> lists(depth + 1);
+  uint64_t nodes = 0;
+  for (const auto &deal : deals) nodes += perft(deal, depth, lists);
+  return nodes;
+}
+
+// Split at the root: every (deal, root move) pair is one job, taken by whichever thread is free
+uint64_t perftParallel(const std::vector<Position> &deals, int depth, unsigned threads) {
+  std::vector<Position> roots;
+  for (const auto &deal : deals) {
+    MoveList moves;
+    deal.moves(moves);
+    for (const auto &move : moves) {
+      roots.push_back(deal);
+      roots.back().apply(move);
+    }
+  }
+  if (depth == 1) return roots.size();
+
+  std::atomic<size_t> next{0};
+  std::atomic<uint64_t> nodes{0};
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      std::vector<MoveList> lists(depth);
+      uint64_t local = 0;
+      for (size_t job = next++; job < roots.size(); job = next++) local += perft(roots[job], depth - 1, lists);
+      nodes += local;
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  return nodes;
+}
+
+GameStatus expectedStatus(const Position &position, uint8_t seat) {
+  switch (position.phase) {
+    case Position::Phase::Attack:
+      return position.seat == seat ? GameStatus::YourMove : GameStatus::OpponentMove;
+    case Position::Phase::Defend:
+      return position.seat == seat ? GameStatus::YourDef : GameStatus::OpponentDef;
+    case Position::Phase::Finish:
+      return position.winner == seat ? GameStatus::Win : GameStatus::Lose;
+  }
+  return GameStatus::None;
+}
+
+// Empty if the server shows the seat what the position says
+std::string compare(const Position &position, uint8_t seat, const GameState &state) {
+  if (state.status != expectedStatus(position, seat)) return "status " + std::to_string(static_cast<int>(state.status));
+  if (Card::mask(state.my_cards) != position.hands[seat]) return "hand";
+  // A beaten attack stays on the server's table until the next one, so it only counts while being defended
+  if (position.phase == Position::Phase::Defend && Card::mask(state.attack_cards) != position.attackCards) return "attack";
+  if (state.inHeap != position.inHeap()) return "heap " + std::to_string(state.inHeap);
+  if (state.inFall != position.inFall()) return "fall " + std::to_string(state.inFall);
+  if (static_cast<uint8_t>(state.trump.suit) != position.trumpSuit) return "trump";
+  return {};
+}
+
+// Plays random legal moves on both sides; returns the number of moves, or 0 after reporting a mismatch
+size_t verifyGame(uint64_t seed, Rng &rng) {
+  LocalServerConfig config;
+  config.seed = seed;
+  config.moveLogBase = std::chrono::milliseconds(0);
+  config.moveLogPerCard = std::chrono::milliseconds(0);
+  auto server = std::make_shared<LocalServer>(config);
+
+  BuraClient clients[2];
+  for (auto &client : clients) {
+    client.start(std::make_unique<http::LoopbackTransport>(server));
+    client.connect("Perft");
+  }
+
+  auto position = Position::deal(seed);
+  MoveList moves;
+  for (size_t ply = 0;; ++ply) {
+    for (uint8_t seat = 0; seat < 2; ++seat) {
+      auto mismatch = compare(position, seat, clients[seat].fetch());
+      if (!mismatch.empty()) {
+        std::cerr << "seed " << seed << " ply " << ply << " seat " << static_cast<int>(seat) << ": " << mismatch << std::endl;
+        return 0;
+      }
+    }
+
+    moves.clear();
+    position.moves(moves);
+    if (moves.empty()) return ply;
+
+    const auto &move = moves[rng.below(moves.size())];
+    auto &client = clients[position.seat];
+    int status;
+    if (position.phase == Position::Phase::Attack)
+      status = client.finishMove(move.toCards());
+    else if (move.cards == 0)
+      status = client.passDef();
+    else
+      status = client.finishDef(move.toCards());
+
+    if (status != 0) {
+      std::cerr << "seed " << seed << " ply " << ply << ": the server refused a generated move with " << status << std::endl;
+      return 0;
+    }
+    position.apply(move);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  int depth = 5;
+  uint64_t seed = 1;
+  size_t dealCount = 1;
+  unsigned threads = 1;
+  size_t verifyGames = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << option << std::endl;
+      return 2;
+    }
+
+    if (option == "--depth")
+      depth = std::stoi(argv[++i]);
+    else if (option == "--seed")
+      seed = std::stoull(argv[++i]);
+    else if (option == "--deals")
+      dealCount = std::stoul(argv[++i]);
+    else if (option == "--threads")
+      threads = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (option == "--verify")
+      verifyGames = std::stoul(argv[++i]);
+    else {
+      std::cerr << "Unknown option " << option << std::endl;
+      return 2;
+    }
+  }
+  if (depth < 1) depth = 1;
+  if (dealCount == 0) dealCount = 1;
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+  if (verifyGames > 0) {
+    Rng rng(seed);
+    size_t plies = 0;
+    for (size_t i = 0; i < verifyGames; ++i) {
+      auto played = verifyGame(seed + i, rng);
+      if (played == 0) return 1;
+      plies += played;
+    }
+    std::cerr << "verified " << verifyGames << " games, " << plies << " moves" << std::endl;
+  }
+
+  std::vector<Position> deals;
+  for (size_t i = 0; i < dealCount; ++i) deals.push_back(Position::deal(seed + i));
+
+  std::vector<Row> rows;
+  for (int d = 1; d <= depth; ++d) {
+    auto start = std::chrono::steady_clock::now();
+    auto nodes = threads > 1 ? perftParallel(deals, d, threads) : perftSerial(deals, d);
+    rows.push_back({d, nodes, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()});
+  }
+
+  std::cerr << "seed " << seed << ", " << dealCount << " deals, " << threads << " threads" << std::endl;
+  std::cerr << std::left << std::setw(8) << "depth" << std::right << std::setw(16) << "nodes" << std::setw(12) << "seconds" << std::setw(16)
+            << "nodes/s" << std::endl;
+  for (auto &row : rows) {
+    std::cerr << std::left << std::setw(8) << row.depth << std::right << std::setw(16) << row.nodes << std::fixed << std::setprecision(3)
+              << std::setw(12) << row.seconds << std::setprecision(0) << std::setw(16) << static_cast<double>(row.nodes) / std::max(row.seconds, 1e-9)
+              << std::endl;
+  }
+
+  std::cout << "{\"seed\":" << seed << ",\"deals\":" << dealCount << ",\"threads\":" << threads << ",\"depths\":[";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    auto &row = rows[i];
+    std::cout << (i == 0 ? "" : ",") << "{\"depth\":" << row.depth << ",\"nodes\":" << row.nodes << std::fixed << std::setprecision(6)
+              << ",\"seconds\":" << row.seconds << std::setprecision(0) << ",\"nodes_per_second\":"
+              << static_cast<double>(row.nodes) / std::max(row.seconds, 1e-9) << "}";
+  }
+  std::cout << "]}" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "poll.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace bura;
+
+namespace {
+
+using std::chrono::milliseconds;
+
+constexpr milliseconds kWaitSlice{50};
+
+double toMs(PollClock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); }
+
+milliseconds doubled(milliseconds base, int times, milliseconds limit) {
+  auto result = base * (int64_t{1} << std::min(times, 16));
+  return std::min(result, limit);
+}
+
+}  // namespace
+
+// PollScheduler
+
+PollScheduler::PollScheduler(PollConfig config) : config(config), started(PollClock::now()), refilled(started), tokens(config.burst) {}
+
+PollClock::duration PollScheduler::reserve() {
+  std::lock_guard<std::mutex> lock(mutex);
+  requests++;
+
+  if (config.requestsPerSecond <= 0) return {};
+
+  auto now = PollClock::now();
+  tokens = std::min(config.burst, tokens + std::chrono::duration<double>(now - refilled).count() * config.requestsPerSecond);
+  refilled = now;
+
+  // Tokens may go negative: each caller reserves its slot and sleeps until the bucket has refilled up to it
+  tokens -= 1;
+  if (tokens >= 0) return {};
+  return std::chrono::duration_cast<PollClock::duration>(std::chrono::duration<double>(-tokens / config.requestsPerSecond));
+}
+
+void PollScheduler::reaction(milliseconds delay) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto value = static_cast<uint64_t>(std::max<int64_t>(delay.count(), 0));
+  reactionDelay.counts[http::latencyBucket(value)]++;
+  reactionDelay.total++;
+  reactionDelay.sum += value;
+  reactionDelay.max = std::max(reactionDelay.max, value);
+}
+
+PollStats PollScheduler::stats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  PollStats result;
+  result.requests = requests;
+  result.requestsPerSecond = static_cast<double>(requests) / std::max(std::chrono::duration<double>(PollClock::now() - started).count(), 1e-3);
+  result.reactionDelay = reactionDelay;
+  return result;
+}
+
+std::string PollScheduler::report() {
+  auto current = stats();
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1) << "polls: " << current.requests << " (" << current.requestsPerSecond << " req/s)";
+  ss << ", reaction delay ms: mean " << current.reactionDelay.mean() << " p50 " << current.reactionDelay.percentile(0.5) << " p99 "
+     << current.reactionDelay.percentile(0.99) << " max " << current.reactionDelay.max;
+  return ss.str();
+}
+
+// PollTimer
+
+PollTimer::PollTimer(std::shared_ptr<PollScheduler> pollScheduler)
+    : scheduler(std::move(pollScheduler)),
+      config(scheduler->getConfig()),
+      opponentEstimate(static_cast<double>(config.opponentEstimate.count())),
+      rng(threadRng().fork()) {
+  nextPoll = PollClock::now();
+}
+
+void PollTimer::schedule(milliseconds interval) {
+  auto jittered = std::chrono::duration<double, std::milli>(static_cast<double>(interval.count()) * rng.uniform(1.0 - config.jitter, 1.0 + config.jitter));
+  nextPoll = pollStarted + std::max(std::chrono::duration_cast<PollClock::duration>(jittered), PollClock::duration(config.minInterval));
+}
+
+void PollTimer::wait(const std::atomic<bool> &stop) {
+  auto sleepUntil = [&](PollClock::time_point time, bool interruptible) {
+    for (auto now = PollClock::now(); now < time && !stop; now = PollClock::now()) {
+      if (interruptible && nudged.exchange(false)) return;
+      std::this_thread::sleep_for(std::min<PollClock::duration>(time - now, kWaitSlice));
+    }
+  };
+
+  sleepUntil(nextPoll, true);
+  if (stop) return;
+
+  // A nudge skips the wait for our own schedule, never the process budget
+  sleepUntil(PollClock::now() + begin(), false);
+}
+
+PollClock::time_point PollTimer::due() { return nudged.exchange(false) ? PollClock::now() : nextPoll; }
+
+PollClock::duration PollTimer::begin() {
+  auto delay = scheduler->reserve();
+  nudged.store(false);
+  pollStarted = PollClock::now() + delay;
+  return delay;
+}
+
+void PollTimer::observe(const GameState &state) {
+  auto now = PollClock::now();
+  failures = 0;
+
+  if (state.status != status) {
+    // The change happened somewhere since the previous poll, assume the middle
+    auto changedAt = lastPoll == PollClock::time_point{} ? pollStarted : lastPoll + (pollStarted - lastPoll) / 2;
+
+    if (lastPoll != PollClock::time_point{}) {
+      scheduler->reaction(std::chrono::duration_cast<milliseconds>(now - changedAt));
+
+      if (status == GameStatus::OpponentMove || status == GameStatus::OpponentDef)
+        opponentEstimate = opponentEstimate * 0.7 + toMs(changedAt - statusSince) * 0.3;
+    }
+
+    status = state.status;
+    statusSince = changedAt;
+    unchanged = 0;
+  } else {
+    unchanged++;
+  }
+
+  lastPoll = pollStarted;
+
+  switch (status) {
+    case GameStatus::OpponentMove:
+    case GameStatus::OpponentDef: {
+      // Poll sparsely early on and densely around the expected answer, backing off once it is overdue
+      auto remaining = opponentEstimate - toMs(now - statusSince);
+      if (remaining > 0)
+        schedule(std::clamp(milliseconds(static_cast<int64_t>(remaining / 2)), config.minInterval, config.turnInterval));
+      else
+        schedule(doubled(config.minInterval, static_cast<int>(-remaining / opponentEstimate), config.turnInterval));
+      break;
+    }
+    case GameStatus::MoveLog: {
+      auto due = statusSince + config.moveLogBase + config.moveLogPerCard * static_cast<int64_t>(state.attack_cards.size());
+      schedule(std::max(std::chrono::duration_cast<milliseconds>(due - pollStarted), config.minInterval));
+      break;
+    }
+    case GameStatus::YourMove:
+    case GameStatus::YourDef:
+      schedule(config.turnInterval);
+      break;
+    case GameStatus::Win:
+    case GameStatus::Lose:
+    case GameStatus::Finish:
+      schedule(config.maxInterval);
+      break;
+    default:
+      schedule(doubled(config.idleInterval, unchanged, config.maxInterval));
+      break;
+  }
+}
+
+void PollTimer::failed() {
+  pollStarted = PollClock::now();
+  schedule(doubled(config.retryInterval, failures++, config.maxInterval));
+}
+
+void PollTimer::nudge() { nudged.store(true); }
@@ -0,0 +1,110 @@
+#ifndef CLIENT_POLL_H
+#define CLIENT_POLL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "game.h"
+#include "latency.h"
+#include "rng.h"
+
+namespace bura {
+
+using PollClock = std::chrono::steady_clock;
+
+struct PollConfig {
+  std::chrono::milliseconds minInterval{100};
+  std::chrono::milliseconds idleInterval{1000};  // matchmaking, doubled while nothing changes
+  std::chrono::milliseconds turnInterval{1000};  // our own turn, the state only changes when we act
+  std::chrono::milliseconds maxInterval{5000};
+  std::chrono::milliseconds retryInterval{500};  // doubled per consecutive failure
+
+  std::chrono::milliseconds opponentEstimate{3000};  // initial guess of how long the opponent takes
+
+  // The server leaves MoveLog after moveLogBase + moveLogPerCard * attack cards
+  std::chrono::milliseconds moveLogBase{1000};
+  std::chrono::milliseconds moveLogPerCard{2000};
+
+  double jitter{0.2};
+
+  // Fetches per second for the whole process, 0 disables the budget
+  double requestsPerSecond{100};
+  double burst{20};
+};
+
+struct PollStats {
+  uint64_t requests{0};
+  double requestsPerSecond{0};
+  http::Histogram reactionDelay;  // milliseconds
+};
+
+// Process-wide part of polling: the request budget (a token bucket) and the statistics of every game.
+class PollScheduler final {
+ private:
+  PollConfig config;
+
+  std::mutex mutex;
+  PollClock::time_point started;
+  PollClock::time_point refilled;
+  double tokens;
+  uint64_t requests{0};
+  http::Histogram reactionDelay;
+
+ public:
+  explicit PollScheduler(PollConfig config = {});
+
+  [[nodiscard]] const PollConfig &getConfig() const { return config; }
+
+  // Takes one request from the budget and returns how long the caller has to wait for it
+  PollClock::duration reserve();
+  void reaction(std::chrono::milliseconds delay);
+
+  PollStats stats();
+  std::string report();
+};
+
+// Poll timing of one game. Intervals follow the last seen GameStatus:
+// short while the opponent is expected to answer, until the server timer while in MoveLog,
+// long on our own turn, during matchmaking and after the game ended.
+class PollTimer final {
+ private:
+  std::shared_ptr<PollScheduler> scheduler;
+  const PollConfig &config;
+
+  GameStatus status{GameStatus::None};
+  PollClock::time_point statusSince{};
+  PollClock::time_point lastPoll{};
+  PollClock::time_point nextPoll{};
+  PollClock::time_point pollStarted{};
+  double opponentEstimate;  // ms
+  int unchanged{0};
+  int failures{0};
+  std::atomic<bool> nudged{false};
+  Rng rng;
+
+  void schedule(std::chrono::milliseconds interval);
+
+ public:
+  explicit PollTimer(std::shared_ptr<PollScheduler> pollScheduler);
+
+  // Sleeps until the next poll is due and the budget allows it; returns early once stop is set
+  void wait(const std::atomic<bool> &stop);
+
+  // Non-blocking form of wait for cooperative tasks: sleep until due(), then for the duration begin() returns
+  [[nodiscard]] PollClock::time_point due();
+  PollClock::duration begin();
+
+  void observe(const GameState &state);
+  void failed();
+
+  // Polls again soon, e.g. right after sending a move. Safe to call from another thread.
+  void nudge();
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_POLL_H
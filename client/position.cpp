@@ -0,0 +1,91 @@
+#include "position.h"
+
+#include "rng.h"
+
+using namespace bura;
+
+namespace {
+
+constexpr int kMinCardsInHand = 6;
+
+}  // namespace
+
+Position Position::deal(uint64_t seed) {
+  Position position;
+  for (uint8_t i = 0; i < kDeckSize; ++i) position.deck[i] = i;
+
+  // The same shuffle as LocalServer::createLobby, which shuffles the cards of these indices
+  Rng rng(seed);
+  rng.shuffle(position.deck.begin(), position.deck.end());
+  position.trumpSuit = static_cast<uint8_t>(position.deck.back() / kValueCount);
+
+  position.giveCards();
+  return position;
+}
+
+// Seat by seat, one card each round, until nobody has fewer than five cards or the heap is empty
+void Position::giveCards() {
+  bool stillNeed = true;
+
+  while (stillNeed && dealt < kDeckSize) {
+    stillNeed = false;
+
+    for (auto &hand : hands) {
+      if (dealt == kDeckSize) break;
+      auto count = cardCount(hand);
+      if (count < kMinCardsInHand - 1) stillNeed = true;
+      if (count < kMinCardsInHand) hand |= CardMask{1} << deck[dealt++];
+    }
+  }
+}
+
+void Position::moves(MoveList &list) const {
+  switch (phase) {
+    case Phase::Attack:
+      MoveGen::attacks(hands[seat], list);
+      break;
+    case Phase::Defend:
+      MoveGen::defences(hands[seat], attack.data(), attackCount, trumpSuit, list);
+      list.emplace_back();
+      break;
+    case Phase::Finish:
+      break;
+  }
+}
+
+void Position::apply(const Move &move) {
+  if (phase == Phase::Attack) {
+    hands[seat] &= ~move.cards;
+    attackCards = move.cards;
+    attackCount = 0;
+    for (auto rest = move.cards; rest != 0; rest &= rest - 1) attack[attackCount++] = lowestCard(rest);
+
+    phase = Phase::Defend;
+    seat = static_cast<uint8_t>(1 - seat);
+    return;
+  }
+
+  if (move.cards == 0) {
+    // Pass: the defender takes the attack and the attacker goes again
+    hands[seat] |= attackCards;
+    seat = static_cast<uint8_t>(1 - seat);
+  } else {
+    // Beaten: everything goes to the fall and the defender attacks next
+    hands[seat] &= ~move.cards;
+    fall |= attackCards | move.cards;
+  }
+  attackCards = 0;
+  attackCount = 0;
+
+  giveCards();
+
+  // What the end of MoveLog decides: the first seat without cards wins
+  phase = Phase::Attack;
+  for (uint8_t i = 0; i < hands.size(); ++i) {
+    if (hands[i] == 0) {
+      winner = i;
+      phase = Phase::Finish;
+      break;
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef CLIENT_POSITION_H
+#define CLIENT_POSITION_H
+
+#include <array>
+#include <cstdint>
+
+#include "movegen.h"
+
+// A whole game with both hands open, on card masks: the rules of server/src/requests.ts as LocalServer runs them,
+// without ids, timers or encoding, for tools that walk the game tree.
+
+namespace bura {
+
+struct Position {
+  enum struct Phase : uint8_t { Attack, Defend, Finish };
+
+  std::array<uint8_t, kDeckSize> deck{};  // card indices in dealing order, the last one is the trump
+  uint8_t dealt{0};
+  uint8_t trumpSuit{0};
+
+  std::array<CardMask, 2> hands{};
+  CardMask fall{0};
+  // The attack in the order it was played; defence cards pair with it by position
+  std::array<uint8_t, kSuitCount> attack{};
+  uint8_t attackCount{0};
+  CardMask attackCards{0};
+
+  Phase phase{Phase::Attack};
+  uint8_t seat{0};  // the player to act: the attacker, or the defender while Defend
+  uint8_t winner{0};
+
+  // The first lobby of a LocalServer with this seed, both players seated
+  static Position deal(uint64_t seed);
+
+  // Legal moves of the player to act; a defender may always pass, which is the empty Move
+  void moves(MoveList &list) const;
+  // `move` must be one of moves()
+  void apply(const Move &move);
+
+  [[nodiscard]] uint8_t inHeap() const { return static_cast<uint8_t>(kDeckSize - dealt); }
+  [[nodiscard]] uint8_t inFall() const { return static_cast<uint8_t>(cardCount(fall)); }
+
+ private:
+  void giveCards();
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_POSITION_H
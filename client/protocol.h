@@ -0,0 +1,352 @@
+#ifndef CLIENT_PROTOCOL_H
+#define CLIENT_PROTOCOL_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+
+// Wire layout of the opcode payloads, declared once as a list of fields. Encoders size the buffer once and
+// memcpy every field; decoders check the fixed part of a message up front and only re-check after a
+// variable-length field, so runs of fixed fields read without branches.
+// Everything is little-endian, like the server's readUInt*LE/writeUInt*LE.
+
+namespace bura::proto {
+
+// A codec encodes one field. minSize is its smallest encoding, fixed says that is also the only one.
+// decode may assume `in` holds minSize bytes; a variable codec must leave `rest` bytes for the fields after it.
+
+template <typename T>
+struct Scalar {
+  static_assert(std::is_trivially_copyable_v<T>, "Scalar fields are copied as raw bytes");
+  using Value = T;
+  static constexpr size_t minSize = sizeof(T);
+  static constexpr bool fixed = true;
+
+  static size_t size(const T &) { return sizeof(T); }
+  static void encode(uint8_t *&out, const T &value) {
+    std::memcpy(out, &value, sizeof(T));
+    out += sizeof(T);
+  }
+  static bool decode(const uint8_t *&in, const uint8_t *, size_t, T &value) {
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return true;
+  }
+};
+
+// Card as its CardType; opponent cards decode as hidden
+template <bool Hidden = false>
+struct CardCodec {
+  using Value = Card;
+  static constexpr size_t minSize = sizeof(CardType);
+  static constexpr bool fixed = true;
+
+  static size_t size(const Card &) { return sizeof(CardType); }
+  static void encode(uint8_t *&out, const Card &card) { Scalar<CardType>::encode(out, card.type()); }
+  static bool decode(const uint8_t *&in, const uint8_t *end, size_t rest, Card &card) {
+    CardType type;
+    Scalar<CardType>::decode(in, end, rest, type);
+    card = Card(type, Hidden);
+    return true;
+  }
+};
+
+// Exactly N chars, padded with zeros, e.g. the player id
+template <size_t N>
+struct FixedText {
+  using Value = std::string;
+  static constexpr size_t minSize = N;
+  static constexpr bool fixed = true;
+
+  static size_t size(const std::string &) { return N; }
+  static void encode(uint8_t *&out, const std::string &value) {
+    auto count = std::min(value.size(), N);
+    std::memcpy(out, value.data(), count);
+    std::memset(out + count, 0, N - count);
+    out += N;
+  }
+  static bool decode(const uint8_t *&in, const uint8_t *, size_t, std::string &value) {
+    value.assign(reinterpret_cast<const char *>(in), N);
+    in += N;
+    return true;
+  }
+};
+
+// Wide strings hold code points, UTF-16 pairs where wchar_t is 16 bits; the wire carries utf8. Bytes that are
+// not valid utf8 decode as U+FFFD.
+inline size_t utf8Size(const std::wstring &value) {
+  size_t size = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    auto c = static_cast<uint32_t>(value[i]);
+    if (c >= 0xD800 && c < 0xDC00 && i + 1 < value.size() && (value[i + 1] & 0xFC00) == 0xDC00) {
+      size += 4;
+      ++i;
+    } else {
+      size += c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+    }
+  }
+  return size;
+}
+
+inline void encodeUtf8(uint8_t *&out, const std::wstring &value) {
+  for (size_t i = 0; i < value.size(); ++i) {
+    auto c = static_cast<uint32_t>(value[i]);
+    if (c >= 0xD800 && c < 0xDC00 && i + 1 < value.size() && (value[i + 1] & 0xFC00) == 0xDC00)
+      c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<uint32_t>(value[++i]) - 0xDC00);
+
+    if (c < 0x80) {
+      *out++ = static_cast<uint8_t>(c);
+    } else if (c < 0x800) {
+      *out++ = static_cast<uint8_t>(0xC0 | (c >> 6));
+      *out++ = static_cast<uint8_t>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+      *out++ = static_cast<uint8_t>(0xE0 | (c >> 12));
+      *out++ = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F));
+      *out++ = static_cast<uint8_t>(0x80 | (c & 0x3F));
+    } else {
+      *out++ = static_cast<uint8_t>(0xF0 | (c >> 18));
+      *out++ = static_cast<uint8_t>(0x80 | ((c >> 12) & 0x3F));
+      *out++ = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F));
+      *out++ = static_cast<uint8_t>(0x80 | (c & 0x3F));
+    }
+  }
+}
+
+inline std::string toUtf8(const std::wstring &value) {
+  std::string result(utf8Size(value), '\0');
+  auto out = reinterpret_cast<uint8_t *>(result.data());
+  encodeUtf8(out, value);
+  return result;
+}
+
+inline std::wstring fromUtf8(const uint8_t *in, size_t length) {
+  std::wstring result;
+  result.reserve(length);
+  const auto end = in + length;
+  while (in < end) {
+    uint32_t c = *in++;
+    if (c < 0x80) {
+      result += static_cast<wchar_t>(c);
+      continue;
+    }
+    if (c < 0xC2 || c >= 0xF5) {
+      result += static_cast<wchar_t>(0xFFFD);
+      continue;
+    }
+    const size_t extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+    c &= 0x3F >> extra;
+
+    size_t read = 0;
+    while (read < extra && in < end && (*in & 0xC0) == 0x80) {
+      c = (c << 6) | (*in++ & 0x3F);
+      ++read;
+    }
+    // Truncated, overlong, surrogate or beyond U+10FFFF
+    static constexpr uint32_t kMinimum[] = {0, 0x80, 0x800, 0x10000};
+    if (read < extra || c < kMinimum[extra] || (c >= 0xD800 && c < 0xE000) || c > 0x10FFFF) {
+      result += static_cast<wchar_t>(0xFFFD);
+    } else if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+      result += static_cast<wchar_t>(0xD800 + ((c - 0x10000) >> 10));
+      result += static_cast<wchar_t>(0xDC00 + ((c - 0x10000) & 0x3FF));
+    } else {
+      result += static_cast<wchar_t>(c);
+    }
+  }
+  return result;
+}
+
+inline std::wstring fromUtf8(const std::string &value) {
+  return fromUtf8(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+}
+
+// Length-prefixed bytes; the wide form is utf8 on the wire and code points in memory
+template <typename String, typename Length = uint32_t>
+struct Text {
+  using Value = String;
+  static constexpr size_t minSize = sizeof(Length);
+  static constexpr bool fixed = false;
+
+  static size_t bytes(const String &value) {
+    if constexpr (sizeof(typename String::value_type) == 1)
+      return value.size();
+    else
+      return utf8Size(value);
+  }
+
+  static size_t size(const String &value) { return sizeof(Length) + bytes(value); }
+  static void encode(uint8_t *&out, const String &value) {
+    Scalar<Length>::encode(out, static_cast<Length>(bytes(value)));
+    if constexpr (sizeof(typename String::value_type) == 1) {
+      std::memcpy(out, value.data(), value.size());
+      out += value.size();
+    } else {
+      encodeUtf8(out, value);
+    }
+  }
+  static bool decode(const uint8_t *&in, const uint8_t *end, size_t rest, String &value) {
+    Length length;
+    Scalar<Length>::decode(in, end, rest, length);
+    if (static_cast<uint64_t>(end - in) < uint64_t{length} + rest) return false;
+
+    if constexpr (sizeof(typename String::value_type) == 1)
+      value.assign(in, in + length);
+    else
+      value = fromUtf8(in, length);
+    in += length;
+    return true;
+  }
+};
+
+// Count-prefixed array of fixed-size elements
+template <typename Element, typename Length = uint32_t>
+struct List {
+  static_assert(Element::fixed, "List elements must have a fixed size");
+  using Value = std::vector<typename Element::Value>;
+  static constexpr size_t minSize = sizeof(Length);
+  static constexpr bool fixed = false;
+
+  static size_t size(const Value &value) { return sizeof(Length) + value.size() * Element::minSize; }
+  static void encode(uint8_t *&out, const Value &value) {
+    Scalar<Length>::encode(out, static_cast<Length>(value.size()));
+    for (const auto &item : value) Element::encode(out, item);
+  }
+  static bool decode(const uint8_t *&in, const uint8_t *end, size_t rest, Value &value) {
+    Length count;
+    Scalar<Length>::decode(in, end, rest, count);
+    if (static_cast<uint64_t>(end - in) < uint64_t{count} * Element::minSize + rest) return false;
+
+    value.resize(count);
+    for (auto &item : value) Element::decode(in, end, 0, item);
+    return true;
+  }
+};
+
+template <auto Member, typename FieldCodec>
+struct Field {
+  using Codec = FieldCodec;
+
+  template <typename Message>
+  static auto &get(Message &message) {
+    return message.*Member;
+  }
+};
+
+template <typename... Fields>
+class Schema final {
+ private:
+  static constexpr std::array<size_t, sizeof...(Fields)> sizes{Fields::Codec::minSize...};
+
+  // Smallest encoding of the fields after the I-th
+  static constexpr size_t restAfter(size_t index) {
+    size_t result = 0;
+    for (size_t i = index + 1; i < sizes.size(); ++i) result += sizes[i];
+    return result;
+  }
+
+  template <typename Message, size_t... I>
+  static bool decodeFields(const uint8_t *&in, const uint8_t *end, Message &message, std::index_sequence<I...>) {
+    return (Fields::Codec::decode(in, end, restAfter(I), Fields::get(message)) && ...);
+  }
+
+ public:
+  static constexpr size_t minSize = (Fields::Codec::minSize + ... + 0);
+  static constexpr bool fixed = (Fields::Codec::fixed && ...);
+
+  template <typename Message>
+  static size_t size(const Message &message) {
+    if constexpr (fixed) return minSize;
+    else return (Fields::Codec::size(Fields::get(message)) + ... + 0);
+  }
+
+  template <typename Message>
+  static void encode(const Message &message, std::vector<uint8_t> &buffer) {
+    auto offset = buffer.size();
+    buffer.resize(offset + size(message));
+
+    auto out = buffer.data() + offset;
+    (Fields::Codec::encode(out, Fields::get(message)), ...);
+  }
+
+  template <typename Message>
+  static std::vector<uint8_t> encode(const Message &message) {
+    std::vector<uint8_t> buffer;
+    encode(message, buffer);
+    return buffer;
+  }
+
+  // False if the data is shorter than the message says; trailing bytes are ignored
+  template <typename Message>
+  static bool decode(const uint8_t *data, size_t length, Message &message) {
+    if (length < minSize) return false;
+    return decodeFields(data, data + length, message, std::index_sequence_for<Fields...>{});
+  }
+};
+
+// Every request starts with the player id
+using PlayerId = FixedText<8>;
+
+struct Connect {
+  std::string id;
+  std::string nickname;
+};
+
+struct Fetch {
+  std::string id;
+};
+
+struct Move {
+  std::string id;
+  std::vector<Card> cards;
+};
+
+// Opcode 5 with defend == 0 passes and carries no cards
+struct Pass {
+  std::string id;
+  uint8_t defend{0};
+};
+
+struct Defend {
+  std::string id;
+  uint8_t defend{1};
+  std::vector<Card> cards;
+};
+
+// Opcode 8: the fetches of several players at once, sent under the id of the FetchScheduler
+struct BatchFetch {
+  std::string id;
+  std::vector<std::string> players;
+};
+
+using ConnectRequest = Schema<Field<&Connect::id, PlayerId>, Field<&Connect::nickname, Text<std::string>>>;
+using FetchRequest = Schema<Field<&Fetch::id, PlayerId>>;
+using MoveRequest = Schema<Field<&Move::id, PlayerId>, Field<&Move::cards, List<CardCodec<>>>>;
+using PassRequest = Schema<Field<&Pass::id, PlayerId>, Field<&Pass::defend, Scalar<uint8_t>>>;
+using DefendRequest = Schema<Field<&Defend::id, PlayerId>, Field<&Defend::defend, Scalar<uint8_t>>, Field<&Defend::cards, List<CardCodec<>>>>;
+using BatchFetchRequest = Schema<Field<&BatchFetch::id, PlayerId>, Field<&BatchFetch::players, List<PlayerId>>>;
+
+// Opcode 3 reply, written by buildState in requests.ts
+using StateReply = Schema<Field<&GameState::status, Scalar<GameStatus>>, Field<&GameState::trump, CardCodec<>>,
+                          Field<&GameState::inHeap, Scalar<uint8_t>>, Field<&GameState::inFall, Scalar<uint8_t>>,
+                          Field<&GameState::my_cards, List<CardCodec<>>>, Field<&GameState::opponent_cards, List<CardCodec<true>>>,
+                          Field<&GameState::attack_cards, List<CardCodec<>>>, Field<&GameState::defend_cards, List<CardCodec<>>>,
+                          Field<&GameState::opponentNickname, Text<std::wstring>>>;
+
+static_assert(ConnectRequest::minSize == 12);
+static_assert(FetchRequest::fixed && FetchRequest::minSize == 8);
+static_assert(MoveRequest::minSize == 12);
+static_assert(PassRequest::fixed && PassRequest::minSize == 9);
+static_assert(DefendRequest::minSize == 13);
+static_assert(BatchFetchRequest::minSize == 12);
+static_assert(StateReply::minSize == 25);
+
+}  // namespace bura::proto
+
+#endif  // CLIENT_PROTOCOL_H
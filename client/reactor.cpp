@@ -0,0 +1,619 @@
+#include "reactor.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include "framed.h"
+
+namespace {
+
+constexpr size_t kMalformed = SIZE_MAX;
+constexpr size_t kMaxHttpHeader = 8 * 1024;
+constexpr int kMaxEvents = 256;
+
+[[noreturn]] void fail(const char *what) { throw std::system_error(errno, std::system_category(), what); }
+
+// Content-Length of a request head, -1 if it has none
+int64_t contentLength(const char *head, size_t size) {
+  static constexpr char kName[] = "\r\ncontent-length:";
+  constexpr size_t kNameSize = sizeof(kName) - 1;
+
+  for (size_t i = 0; i + kNameSize <= size; ++i) {
+    size_t k = 0;
+    while (k < kNameSize && std::tolower(static_cast<unsigned char>(head[i + k])) == kName[k]) ++k;
+    if (k < kNameSize) continue;
+
+    int64_t value = 0;
+    bool digits = false;
+    for (auto j = i + kNameSize; j < size; ++j) {
+      if (head[j] == ' ' || head[j] == '\t') {
+        if (digits) break;
+        continue;
+      }
+      if (head[j] < '0' || head[j] > '9') break;
+      value = value * 10 + (head[j] - '0');
+      digits = true;
+      if (value > INT32_MAX) return -1;
+    }
+    return digits ? value : -1;
+  }
+  return -1;
+}
+
+void append(std::vector<uint8_t> &buffer, const void *data, size_t size) {
+  auto bytes = static_cast<const uint8_t *>(data);
+  buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+}  // namespace
+
+// Reactor
+
+http::Reactor::Reactor(bura::LocalServer &game, const ServerConfig &config) : game(game), config(config) {
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll < 0) fail("Failed to create epoll");
+
+  wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake < 0) fail("Failed to create eventfd");
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = &wake;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &event) != 0) fail("Failed to watch eventfd");
+
+  reply.reserve(config.bufferSize);
+  if (config.httpPort) listeners[0] = listen(config.httpPort, &listeners[0]);
+  if (config.framedPort) listeners[1] = listen(config.framedPort, &listeners[1]);
+}
+
+http::Reactor::~Reactor() {
+  for (auto &slot : slots)
+    if (slot->fd >= 0) ::close(slot->fd);
+  for (auto listener : listeners)
+    if (listener >= 0) ::close(listener);
+  if (wake >= 0) ::close(wake);
+  if (epoll >= 0) ::close(epoll);
+}
+
+int http::Reactor::listen(uint16_t port, void *tag) {
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (fd < 0) fail("Failed to create socket");
+
+  int enabled = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+  // Every reactor binds the same port, the kernel hashes new connections onto them
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled)) != 0) fail("Failed to set SO_REUSEPORT");
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if (inet_pton(AF_INET, config.host.c_str(), &address.sin_addr) != 1) {
+    ::close(fd);
+    throw std::invalid_argument("Bad listen address " + config.host);
+  }
+
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    auto error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::system_category(), "Failed to bind port " + std::to_string(port));
+  }
+  if (::listen(fd, SOMAXCONN) != 0) fail("Failed to listen");
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = tag;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) fail("Failed to watch listener");
+  return fd;
+}
+
+void http::Reactor::accept(int listener, Framing framing) {
+  for (;;) {
+    int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      return;  // EAGAIN, or out of descriptors until a connection closes
+    }
+
+    int enabled = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+
+    Connection *connection;
+    if (!idle.empty()) {
+      connection = idle.back();
+      idle.pop_back();
+    } else {
+      slots.push_back(std::make_unique<Connection>());
+      connection = slots.back().get();
+      connection->in.resize(config.bufferSize);
+      connection->out.reserve(config.bufferSize);
+    }
+    connection->fd = fd;
+    connection->framing = framing;
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = connection;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+      close(connection);
+      continue;
+    }
+    connections.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void http::Reactor::close(Connection *connection) {
+  epoll_ctl(epoll, EPOLL_CTL_DEL, connection->fd, nullptr);
+  ::close(connection->fd);
+
+  connection->fd = -1;
+  connection->received = 0;
+  connection->out.clear();
+  connection->sent = 0;
+  connection->writing = false;
+
+  // A large request grew the buffer, give that back before the slot is reused
+  if (connection->in.size() > config.bufferSize) {
+    connection->in.resize(config.bufferSize);
+    connection->in.shrink_to_fit();
+  }
+  idle.push_back(connection);
+}
+
+void http::Reactor::onReadable(Connection *connection) {
+  for (;;) {
+    auto &in = connection->in;
+    if (connection->received == in.size()) {
+      if (in.size() >= config.maxRequest + kMaxHttpHeader) return close(connection);
+      in.resize(std::min(in.size() * 2, config.maxRequest + kMaxHttpHeader));
+    }
+
+    auto size = ::recv(connection->fd, in.data() + connection->received, in.size() - connection->received, 0);
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (size <= 0) return close(connection);
+
+    connection->received += static_cast<size_t>(size);
+    bytesIn.fetch_add(static_cast<uint64_t>(size), std::memory_order_relaxed);
+    if (connection->received < in.size()) break;
+  }
+
+  if (!dispatch(connection) || !flush(connection)) close(connection);
+}
+
+bool http::Reactor::dispatch(Connection *connection) {
+  size_t offset = 0;
+
+  while (offset < connection->received) {
+    auto used = connection->framing == Framing::Http ? parseHttp(connection, offset) : parseFramed(connection, offset);
+    if (used == kMalformed) return false;
+    if (used == 0) break;
+    offset += used;
+  }
+
+  // Keep the partial request at the start of the buffer
+  if (offset > 0) {
+    std::memmove(connection->in.data(), connection->in.data() + offset, connection->received - offset);
+    connection->received -= offset;
+  }
+  return true;
+}
+
+size_t http::Reactor::parseHttp(Connection *connection, size_t offset) {
+  auto data = reinterpret_cast<const char *>(connection->in.data() + offset);
+  auto available = connection->received - offset;
+
+  auto end = static_cast<const char *>(memmem(data, available, "\r\n\r\n", 4));
+  if (!end) return available > kMaxHttpHeader ? kMalformed : 0;
+
+  auto headSize = static_cast<size_t>(end - data) + 4;
+  auto length = contentLength(data, headSize);
+  if (length < static_cast<int64_t>(sizeof(uint16_t)) || static_cast<size_t>(length) > config.maxRequest) return kMalformed;
+  if (available < headSize + static_cast<size_t>(length)) return 0;
+
+  // Body as the Node server reads it: u16 code, then the player id and payload
+  auto body = reinterpret_cast<const uint8_t *>(data + headSize);
+  uint16_t code;
+  std::memcpy(&code, body, sizeof(code));
+
+  auto &out = connection->out;
+  reply.clear();
+  auto status = static_cast<uint16_t>(game.handle(code, body + sizeof(code), static_cast<size_t>(length) - sizeof(code), reply));
+
+  char head[64];
+  auto headLength = std::snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n", sizeof(status) + reply.size());
+  append(out, head, static_cast<size_t>(headLength));
+  append(out, &status, sizeof(status));
+  append(out, reply.data(), reply.size());
+
+  requests.fetch_add(1, std::memory_order_relaxed);
+  return headSize + static_cast<size_t>(length);
+}
+
+size_t http::Reactor::parseFramed(Connection *connection, size_t offset) {
+  auto data = connection->in.data() + offset;
+  auto available = connection->received - offset;
+  if (available < kFrameHeaderSize) return 0;
+
+  uint16_t code;
+  uint32_t length;
+  std::memcpy(&code, data, sizeof(code));
+  std::memcpy(&length, data + sizeof(code), sizeof(length));
+  if (length > config.maxRequest) return kMalformed;
+  if (available < kFrameHeaderSize + length) return 0;
+
+  // The reply goes straight behind its frame header, the length is filled in afterwards
+  auto &out = connection->out;
+  auto header = out.size();
+  out.resize(header + kFrameHeaderSize);
+  auto status = static_cast<uint16_t>(game.handle(code, data + kFrameHeaderSize, length, out));
+  auto size = static_cast<uint32_t>(out.size() - header - kFrameHeaderSize);
+  std::memcpy(out.data() + header, &status, sizeof(status));
+  std::memcpy(out.data() + header + sizeof(status), &size, sizeof(size));
+
+  requests.fetch_add(1, std::memory_order_relaxed);
+  return kFrameHeaderSize + length;
+}
+
+bool http::Reactor::flush(Connection *connection) {
+  auto &out = connection->out;
+
+  while (connection->sent < out.size()) {
+    auto size = ::send(connection->fd, out.data() + connection->sent, out.size() - connection->sent, MSG_NOSIGNAL);
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (size < 0) return false;
+
+    connection->sent += static_cast<size_t>(size);
+    bytesOut.fetch_add(static_cast<uint64_t>(size), std::memory_order_relaxed);
+  }
+
+  const bool pending = connection->sent < out.size();
+  if (!pending) {
+    out.clear();
+    connection->sent = 0;
+  }
+
+  // Only wait for writability while the socket buffer is full
+  if (pending != connection->writing) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | (pending ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.ptr = connection;
+    if (epoll_ctl(epoll, EPOLL_CTL_MOD, connection->fd, &event) != 0) return false;
+    connection->writing = pending;
+  }
+  return true;
+}
+
+void http::Reactor::run() {
+  epoll_event events[kMaxEvents];
+
+  for (;;) {
+    auto count = epoll_wait(epoll, events, kMaxEvents, -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      fail("epoll_wait failed");
+    }
+
+    for (int i = 0; i < count; ++i) {
+      auto &event = events[i];
+
+      if (event.data.ptr == &wake) return;
+      if (event.data.ptr == &listeners[0]) {
+        accept(listeners[0], Framing::Http);
+        continue;
+      }
+      if (event.data.ptr == &listeners[1]) {
+        accept(listeners[1], Framing::Framed);
+        continue;
+      }
+
+      auto connection = static_cast<Connection *>(event.data.ptr);
+      if (event.events & EPOLLERR) {
+        close(connection);
+        continue;
+      }
+      // Read first: a peer may send its last request and shut down in one go
+      if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        onReadable(connection);
+        if (connection->fd < 0) continue;
+      }
+      if ((event.events & EPOLLOUT) && !flush(connection)) close(connection);
+    }
+  }
+}
+
+void http::Reactor::stop() {
+  uint64_t one = 1;
+  auto result = ::write(wake, &one, sizeof(one));
+  (void)result;
+}
+
+void http::Reactor::addStats(ServerStats &stats) const {
+  stats.connections += connections.load(std::memory_order_relaxed);
+  stats.requests += requests.load(std::memory_order_relaxed);
+  stats.bytesIn += bytesIn.load(std::memory_order_relaxed);
+  stats.bytesOut += bytesOut.load(std::memory_order_relaxed);
+}
+
+// ShmReactor
+
+http::ShmReactor::ShmReactor(bura::LocalServer &game, const ServerConfig &config) : game(game), config(config) {
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll < 0) fail("Failed to create epoll");
+
+  wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake < 0) fail("Failed to create eventfd");
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = &wake;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &event) != 0) fail("Failed to watch eventfd");
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (config.shmSocket.size() >= sizeof(address.sun_path)) throw std::invalid_argument("Socket path too long: " + config.shmSocket);
+  std::memcpy(address.sun_path, config.shmSocket.c_str(), config.shmSocket.size() + 1);
+
+  listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listener < 0) fail("Failed to create socket");
+  // A socket file left behind by a server that was killed would fail the bind
+  ::unlink(config.shmSocket.c_str());
+  if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    throw std::system_error(errno, std::system_category(), "Failed to bind " + config.shmSocket);
+  if (::listen(listener, SOMAXCONN) != 0) fail("Failed to listen");
+
+  event.data.ptr = &listener;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) != 0) fail("Failed to watch listener");
+
+  reply.reserve(kShmSlotSize);
+}
+
+http::ShmReactor::~ShmReactor() {
+  while (!clients.empty()) close(clients.back().get());
+  if (listener >= 0) {
+    ::close(listener);
+    ::unlink(config.shmSocket.c_str());
+  }
+  if (wake >= 0) ::close(wake);
+  if (epoll >= 0) ::close(epoll);
+}
+
+void http::ShmReactor::accept() {
+  for (;;) {
+    int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      return;
+    }
+
+    clients.push_back(std::make_unique<Client>());
+    auto client = clients.back().get();
+    client->socket = fd;
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = client;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+      close(client);
+      continue;
+    }
+    connections.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Maps the segment the client sent with its eventfds; false if the handshake is broken
+bool http::ShmReactor::attach(Client *client) {
+  int fds[3]{-1, -1, -1};
+  char byte;
+  iovec data{&byte, sizeof(byte)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+
+  msghdr message{};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  auto size = ::recvmsg(client->socket, &message, MSG_CMSG_CLOEXEC);
+  if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return true;
+  if (size <= 0) return false;
+
+  auto header = CMSG_FIRSTHDR(&message);
+  if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) return false;
+  std::memcpy(fds, CMSG_DATA(header), std::min(sizeof(fds), static_cast<size_t>(header->cmsg_len - CMSG_LEN(0))));
+
+  // Whatever arrived is ours to close, the eventfds are kept by the client from here on
+  client->requestEvent = fds[1];
+  client->replyEvent = fds[2];
+  struct stat info {};
+  const bool sized = fds[0] >= 0 && fstat(fds[0], &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ShmSegment);
+  void *mapping = sized ? mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0) : MAP_FAILED;
+  if (fds[0] >= 0) ::close(fds[0]);
+  if (mapping == MAP_FAILED || fds[1] < 0 || fds[2] < 0) return false;
+
+  client->segment = static_cast<ShmSegment *>(mapping);
+  if (client->segment->magic != kShmMagic || client->segment->version != kShmVersion) return false;
+
+  // Edge-triggered: every write of the client is one wakeup, run() looks at all rings anyway
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.ptr = nullptr;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, client->requestEvent, &event) != 0) return false;
+
+  byte = 1;
+  return ::send(client->socket, &byte, sizeof(byte), MSG_NOSIGNAL) == sizeof(byte);
+}
+
+void http::ShmReactor::close(Client *client) {
+  epoll_ctl(epoll, EPOLL_CTL_DEL, client->socket, nullptr);
+  ::close(client->socket);
+  if (client->requestEvent >= 0) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, client->requestEvent, nullptr);
+    ::close(client->requestEvent);
+  }
+  if (client->replyEvent >= 0) ::close(client->replyEvent);
+  if (client->segment) munmap(client->segment, sizeof(ShmSegment));
+
+  auto found = std::find_if(clients.begin(), clients.end(), [client](const auto &held) { return held.get() == client; });
+  std::swap(*found, clients.back());
+  clients.pop_back();
+}
+
+bool http::ShmReactor::serve(Client &client) {
+  if (!client.segment) return false;
+  auto &in = client.segment->requests;
+  auto &out = client.segment->replies;
+
+  bool served = false;
+  bool wakeClient = false;
+  while (!in.empty() && !out.full()) {
+    auto &request = in.front();
+    // The slot is client memory; read the header once so the length checked is the length used
+    const uint16_t code = request.code;
+    const uint32_t length = request.length;
+
+    reply.clear();
+    uint16_t status = 1;
+    if (length <= sizeof(request.data)) status = static_cast<uint16_t>(game.handle(code, request.data, length, reply));
+    // A nickname past kShmMaxNickname, or a batch fetch: the reply does not fit a slot
+    if (reply.size() > sizeof(ShmSlot::data)) {
+      status = 1;
+      reply.clear();
+    }
+    in.pop();
+
+    auto &slot = out.back();
+    slot.code = status;
+    slot.length = static_cast<uint32_t>(reply.size());
+    std::memcpy(slot.data, reply.data(), reply.size());
+    wakeClient |= out.push();
+
+    requests.fetch_add(1, std::memory_order_relaxed);
+    bytesIn.fetch_add(sizeof(code) + length, std::memory_order_relaxed);
+    bytesOut.fetch_add(sizeof(status) + reply.size(), std::memory_order_relaxed);
+    served = true;
+  }
+
+  if (wakeClient) {
+    uint64_t one = 1;
+    auto result = ::write(client.replyEvent, &one, sizeof(one));
+    (void)result;
+  }
+  return served;
+}
+
+bool http::ShmReactor::dispatch(int timeout) {
+  epoll_event events[kMaxEvents];
+
+  auto count = epoll_wait(epoll, events, kMaxEvents, timeout);
+  if (count < 0) {
+    if (errno == EINTR) return true;
+    fail("epoll_wait failed");
+  }
+
+  for (int i = 0; i < count; ++i) {
+    auto &event = events[i];
+
+    if (event.data.ptr == &wake) return false;
+    if (event.data.ptr == &listener) {
+      accept();
+      continue;
+    }
+    // A request eventfd: run() polls every ring after this returns
+    if (!event.data.ptr) continue;
+
+    // After the handshake the client never writes to its socket, anything but the segment is a hang-up
+    auto client = static_cast<Client *>(event.data.ptr);
+    const bool hangup = event.events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP);
+    if (client->segment || hangup || !attach(client)) close(client);
+  }
+  return true;
+}
+
+void http::ShmReactor::run() {
+  using Clock = std::chrono::steady_clock;
+  auto idleSince = Clock::now();
+
+  for (uint32_t round = 1;; ++round) {
+    bool busy = false;
+    for (auto &client : clients) busy |= serve(*client);
+
+    const auto now = Clock::now();
+    if (busy) idleSince = now;
+
+    if (now - idleSince >= config.shmSpin) {
+      // Sleep only if every ring agreed; a request published in between cancels it
+      bool asleep = true;
+      for (auto &client : clients)
+        if (client->segment && !client->segment->requests.prepareSleep()) asleep = false;
+
+      if (asleep && !dispatch(-1)) return;
+      for (auto &client : clients)
+        if (client->segment) client->segment->requests.wakeUp();
+      idleSince = Clock::now();
+      continue;
+    }
+
+    // New clients and hang-ups are seen while spinning too
+    if (round % 1024 == 0 && !dispatch(0)) return;
+    spinPause();
+  }
+}
+
+void http::ShmReactor::stop() {
+  uint64_t one = 1;
+  auto result = ::write(wake, &one, sizeof(one));
+  (void)result;
+}
+
+void http::ShmReactor::addStats(ServerStats &stats) const {
+  stats.connections += connections.load(std::memory_order_relaxed);
+  stats.requests += requests.load(std::memory_order_relaxed);
+  stats.bytesIn += bytesIn.load(std::memory_order_relaxed);
+  stats.bytesOut += bytesOut.load(std::memory_order_relaxed);
+}
+
+// GameServer
+
+http::GameServer::GameServer(ServerConfig config, bura::LocalServerConfig gameConfig) : config(std::move(config)), game(gameConfig) {
+  this->config.threads = std::max<size_t>(this->config.threads, 1);
+}
+
+http::GameServer::~GameServer() { stop(); }
+
+void http::GameServer::start() {
+  for (size_t i = 0; i < config.threads; ++i) reactors.push_back(std::make_unique<Reactor>(game, config));
+  for (auto &reactor : reactors) threads.emplace_back(&Reactor::run, reactor.get());
+
+  if (!config.shmSocket.empty()) {
+    shmReactor = std::make_unique<ShmReactor>(game, config);
+    threads.emplace_back(&ShmReactor::run, shmReactor.get());
+  }
+}
+
+void http::GameServer::stop() {
+  for (auto &reactor : reactors) reactor->stop();
+  if (shmReactor) shmReactor->stop();
+  for (auto &thread : threads) thread.join();
+  threads.clear();
+}
+
+http::ServerStats http::GameServer::stats() const {
+  ServerStats result;
+  for (const auto &reactor : reactors) reactor->addStats(result);
+  if (shmReactor) shmReactor->addStats(result);
+  return result;
+}
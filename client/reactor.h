@@ -0,0 +1,159 @@
+#ifndef CLIENT_REACTOR_H
+#define CLIENT_REACTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loopback.h"
+#include "shm.h"
+
+// Native game server (Linux): the LocalServer rules behind the same HTTP and framed protocols as the Node server.
+// Every thread runs its own epoll reactor with its own SO_REUSEPORT listeners, so the kernel spreads connections
+// over the cores and a connection never changes threads.
+
+namespace http {
+
+enum class Framing : uint8_t { Http, Framed };
+
+struct ServerConfig {
+  std::string host{"0.0.0.0"};
+  uint16_t httpPort{2021};
+  uint16_t framedPort{2022};
+  size_t threads{std::thread::hardware_concurrency()};
+  size_t bufferSize{16 * 1024};  // preallocated per connection, only a larger request grows it
+  size_t maxRequest{1024 * 1024};
+  std::string shmSocket{kShmSocketPath};  // Unix socket for shared-memory clients, empty disables them
+  // The shared-memory reactor polls its rings this long before it sleeps; no use on a single CPU
+  std::chrono::microseconds shmSpin{std::thread::hardware_concurrency() > 1 ? 100 : 0};
+};
+
+struct ServerStats {
+  uint64_t connections{0};
+  uint64_t requests{0};
+  uint64_t bytesIn{0};
+  uint64_t bytesOut{0};
+};
+
+class Reactor final {
+ private:
+  struct Connection {
+    int fd{-1};
+    Framing framing{Framing::Http};
+    std::vector<uint8_t> in;
+    size_t received{0};
+    std::vector<uint8_t> out;
+    size_t sent{0};
+    bool writing{false};  // EPOLLOUT is armed
+  };
+
+  bura::LocalServer &game;
+  const ServerConfig &config;
+  int epoll{-1};
+  int wake{-1};
+  int listeners[2]{-1, -1};
+
+  // Connections are recycled with their buffers; the epoll data of a socket points at its slot
+  std::vector<std::unique_ptr<Connection>> slots;
+  std::vector<Connection *> idle;
+  std::vector<uint8_t> reply;  // HTTP replies are written here first, their header needs the length
+
+  std::atomic<uint64_t> connections{0};
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> bytesIn{0};
+  std::atomic<uint64_t> bytesOut{0};
+
+  int listen(uint16_t port, void *tag);
+  void accept(int listener, Framing framing);
+  void close(Connection *connection);
+
+  void onReadable(Connection *connection);
+  bool flush(Connection *connection);
+  // Handles every complete request in the input buffer; false if the stream is malformed
+  bool dispatch(Connection *connection);
+  size_t parseHttp(Connection *connection, size_t offset);
+  size_t parseFramed(Connection *connection, size_t offset);
+
+ public:
+  Reactor(bura::LocalServer &game, const ServerConfig &config);
+  Reactor(const Reactor &) = delete;
+  ~Reactor();
+
+  void run();
+  // Makes run() return; safe from any thread
+  void stop();
+
+  void addStats(ServerStats &stats) const;
+};
+
+// Serves the shared-memory clients (see shm.h) on a thread of its own. While requests come in it only polls the
+// rings; once they are idle for shmSpin it sleeps in epoll on their eventfds, the listener and the client sockets.
+class ShmReactor final {
+ private:
+  struct Client {
+    int socket{-1};
+    int requestEvent{-1};
+    int replyEvent{-1};
+    ShmSegment *segment{nullptr};  // null until the client sent its segment
+  };
+
+  bura::LocalServer &game;
+  const ServerConfig &config;
+  int epoll{-1};
+  int wake{-1};
+  int listener{-1};
+
+  std::vector<std::unique_ptr<Client>> clients;
+  std::vector<uint8_t> reply;
+
+  std::atomic<uint64_t> connections{0};
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> bytesIn{0};
+  std::atomic<uint64_t> bytesOut{0};
+
+  void accept();
+  bool attach(Client *client);
+  void close(Client *client);
+  // Handles the queued requests of a client as long as its reply ring has room; false if there were none
+  bool serve(Client &client);
+  // Runs the ready epoll events; false once stop() was called
+  bool dispatch(int timeout);
+
+ public:
+  ShmReactor(bura::LocalServer &game, const ServerConfig &config);
+  ShmReactor(const ShmReactor &) = delete;
+  ~ShmReactor();
+
+  void run();
+  void stop();
+
+  void addStats(ServerStats &stats) const;
+};
+
+// A reactor per thread over one LocalServer, plus the shared-memory reactor
+class GameServer final {
+ private:
+  ServerConfig config;
+  bura::LocalServer game;
+  std::vector<std::unique_ptr<Reactor>> reactors;
+  std::unique_ptr<ShmReactor> shmReactor;
+  std::vector<std::thread> threads;
+
+ public:
+  explicit GameServer(ServerConfig config, bura::LocalServerConfig gameConfig = {});
+  GameServer(const GameServer &) = delete;
+  ~GameServer();
+
+  void start();
+  void stop();
+
+  [[nodiscard]] ServerStats stats() const;
+};
+
+}  // namespace http
+
+#endif  // CLIENT_REACTOR_H
@@ -0,0 +1,382 @@
+#include "record.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include "protocol.h"
+
+using namespace bura;
+using namespace bura::record;
+
+namespace {
+
+int seek(std::FILE *file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<int64_t>(offset), SEEK_SET);
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+uint64_t fileSize(std::FILE *file) {
+#ifdef _WIN32
+  _fseeki64(file, 0, SEEK_END);
+  return static_cast<uint64_t>(_ftelli64(file));
+#else
+  fseeko(file, 0, SEEK_END);
+  return static_cast<uint64_t>(ftello(file));
+#endif
+}
+
+template <typename T>
+void writeValue(std::vector<uint8_t> &buffer, const T &value) {
+  auto data = reinterpret_cast<const uint8_t *>(&value);
+  buffer.insert(buffer.end(), data, data + sizeof(T));
+}
+
+uint8_t clampCount(size_t count) { return static_cast<uint8_t>(std::min<size_t>(count, kDeckSize)); }
+
+}  // namespace
+
+// Snapshot
+
+Snapshot Snapshot::from(const GameState &state) {
+  Snapshot result;
+  result.status = state.status;
+  result.trump = state.trump.index();
+  result.inHeap = state.inHeap;
+  result.inFall = state.inFall;
+  result.opponentCards = clampCount(state.opponent_cards.size());
+  result.hand = Card::mask(state.my_cards);
+
+  result.attackCount = clampCount(state.attack_cards.size());
+  for (uint8_t i = 0; i < result.attackCount; ++i) result.attack[i] = state.attack_cards[i].index();
+
+  result.defendCount = clampCount(state.defend_cards.size());
+  for (uint8_t i = 0; i < result.defendCount; ++i) result.defend[i] = state.defend_cards[i].index();
+
+  return result;
+}
+
+void Snapshot::apply(GameState &state) const {
+  state.status = status;
+  state.trump = Card::fromIndex(trump);
+  state.inHeap = inHeap;
+  state.inFall = inFall;
+
+  state.my_cards.clear();
+  for (CardMask rest = hand; rest != 0; rest &= rest - 1) state.my_cards.emplace_back(Card::fromIndex(lowestCard(rest)));
+
+  state.opponent_cards.assign(opponentCards, Card(CardSuit::None, CardValue::None, true));
+
+  state.attack_cards.clear();
+  for (uint8_t i = 0; i < attackCount; ++i) state.attack_cards.emplace_back(Card::fromIndex(attack[i]));
+
+  state.defend_cards.clear();
+  for (uint8_t i = 0; i < defendCount; ++i) state.defend_cards.emplace_back(Card::fromIndex(defend[i]));
+}
+
+bool Snapshot::sameTable(const Snapshot &other) const {
+  return attackCount == other.attackCount && defendCount == other.defendCount &&
+         std::equal(attack.begin(), attack.begin() + attackCount, other.attack.begin()) &&
+         std::equal(defend.begin(), defend.begin() + defendCount, other.defend.begin());
+}
+
+bool Snapshot::operator==(const Snapshot &other) const {
+  return status == other.status && trump == other.trump && inHeap == other.inHeap && inFall == other.inFall &&
+         opponentCards == other.opponentCards && hand == other.hand && sameTable(other);
+}
+
+// EventCursor
+
+bool EventCursor::next() {
+  if (position >= end) return false;
+  if (end - position < static_cast<ptrdiff_t>(sizeof(EventHeader))) throw std::runtime_error("Truncated record event");
+
+  std::memcpy(&header, position, sizeof(EventHeader));
+  position += sizeof(EventHeader);
+
+  size_t payload = 0;
+  if (header.flags & HandChanged) payload += sizeof(CardMask);
+  if (header.kind != EventKind::State)
+    payload += header.cardCount;
+  else if (header.flags & TableChanged)
+    payload += header.cardCount + header.defendCount;
+
+  if (static_cast<size_t>(end - position) < payload || header.cardCount > kDeckSize || header.defendCount > kDeckSize)
+    throw std::runtime_error("Corrupted record event");
+
+  if (header.flags & HandChanged) {
+    CardMask delta;
+    std::memcpy(&delta, position, sizeof(CardMask));
+    snapshot.hand ^= delta;
+    position += sizeof(CardMask);
+  }
+
+  if (header.kind != EventKind::State) {
+    cards = position;
+    position += header.cardCount;
+    return true;
+  }
+
+  snapshot.status = static_cast<GameStatus>(header.status);
+  snapshot.trump = header.trump;
+  snapshot.inHeap = header.inHeap;
+  snapshot.inFall = header.inFall;
+  snapshot.opponentCards = header.opponentCards;
+
+  if (header.flags & TableChanged) {
+    snapshot.attackCount = header.cardCount;
+    snapshot.defendCount = header.defendCount;
+    std::memcpy(snapshot.attack.data(), position, header.cardCount);
+    position += header.cardCount;
+    std::memcpy(snapshot.defend.data(), position, header.defendCount);
+    position += header.defendCount;
+  }
+
+  return true;
+}
+
+std::vector<Card> EventCursor::moveCards() const {
+  std::vector<Card> result;
+  result.reserve(moveSize());
+  for (size_t i = 0; i < moveSize(); ++i) result.emplace_back(moveCard(i));
+  return result;
+}
+
+// GameView
+
+GameView::GameView(const uint8_t *begin, const uint8_t *end) {
+  if (end - begin < static_cast<ptrdiff_t>(sizeof(GameHeader))) throw std::runtime_error("Truncated record game");
+  std::memcpy(&header, begin, sizeof(GameHeader));
+
+  nicknameData = begin + sizeof(GameHeader);
+  body = nicknameData + header.nicknameLength;
+
+  if (body > end || static_cast<uint64_t>(end - body) < header.bodySize) throw std::runtime_error("Truncated record game");
+}
+
+// RecordReader
+
+RecordReader::RecordReader(const std::string &path) : file(path) {
+  if (file.size() < sizeof(FileHeader) + sizeof(Footer)) throw std::runtime_error("Invalid record file: " + path);
+
+  FileHeader fileHeader;
+  std::memcpy(&fileHeader, file.begin(), sizeof(FileHeader));
+  if (fileHeader.magic != kFileMagic) throw std::runtime_error("Invalid record file: " + path);
+  if (fileHeader.version != kVersion) throw std::runtime_error("Unsupported record version in " + path);
+
+  Footer footer;
+  std::memcpy(&footer, file.end() - sizeof(Footer), sizeof(Footer));
+  if (footer.magic != kIndexMagic) throw std::runtime_error("Record index is missing in " + path);
+
+  auto indexEnd = file.size() - sizeof(Footer);
+  if (footer.indexOffset < sizeof(FileHeader) || footer.indexOffset > indexEnd ||
+      (indexEnd - footer.indexOffset) / sizeof(IndexEntry) < footer.gameCount)
+    throw std::runtime_error("Corrupted record index in " + path);
+
+  index = file.begin() + footer.indexOffset;
+  indexOffset = footer.indexOffset;
+  gameCount = footer.gameCount;
+}
+
+IndexEntry RecordReader::entry(size_t i) const {
+  if (i >= gameCount) throw std::out_of_range("Record game index out of range");
+  IndexEntry result;
+  std::memcpy(&result, index + i * sizeof(IndexEntry), sizeof(IndexEntry));
+  return result;
+}
+
+GameView RecordReader::game(size_t i) const {
+  auto item = entry(i);
+  if (item.offset >= indexOffset) throw std::runtime_error("Corrupted record index");
+  return {file.begin() + item.offset, file.begin() + indexOffset};
+}
+
+// GameRecorder
+
+GameRecorder::GameRecorder(const std::string &path) {
+  file = std::fopen(path.c_str(), "r+b");
+  if (file == nullptr) file = std::fopen(path.c_str(), "w+b");
+  if (file == nullptr) throw std::system_error(errno, std::system_category(), "Failed to open " + path);
+
+  auto size = fileSize(file);
+
+  if (size == 0) {
+    FileHeader header{kFileMagic, kVersion, 0};
+    std::fwrite(&header, sizeof(header), 1, file);
+    indexOffset = sizeof(FileHeader);
+    writeIndex();
+    return;
+  }
+
+  FileHeader header{};
+  Footer footer{};
+  bool valid = size >= sizeof(FileHeader) + sizeof(Footer) && seek(file, 0) == 0 && std::fread(&header, sizeof(header), 1, file) == 1 &&
+               seek(file, size - sizeof(Footer)) == 0 && std::fread(&footer, sizeof(footer), 1, file) == 1;
+
+  valid = valid && header.magic == kFileMagic && header.version == kVersion && footer.magic == kIndexMagic &&
+          footer.indexOffset + static_cast<uint64_t>(footer.gameCount) * sizeof(IndexEntry) + sizeof(Footer) == size;
+
+  if (valid) {
+    index.resize(footer.gameCount);
+    valid = seek(file, footer.indexOffset) == 0 && std::fread(index.data(), sizeof(IndexEntry), index.size(), file) == index.size();
+  }
+
+  if (!valid) {
+    std::fclose(file);
+    throw std::runtime_error("Invalid record file: " + path);
+  }
+
+  indexOffset = footer.indexOffset;
+}
+
+GameRecorder::~GameRecorder() {
+  try {
+    flush();
+  } catch (std::exception &) {
+  }
+  std::fclose(file);
+}
+
+GameRecorder::Game &GameRecorder::open(const std::string &id) {
+  auto &game = games[id];
+  if (game.header.eventCount == 0) {
+    std::memcpy(game.header.id, id.data(), std::min(id.size(), sizeof(game.header.id)));
+    game.header.startTime =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+  return game;
+}
+
+void GameRecorder::append(Game &game, const EventHeader &header, const uint8_t *payload, size_t length) {
+  auto data = reinterpret_cast<const uint8_t *>(&header);
+  game.body.insert(game.body.end(), data, data + sizeof(EventHeader));
+  game.body.insert(game.body.end(), payload, payload + length);
+  game.header.eventCount++;
+}
+
+void GameRecorder::state(const GameState &state) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (finished.count(state.id) != 0) return;
+
+  auto snapshot = Snapshot::from(state);
+  auto &game = open(state.id);
+
+  if (game.hasState && snapshot == game.last) return;
+
+  EventHeader header{};
+  header.time = static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - game.start).count());
+  header.kind = EventKind::State;
+  header.status = static_cast<int8_t>(snapshot.status);
+  header.trump = snapshot.trump;
+  header.inHeap = snapshot.inHeap;
+  header.inFall = snapshot.inFall;
+  header.opponentCards = snapshot.opponentCards;
+  header.cardCount = snapshot.attackCount;
+  header.defendCount = snapshot.defendCount;
+
+  std::vector<uint8_t> payload;
+  auto delta = snapshot.hand ^ game.last.hand;
+
+  if (delta != 0) {
+    header.flags |= HandChanged;
+    writeValue(payload, delta);
+  }
+
+  if (!game.hasState || !snapshot.sameTable(game.last)) {
+    header.flags |= TableChanged;
+    payload.insert(payload.end(), snapshot.attack.begin(), snapshot.attack.begin() + snapshot.attackCount);
+    payload.insert(payload.end(), snapshot.defend.begin(), snapshot.defend.begin() + snapshot.defendCount);
+  }
+
+  append(game, header, payload.data(), payload.size());
+
+  game.last = snapshot;
+  game.hasState = true;
+  game.header.result = static_cast<int8_t>(snapshot.status);
+
+  if (!state.opponentNickname.empty()) {
+    game.nickname = proto::toUtf8(state.opponentNickname);
+    // The header keeps one length byte; never cut a character in half
+    if (game.nickname.size() > 255) {
+      size_t length = 255;
+      while ((static_cast<uint8_t>(game.nickname[length]) & 0xC0) == 0x80) --length;
+      game.nickname.resize(length);
+    }
+  }
+
+  if (snapshot.status == GameStatus::Win || snapshot.status == GameStatus::Lose) {
+    write(game);
+    games.erase(state.id);
+    finished.insert(state.id);
+  }
+}
+
+void GameRecorder::move(const std::string &id, EventKind kind, const std::vector<Card> &cards, int status) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (finished.count(id) != 0) return;
+
+  auto &game = open(id);
+
+  EventHeader header{};
+  header.time = static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - game.start).count());
+  header.kind = kind;
+  header.status = static_cast<int8_t>(status);
+  header.trump = game.last.trump;
+  header.inHeap = game.last.inHeap;
+  header.inFall = game.last.inFall;
+  header.opponentCards = game.last.opponentCards;
+  header.cardCount = clampCount(cards.size());
+
+  std::vector<uint8_t> payload;
+  payload.reserve(header.cardCount);
+  for (uint8_t i = 0; i < header.cardCount; ++i) payload.push_back(cards[i].index());
+
+  append(game, header, payload.data(), payload.size());
+}
+
+void GameRecorder::write(Game &game) {
+  if (game.header.eventCount == 0) return;
+
+  game.header.bodySize = static_cast<uint32_t>(game.body.size());
+  game.header.nicknameLength = static_cast<uint8_t>(game.nickname.size());
+
+  if (seek(file, indexOffset) != 0) throw std::system_error(errno, std::system_category(), "Failed to seek record file");
+
+  bool written = std::fwrite(&game.header, sizeof(GameHeader), 1, file) == 1 &&
+                 std::fwrite(game.nickname.data(), 1, game.nickname.size(), file) == game.nickname.size() &&
+                 std::fwrite(game.body.data(), 1, game.body.size(), file) == game.body.size();
+
+  if (!written) throw std::system_error(errno, std::system_category(), "Failed to write record file");
+
+  IndexEntry entry{};
+  entry.offset = indexOffset;
+  entry.eventCount = game.header.eventCount;
+  entry.result = game.header.result;
+  index.push_back(entry);
+
+  indexOffset += sizeof(GameHeader) + game.nickname.size() + game.body.size();
+  writeIndex();
+}
+
+void GameRecorder::writeIndex() {
+  Footer footer{indexOffset, static_cast<uint32_t>(index.size()), kIndexMagic};
+
+  if (seek(file, indexOffset) != 0) throw std::system_error(errno, std::system_category(), "Failed to seek record file");
+
+  bool written = std::fwrite(index.data(), sizeof(IndexEntry), index.size(), file) == index.size() &&
+                 std::fwrite(&footer, sizeof(Footer), 1, file) == 1 && std::fflush(file) == 0;
+
+  if (!written) throw std::system_error(errno, std::system_category(), "Failed to write record index");
+}
+
+void GameRecorder::flush() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &item : games) write(item.second);
+  games.clear();
+}
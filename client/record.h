@@ -0,0 +1,202 @@
+#ifndef CLIENT_RECORD_H
+#define CLIENT_RECORD_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "game.h"
+#include "mapped_file.h"
+
+// Binary game record.
+//
+// File layout: FileHeader, game blocks, IndexEntry[gameCount], Footer.
+// Game block: GameHeader, opponent nickname, events.
+// Event: EventHeader, [uint64 hand xor delta], [card indices].
+// The index and footer are rewritten after every finished game, so the file is readable while a recorder is appending to it.
+
+namespace bura::record {
+
+constexpr uint32_t kFileMagic = 0x41525542;   // "BURA"
+constexpr uint32_t kIndexMagic = 0x58444942;  // "BIDX"
+constexpr uint16_t kVersion = 1;
+
+enum struct EventKind : uint8_t { State = 0, Move = 1, Defend = 2, Pass = 3 };
+
+enum EventFlags : uint8_t {
+  HandChanged = 1 << 0,
+  TableChanged = 1 << 1,
+};
+
+#pragma pack(push, 1)
+struct FileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+};
+
+struct GameHeader {
+  char id[8];
+  int64_t startTime;  // unix time, ms
+  uint32_t eventCount;
+  uint32_t bodySize;  // events only
+  int8_t result;      // last GameStatus
+  uint8_t nicknameLength;
+  uint8_t reserved[2];
+};
+
+struct EventHeader {
+  uint32_t time;  // ms since the first event of the game
+  EventKind kind;
+  int8_t status;  // GameStatus for states, server reply code for moves
+  uint8_t flags;
+  uint8_t trump;
+  uint8_t inHeap;
+  uint8_t inFall;
+  uint8_t opponentCards;
+  uint8_t cardCount;  // attack cards for states, submitted cards for moves
+  uint8_t defendCount;
+  uint8_t reserved[3];
+};
+
+struct IndexEntry {
+  uint64_t offset;
+  uint32_t eventCount;
+  int8_t result;
+  uint8_t reserved[3];
+};
+
+struct Footer {
+  uint64_t indexOffset;
+  uint32_t gameCount;
+  uint32_t magic;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FileHeader) == 8, "FileHeader must be 8 bytes");
+static_assert(sizeof(GameHeader) == 28, "GameHeader must be 28 bytes");
+static_assert(sizeof(EventHeader) == 16, "EventHeader must be 16 bytes");
+static_assert(sizeof(IndexEntry) == 16, "IndexEntry must be 16 bytes");
+static_assert(sizeof(Footer) == 16, "Footer must be 16 bytes");
+
+struct Snapshot {
+  GameStatus status{GameStatus::None};
+  uint8_t trump{kNoCard};
+  uint8_t inHeap{};
+  uint8_t inFall{};
+  uint8_t opponentCards{};
+  CardMask hand{};
+
+  uint8_t attackCount{};
+  uint8_t defendCount{};
+  std::array<uint8_t, kDeckSize> attack{};
+  std::array<uint8_t, kDeckSize> defend{};
+
+  static Snapshot from(const GameState &state);
+  void apply(GameState &state) const;
+
+  [[nodiscard]] bool sameTable(const Snapshot &other) const;
+  bool operator==(const Snapshot &other) const;
+  bool operator!=(const Snapshot &other) const { return !(*this == other); }
+};
+
+class EventCursor final {
+ private:
+  const uint8_t *position;
+  const uint8_t *end;
+  EventHeader header{};
+  Snapshot snapshot{};
+  const uint8_t *cards{nullptr};
+
+ public:
+  EventCursor(const uint8_t *begin, const uint8_t *end) : position(begin), end(end) {}
+
+  bool next();
+
+  [[nodiscard]] const EventHeader &event() const { return header; }
+  [[nodiscard]] const Snapshot &state() const { return snapshot; }
+
+  // Cards of a Move/Defend event
+  [[nodiscard]] size_t moveSize() const { return header.kind == EventKind::State ? 0 : header.cardCount; }
+  [[nodiscard]] Card moveCard(size_t i) const { return Card::fromIndex(cards[i]); }
+  [[nodiscard]] std::vector<Card> moveCards() const;
+};
+
+class GameView final {
+ private:
+  GameHeader header{};
+  const uint8_t *nicknameData;
+  const uint8_t *body;
+
+ public:
+  GameView(const uint8_t *begin, const uint8_t *end);
+
+  [[nodiscard]] std::string id() const { return {header.id, sizeof(header.id)}; }
+  [[nodiscard]] std::string nickname() const { return {reinterpret_cast<const char *>(nicknameData), header.nicknameLength}; }
+  [[nodiscard]] GameStatus result() const { return static_cast<GameStatus>(header.result); }
+  [[nodiscard]] int64_t startTime() const { return header.startTime; }
+  [[nodiscard]] uint32_t eventCount() const { return header.eventCount; }
+  [[nodiscard]] EventCursor events() const { return {body, body + header.bodySize}; }
+};
+
+class RecordReader final {
+ private:
+  MappedFile file;
+  const uint8_t *index{nullptr};
+  uint32_t gameCount{0};
+  uint64_t indexOffset{0};
+
+ public:
+  explicit RecordReader(const std::string &path);
+
+  [[nodiscard]] size_t size() const { return gameCount; }
+  [[nodiscard]] IndexEntry entry(size_t i) const;
+  [[nodiscard]] GameView game(size_t i) const;
+};
+
+class GameRecorder final {
+ private:
+  struct Game {
+    GameHeader header{};
+    std::string nickname;
+    std::vector<uint8_t> body;
+    Snapshot last{};
+    bool hasState{false};
+    std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+  };
+
+  std::mutex mutex;
+  std::FILE *file{nullptr};
+  uint64_t indexOffset{0};
+  std::vector<IndexEntry> index;
+  std::unordered_map<std::string, Game> games;
+  std::unordered_set<std::string> finished;
+
+  Game &open(const std::string &id);
+  void append(Game &game, const EventHeader &header, const uint8_t *payload, size_t length);
+  void write(Game &game);
+  void writeIndex();
+
+ public:
+  explicit GameRecorder(const std::string &path);
+  GameRecorder(const GameRecorder &) = delete;
+  ~GameRecorder();
+
+  GameRecorder &operator=(const GameRecorder &) = delete;
+
+  void state(const GameState &state);
+  void move(const std::string &id, EventKind kind, const std::vector<Card> &cards, int status);
+
+  // Writes every unfinished game
+  void flush();
+};
+
+}  // namespace bura::record
+
+#endif  // CLIENT_RECORD_H
@@ -0,0 +1,30 @@
+#include "rng.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <random>
+
+using namespace bura;
+
+namespace {
+
+std::atomic<uint64_t> threadCount{0};
+
+uint64_t initialSeed() {
+  if (const char *seed = std::getenv("BURA_SEED")) return std::strtoull(seed, nullptr, 0);
+
+  std::random_device device;
+  return static_cast<uint64_t>(device()) << 32 | device();
+}
+
+}  // namespace
+
+uint64_t bura::rootSeed() {
+  static const uint64_t seed = initialSeed();
+  return seed;
+}
+
+Rng &bura::threadRng() {
+  thread_local Rng rng = SeedTree{rootSeed()}.child(threadCount++).rng();
+  return rng;
+}
@@ -0,0 +1,99 @@
+#ifndef CLIENT_RNG_H
+#define CLIENT_RNG_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+// All randomness of the client: xoshiro256** generators seeded through splitmix64, a seed tree for reproducible
+// parallel runs, and one generator per thread for everything that does not need its own.
+
+namespace bura {
+
+inline uint64_t splitMix(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// A UniformRandomBitGenerator, so the std:: distributions take it too
+class Rng final {
+ private:
+  std::array<uint64_t, 4> s{};
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+ public:
+  using result_type = uint64_t;
+
+  explicit Rng(uint64_t seed) {
+    for (auto &word : s) word = splitMix(seed);
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  result_type operator()() {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  // Uniform in [0, bound), bound > 0, without modulo bias: Lemire's multiply-and-reject, which rarely divides
+  uint64_t below(uint64_t bound) {
+    auto product = static_cast<unsigned __int128>((*this)()) * bound;
+    auto low = static_cast<uint64_t>(product);
+    if (low < bound) {
+      const uint64_t threshold = (0 - bound) % bound;
+      while (low < threshold) {
+        product = static_cast<unsigned __int128>((*this)()) * bound;
+        low = static_cast<uint64_t>(product);
+      }
+    }
+    return static_cast<uint64_t>(product >> 64);
+  }
+
+  // Uniform in [0, 1), from the top 53 bits
+  double uniform() { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+  double uniform(double low, double high) { return low + (high - low) * uniform(); }
+
+  // Fisher-Yates
+  template <typename Iterator>
+  void shuffle(Iterator first, Iterator last) {
+    for (auto n = static_cast<uint64_t>(std::distance(first, last)); n > 1; --n) std::iter_swap(first + (n - 1), first + below(n));
+  }
+
+  // An independent generator seeded from this one
+  Rng fork() { return Rng((*this)()); }
+};
+
+// Node of a seed tree: child(i) gives the i-th worker, game or deal a seed of its own, so a parallel run
+// reproduces from the root seed however the work is scheduled
+struct SeedTree {
+  uint64_t seed;
+
+  [[nodiscard]] SeedTree child(uint64_t index) const {
+    uint64_t state = seed ^ (index * 0xD1B54A32D192ED03ull);
+    splitMix(state);
+    return {splitMix(state)};
+  }
+  [[nodiscard]] Rng rng() const { return Rng(seed); }
+};
+
+// The root of threadRng's tree: BURA_SEED if it is set, otherwise from std::random_device, once per process
+uint64_t rootSeed();
+// This thread's generator, the child of rootSeed() numbered in the order threads first ask for one
+Rng &threadRng();
+
+}  // namespace bura
+
+#endif  // CLIENT_RNG_H
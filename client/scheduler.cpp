@@ -0,0 +1,157 @@
+#include "scheduler.h"
+
+#include <cstring>
+
+#include "framed.h"
+#include "game.h"
+#include "protocol.h"
+#include "trace.h"
+
+using namespace bura;
+
+FetchScheduler::FetchScheduler(const std::string &host, const std::string &port, http::TransportKind transport, size_t maxBatch,
+                               std::chrono::microseconds window)
+    : transport(http::makeTransport(transport, host, port, std::chrono::seconds(5))),
+      id(generateRandomString(8)),
+      maxBatch(std::max<size_t>(maxBatch, 1)),
+      window(window) {
+  worker = std::thread(&FetchScheduler::run, this);
+}
+
+FetchScheduler::~FetchScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    isExit = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+std::future<FetchResult> FetchScheduler::fetch(const std::string &playerId) {
+  auto promise = std::make_shared<std::promise<FetchResult>>();
+  auto future = promise->get_future();
+
+  fetch(playerId, [promise](FetchResult result) {
+    if (result.error)
+      promise->set_exception(result.error);
+    else
+      promise->set_value(std::move(result));
+  });
+
+  return future;
+}
+
+void FetchScheduler::fetch(const std::string &playerId, FetchCallback done) {
+  Pending item{playerId, std::move(done)};
+  item.id.resize(8, ' ');
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(std::move(item));
+    counters.schedulerQueue.add();
+    if (pending.size() != 1 && pending.size() < maxBatch) return;
+  }
+
+  wake.notify_one();
+}
+
+void FetchScheduler::call(uint16_t code, std::vector<uint8_t> payload, FetchCallback done) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    calls.push_back({code, std::move(payload), std::move(done)});
+    counters.schedulerQueue.add();
+  }
+
+  wake.notify_one();
+}
+
+void FetchScheduler::run() {
+  trace::setThreadName("FetchScheduler");
+  std::vector<Pending> batch;
+  std::vector<Call> single;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return isExit || !pending.empty() || !calls.empty(); });
+
+      // Give the other clients' polls a moment to join the batch, unless calls are waiting anyway
+      if (calls.empty()) wake.wait_for(lock, window, [&] { return isExit || pending.size() >= maxBatch || !calls.empty(); });
+
+      if (pending.empty() && calls.empty() && isExit) return;
+
+      single.swap(calls);
+
+      auto count = std::min(pending.size(), maxBatch);
+      batch.assign(std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.begin() + static_cast<std::ptrdiff_t>(count)));
+      pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(count));
+      counters.schedulerQueue.sub(static_cast<int64_t>(single.size() + batch.size()));
+    }
+
+    for (auto &item : single) send(item);
+    single.clear();
+
+    if (!batch.empty()) send(batch);
+    batch.clear();
+  }
+}
+
+void FetchScheduler::send(std::vector<Pending> &batch) {
+  TRACE_SCOPE("FetchScheduler::send");
+
+  std::vector<FetchResult> results(batch.size());
+
+  try {
+    proto::BatchFetch request{id, {}};
+    request.players.reserve(batch.size());
+    for (auto &item : batch) request.players.push_back(item.id);
+    auto result = transport->call(kBatchFetchCode, proto::BatchFetchRequest::encode(request));
+
+    batches.fetch_add(1, std::memory_order_relaxed);
+    fetches.fetch_add(batch.size(), std::memory_order_relaxed);
+    counters.fetches.add(batch.size());
+
+    if (result.status != 0) throw http::httpResponseError("Batch fetch failed with status " + std::to_string(result.status));
+
+    auto data = result.data.data();
+    auto end = data + result.data.size();
+    uint32_t count = 0;
+
+    if (end - data < static_cast<std::ptrdiff_t>(sizeof(count))) throw http::httpResponseError("Truncated batch fetch reply");
+    std::memcpy(&count, data, sizeof(count));
+    data += sizeof(count);
+
+    // Entries missing from a short reply keep status 1, like a fetch for a player without a lobby
+    for (size_t i = 0; i < batch.size() && i < count && end - data >= 6; ++i) {
+      uint16_t status;
+      uint32_t size;
+      std::memcpy(&status, data, sizeof(status));
+      std::memcpy(&size, data + sizeof(status), sizeof(size));
+      data += sizeof(status) + sizeof(size);
+      size = std::min<uint32_t>(size, static_cast<uint32_t>(end - data));
+
+      results[i].status = status;
+      results[i].data.assign(data, data + size);
+      data += size;
+    }
+  } catch (...) {
+    for (auto &item : results) item.error = std::current_exception();
+  }
+
+  for (size_t i = 0; i < batch.size(); ++i) batch[i].done(std::move(results[i]));
+}
+
+void FetchScheduler::send(Call &call) {
+  TRACE_SCOPE("FetchScheduler::call");
+  FetchResult result;
+
+  try {
+    auto response = transport->call(call.code, call.payload);
+    result.status = response.status;
+    result.data = std::move(response.data);
+  } catch (...) {
+    result.error = std::current_exception();
+  }
+
+  call.done(std::move(result));
+}
@@ -0,0 +1,84 @@
+#ifndef CLIENT_SCHEDULER_H
+#define CLIENT_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http.h"
+#include "metrics.h"
+
+namespace bura {
+
+constexpr uint16_t kBatchFetchCode = 8;
+
+// Raw opcode 3 reply for one player, as carried inside a batch, or the reply of a single queued call
+struct FetchResult {
+  int status{1};
+  std::vector<uint8_t> data;
+  std::exception_ptr error{};  // set by the callback API instead of throwing
+};
+
+using FetchCallback = std::function<void(FetchResult result)>;
+
+// Coalesces the fetches of every client in the process into batched opcode 8 requests.
+// A batch is sent once maxBatch ids are queued or the oldest one has waited for the collect window.
+// Other opcodes can be queued as single calls, so callers that must not block never touch a socket.
+// Callbacks run on the scheduler thread and should only hand the result over.
+class FetchScheduler final {
+ private:
+  struct Pending {
+    std::string id;
+    FetchCallback done;
+  };
+
+  struct Call {
+    uint16_t code;
+    std::vector<uint8_t> payload;
+    FetchCallback done;
+  };
+
+  std::unique_ptr<http::Transport> transport;
+  std::string id;
+  size_t maxBatch;
+  std::chrono::microseconds window;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::vector<Pending> pending;
+  std::vector<Call> calls;
+  bool isExit{false};
+  std::thread worker;
+
+  std::atomic<uint64_t> batches{0};
+  std::atomic<uint64_t> fetches{0};
+  metrics::ClientMetrics &counters{metrics::ClientMetrics::get()};
+
+  void run();
+  void send(std::vector<Pending> &batch);
+  void send(Call &call);
+
+ public:
+  FetchScheduler(const std::string &host, const std::string &port, http::TransportKind transport = http::TransportKind::Http, size_t maxBatch = 256,
+                 std::chrono::microseconds window = std::chrono::milliseconds(2));
+  FetchScheduler(const FetchScheduler &) = delete;
+  ~FetchScheduler();
+
+  std::future<FetchResult> fetch(const std::string &playerId);
+  void fetch(const std::string &playerId, FetchCallback done);
+  void call(uint16_t code, std::vector<uint8_t> payload, FetchCallback done);
+
+  [[nodiscard]] uint64_t getBatches() const { return batches.load(std::memory_order_relaxed); }
+  [[nodiscard]] uint64_t getFetches() const { return fetches.load(std::memory_order_relaxed); }
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_SCHEDULER_H
@@ -0,0 +1,225 @@
+#include "screen.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cwchar>
+#include <string>
+
+namespace {
+
+constexpr size_t kNoColor = static_cast<size_t>(-1);
+
+struct Rgb {
+  int r, g, b;
+};
+
+Rgb toRgb(int32_t color) { return {(color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF}; }
+
+int distance(Rgb a, Rgb b) { return (a.r - b.r) * (a.r - b.r) + (a.g - b.g) * (a.g - b.g) + (a.b - b.b) * (a.b - b.b); }
+
+// xterm defaults of the 16 basic colours
+constexpr Rgb kBasicColors[16] = {
+    {0, 0, 0},       {205, 0, 0}, {0, 205, 0}, {205, 205, 0}, {0, 0, 238},   {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+    {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0}, {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}};
+
+int nearestBasic(Rgb color) {
+  int best = 0;
+  for (int i = 1; i < 16; ++i)
+    if (distance(color, kBasicColors[i]) < distance(color, kBasicColors[best])) best = i;
+  return best;
+}
+
+// 16..231 is a 6x6x6 cube, 232..255 a grey ramp
+int nearest256(Rgb color) {
+  constexpr int levels[6] = {0, 95, 135, 175, 215, 255};
+  auto level = [&](int value) {
+    int best = 0;
+    for (int i = 1; i < 6; ++i)
+      if (std::abs(value - levels[i]) < std::abs(value - levels[best])) best = i;
+    return best;
+  };
+
+  int r = level(color.r), g = level(color.g), b = level(color.b);
+  int cube = 16 + 36 * r + 6 * g + b;
+
+  int grey = std::min(std::max(((color.r + color.g + color.b) / 3 - 3) / 10, 0), 23);
+  int greyValue = 8 + 10 * grey;
+
+  if (distance(color, {greyValue, greyValue, greyValue}) < distance(color, {levels[r], levels[g], levels[b]})) return 232 + grey;
+  return cube;
+}
+
+}  // namespace
+
+Screen::Screen(int width, int height)
+    : width(width), height(height), screenBufferA(static_cast<size_t>(width * height)), screenBufferB(static_cast<size_t>(width * height)) {
+  setColorMode(colorMode);
+}
+
+void Screen::setColorMode(ColorMode mode) {
+  colorMode = mode;
+  colorCodes.clear();
+  for (auto color : {COLOR_DEFAULT, COLOR_DEFAULT_BG, COLOR_DEFAULT_FG, COLOR_ACTIVE_CARD_FG, COLOR_RED_SUIT_FG}) colorCode(color);
+}
+
+size_t Screen::colorCode(int32_t color) {
+  for (size_t i = 0; i < colorCodes.size(); ++i)
+    if (colorCodes[i].color == color) return i;
+
+  ColorCode code{color, {}, {}};
+  auto rgb = toRgb(color);
+
+  if (color == COLOR_DEFAULT) {
+    code.fg = L"39";
+    code.bg = L"49";
+  } else if (colorMode == ColorMode::TrueColor) {
+    auto components = std::to_wstring(rgb.r) + L";" + std::to_wstring(rgb.g) + L";" + std::to_wstring(rgb.b);
+    code.fg = L"38;2;" + components;
+    code.bg = L"48;2;" + components;
+  } else if (colorMode == ColorMode::Palette256) {
+    auto index = std::to_wstring(nearest256(rgb));
+    code.fg = L"38;5;" + index;
+    code.bg = L"48;5;" + index;
+  } else {
+    auto index = nearestBasic(rgb);
+    code.fg = std::to_wstring(index < 8 ? 30 + index : 90 + index - 8);
+    code.bg = std::to_wstring(index < 8 ? 40 + index : 100 + index - 8);
+  }
+
+  colorCodes.push_back(std::move(code));
+  return colorCodes.size() - 1;
+}
+
+void Screen::setSymbol(int x, int y, wchar_t symbol) {
+  auto px = coord2px(x, y);
+  if (!inside(px)) return;
+  screenBufferA[px].symbol = symbol;
+}
+
+void Screen::setColor(int x, int y, int color) {
+  auto px = coord2px(x, y);
+  if (!inside(px)) return;
+  screenBufferA[px].color = color;
+}
+
+void Screen::setBgColor(int x, int y, int color) {
+  auto px = coord2px(x, y);
+  if (!inside(px)) return;
+  screenBufferA[px].bgColor = color;
+}
+
+void Screen::setPixel(int x, int y, wchar_t symbol, int color, int bgColor) {
+  auto px = coord2px(x, y);
+  if (!inside(px)) return;
+  auto &pixel = screenBufferA[px];
+  pixel.symbol = symbol;
+  pixel.color = color;
+  pixel.bgColor = bgColor;
+}
+
+void Screen::setPixel(int x, int y, Pixel pxl) {
+  auto px = coord2px(x, y);
+  if (!inside(px)) return;
+  auto &pixel = screenBufferA[px];
+  pixel.symbol = pxl.symbol;
+  pixel.color = pxl.color;
+  pixel.bgColor = pxl.bgColor;
+}
+
+void Screen::printText(int sx, int sy, const wchar_t *str, int color, int bgColor) {
+  auto len = wcslen(str);
+  auto px = coord2px(sx, sy);
+  int x{}, y{};
+
+  for (size_t i = 0; i < len; ++i) {
+    if (str[i] != '\n') {
+      px2cord(px, x, y);
+      setPixel(x, y, str[i], color, bgColor);
+      px++;
+    } else {
+      x = sx;
+      y += 1;
+      px = coord2px(x, y);
+    }
+  }
+}
+
+void Screen::printTextAlignCenter(int sx, int sy, const wchar_t *str, int color, int bgColor) {
+  int i = 0;
+  std::wstring line;
+
+  while (*str != L'\0') {
+    auto end = wcschr(str, L'\n');
+    auto len = end != nullptr ? static_cast<size_t>(end - str) : wcslen(str);
+
+    if (len > 0) {
+      line.assign(str, len);
+      printText(static_cast<int>(sx - (len / 2)), sy + i, line.c_str(), color, bgColor);
+      ++i;
+    }
+
+    if (end == nullptr) break;
+    str = end + 1;
+  }
+}
+
+void Screen::flush(std::wostream &out) {
+  int cursorX = 0, cursorY = 0;
+
+  bool isPrevPixelChange = false;
+  // What the terminal has set since the first change of this frame
+  size_t termFg = kNoColor;
+  size_t termBg = kNoColor;
+
+  for (int y = 0, px = 0; y < height; ++y) {
+    for (int x = 0; x < width; (++px, ++x)) {
+      auto &newPixel = screenBufferA[px], &oldPixel = screenBufferB[px];
+
+      if (newPixel != oldPixel) {
+        if (!isPrevPixelChange) {
+          cursorX = x;
+          cursorY = y;
+          out << L"\x1b[" << (y + 1) << L";" << (x + 1) << L"H";
+        }
+
+        sgr.clear();
+
+        if (newPixel.color != COLOR_INHERIT) {
+          auto fg = colorCode(newPixel.color);
+          if (termFg == kNoColor || colorCodes[fg].fg != colorCodes[termFg].fg) sgr += colorCodes[fg].fg;
+          termFg = fg;
+        }
+
+        if (newPixel.bgColor != COLOR_INHERIT) {
+          auto bg = colorCode(newPixel.bgColor);
+          if (termBg == kNoColor || colorCodes[bg].bg != colorCodes[termBg].bg) {
+            if (!sgr.empty()) sgr += L';';
+            sgr += colorCodes[bg].bg;
+          }
+          termBg = bg;
+        }
+
+        if (!sgr.empty()) out << L"\x1b[" << sgr << L"m";
+
+        out << newPixel.symbol;
+        isPrevPixelChange = true;
+
+        cursorX += 1;
+
+        if (cursorX >= width) {
+          cursorX = 0;
+          cursorY++;
+        }
+      } else {
+        isPrevPixelChange = false;
+      }
+
+      oldPixel = {newPixel};
+      newPixel.symbol = ' ';
+      newPixel.color = COLOR_DEFAULT;
+      newPixel.bgColor = COLOR_DEFAULT;
+    }
+  }
+
+  if (cursorX != width - 1 || cursorY != height - 1) out << L"\x1b[" << height << L";" << width << L"H";
+}
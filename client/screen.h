@@ -0,0 +1,105 @@
+#ifndef CLIENT_SCREEN_H
+#define CLIENT_SCREEN_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+constexpr int COLOR_DEFAULT = -1;
+constexpr int COLOR_INHERIT = -2;
+
+const int COLOR_DEFAULT_BG = 0xFFFFFF;
+const int COLOR_DEFAULT_FG = 0;
+const int COLOR_ACTIVE_CARD_FG = 0x00AAAA;
+const int COLOR_RED_SUIT_FG = 0xFF0000;
+
+// How colours are written: 24-bit, the xterm 256-colour palette, or the 16 basic colours.
+// The palettes send a fraction of the bytes, which matters over SSH or a slow console.
+enum class ColorMode : uint8_t { TrueColor, Palette256, Palette16 };
+
+struct Pixel {
+  explicit Pixel() : symbol(' '), color(COLOR_DEFAULT), bgColor(COLOR_DEFAULT) {}
+  explicit Pixel(wchar_t symbol) : symbol(symbol), color(COLOR_DEFAULT), bgColor(COLOR_DEFAULT) {}
+  Pixel(wchar_t symbol, int32_t color) : symbol(symbol), color(color), bgColor(COLOR_DEFAULT) {}
+  Pixel(wchar_t symbol, int32_t color, int32_t bgColor) : symbol(symbol), color(color), bgColor(bgColor) {}
+  wchar_t symbol{' '};
+  int32_t color{COLOR_DEFAULT};
+  int32_t bgColor{COLOR_DEFAULT};
+
+  bool operator==(const Pixel &rhs) const { return symbol == rhs.symbol && color == rhs.color && bgColor == rhs.bgColor; }
+  bool operator!=(const Pixel &rhs) const { return !(rhs == *this); }
+
+  void getFgHexColor(int &r, int &g, int &b) const {
+    r = (color >> 16) & 0xFF;
+    g = (color >> 8) & 0xFF;
+    b = color & 0xFF;
+  }
+
+  void getBgHexColor(int &r, int &g, int &b) const {
+    r = (bgColor >> 16) & 0xFF;
+    g = (bgColor >> 8) & 0xFF;
+    b = bgColor & 0xFF;
+  }
+};
+
+// Double-buffered character screen: draw into the front buffer, flush writes only the changed cells as ANSI output
+class Screen {
+ private:
+  int width{0};
+  int height{0};
+  std::vector<Pixel> screenBufferA;
+  std::vector<Pixel> screenBufferB;
+
+  // SGR parameters of a colour in the current mode, e.g. "38;5;15" and "48;5;15"
+  struct ColorCode {
+    int32_t color;
+    std::wstring fg;
+    std::wstring bg;
+  };
+
+  ColorMode colorMode{ColorMode::TrueColor};
+  std::vector<ColorCode> colorCodes;
+  std::wstring sgr;
+
+  size_t colorCode(int32_t color);
+
+ public:
+  Screen() = default;
+  Screen(int width, int height);
+
+  // Also quantizes the fixed UI colours up front, others are added on first use
+  void setColorMode(ColorMode mode);
+  [[nodiscard]] ColorMode getColorMode() const { return colorMode; }
+
+  [[nodiscard]] int getWidth() const { return width; }
+  [[nodiscard]] int getHeight() const { return height; }
+
+  [[nodiscard]] int coord2px(int x, int y) const { return (width * y) + x; }
+  [[nodiscard]] bool inside(int px) const { return px >= 0 && static_cast<size_t>(px) < screenBufferA.size(); }
+
+  void px2cord(int px, int &x, int &y) const {
+    y = px / width;
+    x = px % width;
+  }
+
+  void normalizeCord(int &x, int &y) const {
+    y += x / width;
+    x = x % width;
+  }
+
+  void setSymbol(int x, int y, wchar_t symbol);
+  void setColor(int x, int y, int color);
+  void setBgColor(int x, int y, int color);
+  void setPixel(int x, int y, wchar_t symbol, int color, int bgColor = COLOR_DEFAULT);
+  void setPixel(int x, int y, Pixel pxl);
+
+  void printText(int sx, int sy, const wchar_t *str, int color = COLOR_DEFAULT, int bgColor = COLOR_DEFAULT);
+  void printTextAlignCenter(int sx, int sy, const wchar_t *str, int color = COLOR_DEFAULT, int bgColor = COLOR_DEFAULT);
+
+  // Writes the difference to the previous frame and clears the front buffer.
+  // Colours are only sent when the terminal does not already have them, fg and bg in one sequence.
+  void flush(std::wostream &out);
+};
+
+#endif  // CLIENT_SCREEN_H
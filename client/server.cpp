@@ -0,0 +1,46 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "reactor.h"
+
+// Native game server, a drop-in for the Node server: HTTP on 2021 and framed TCP on 2022, shared-memory clients
+// on this host through /tmp/bura.sock ("-" disables them).
+//
+// bura_server [threads] [http port] [framed port] [shm socket]
+// Runs until SIGINT or SIGTERM, then prints the request counters.
+
+int main(int argc, char *argv[]) {
+  http::ServerConfig config;
+  if (argc > 1) config.threads = std::stoul(argv[1]);
+  if (argc > 2) config.httpPort = static_cast<uint16_t>(std::stoul(argv[2]));
+  if (argc > 3) config.framedPort = static_cast<uint16_t>(std::stoul(argv[3]));
+  if (argc > 4) config.shmSocket = std::string(argv[4]) == "-" ? "" : argv[4];
+
+  // Blocked before the reactors start so that only sigwait below sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    http::GameServer server(config);
+    server.start();
+    std::cout << "started! threads: " << config.threads << ", http: " << config.httpPort << ", framed: " << config.framedPort
+              << ", shm: " << (config.shmSocket.empty() ? "off" : config.shmSocket) << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+
+    auto stats = server.stats();
+    std::cout << "connections: " << stats.connections << ", requests: " << stats.requests << ", bytes in: " << stats.bytesIn
+              << ", bytes out: " << stats.bytesOut << std::endl;
+  } catch (std::exception &err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
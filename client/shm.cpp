@@ -0,0 +1,168 @@
+#include "shm.h"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <thread>
+
+#include "latency.h"
+
+namespace {
+
+// A reply within this is picked up without a system call. Spinning needs the server on another core: with a
+// single CPU it only delays the server, so the client goes straight to sleep.
+const auto kSpin = std::thread::hardware_concurrency() > 1 ? std::chrono::microseconds(50) : std::chrono::microseconds(0);
+
+[[noreturn]] void fail(const char *what) { throw std::system_error(errno, std::system_category(), what); }
+
+}  // namespace
+
+http::ShmTransport::ShmTransport(const std::string &path, std::chrono::milliseconds timeout) : Transport(timeout) {
+  int memory = -1;
+
+  try {
+    memory = memfd_create("bura-shm", MFD_CLOEXEC);
+    if (memory < 0) fail("Failed to create shared memory");
+    if (ftruncate(memory, sizeof(ShmSegment)) != 0) fail("Failed to size shared memory");
+
+    auto mapping = mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    if (mapping == MAP_FAILED) fail("Failed to map shared memory");
+    segment = new (mapping) ShmSegment();
+    segment->magic = kShmMagic;
+    segment->version = kShmVersion;
+
+    requestEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    replyEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (requestEvent < 0 || replyEvent < 0) fail("Failed to create eventfd");
+
+    socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket < 0) fail("Failed to create socket");
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw std::invalid_argument("Socket path too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    if (::connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+      throw std::system_error(errno, std::system_category(), "Failed to connect to " + path);
+
+    // The segment and both eventfds travel as SCM_RIGHTS next to a single byte
+    int fds[3]{memory, requestEvent, replyEvent};
+    char byte = 0;
+    iovec data{&byte, sizeof(byte)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    auto header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    if (::sendmsg(socket, &message, MSG_NOSIGNAL) != sizeof(byte)) fail("Failed to send shared memory");
+    ::close(memory);
+    memory = -1;
+
+    // The server answers with one byte once it mapped the segment
+    pollfd ready{socket, POLLIN, 0};
+    auto result = ::poll(&ready, 1, static_cast<int>(timeout_default.count() < 0 ? -1 : timeout_default.count()));
+    if (result < 0) fail("Failed to poll socket");
+    if (result == 0) throw httpResponseError("Timeout");
+    if (::read(socket, &byte, sizeof(byte)) != sizeof(byte)) throw httpResponseError("Server refused the shared memory channel");
+  } catch (...) {
+    if (memory >= 0) ::close(memory);
+    release();
+    throw;
+  }
+}
+
+http::ShmTransport::~ShmTransport() { release(); }
+
+void http::ShmTransport::release() {
+  if (segment) munmap(segment, sizeof(ShmSegment));
+  if (socket >= 0) ::close(socket);
+  if (requestEvent >= 0) ::close(requestEvent);
+  if (replyEvent >= 0) ::close(replyEvent);
+  segment = nullptr;
+  socket = requestEvent = replyEvent = -1;
+}
+
+void http::ShmTransport::waitReply(std::chrono::steady_clock::time_point deadline, bool hasDeadline) {
+  auto &replies = segment->replies;
+
+  for (;;) {
+    const auto spinUntil = std::chrono::steady_clock::now() + kSpin;
+    while (replies.empty() && std::chrono::steady_clock::now() < spinUntil) spinPause();
+
+    if (replies.empty() && replies.prepareSleep()) {
+      // The socket turns readable only when the server closes it
+      pollfd fds[2]{{replyEvent, POLLIN, 0}, {socket, POLLIN, 0}};
+      int wait = -1;
+      if (hasDeadline) wait = static_cast<int>(std::max<int64_t>(getRemainingMilliseconds(deadline), 0));
+
+      auto result = ::poll(fds, 2, wait);
+      replies.wakeUp();
+      if (result < 0 && errno != EINTR) fail("Failed to poll eventfd");
+
+      uint64_t count;
+      if (fds[0].revents & POLLIN) (void)!::read(replyEvent, &count, sizeof(count));
+      if (fds[1].revents) throw httpResponseError("Connection closed");
+      if (result == 0 && replies.empty()) {
+        ++stale;
+        throw httpResponseError("Timeout");
+      }
+    }
+
+    if (replies.empty()) continue;
+    if (stale == 0) return;
+
+    replies.pop();
+    --stale;
+  }
+}
+
+http::Response http::ShmTransport::call(uint16_t code, const std::vector<uint8_t> &payload, std::chrono::milliseconds timeout) {
+  LatencyProbe probe(code);
+  const bool hasDeadline = timeout.count() >= 0;
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  auto &requests = segment->requests;
+  if (payload.size() > sizeof(ShmSlot::data)) throw httpRequestError("Request does not fit a shared memory slot");
+  if (requests.full()) throw httpRequestError("Server does not take requests");
+
+  auto &slot = requests.back();
+  slot.code = code;
+  slot.length = static_cast<uint32_t>(payload.size());
+  std::memcpy(slot.data, payload.data(), payload.size());
+  if (requests.push()) {
+    uint64_t one = 1;
+    if (::write(requestEvent, &one, sizeof(one)) != sizeof(one)) fail("Failed to wake the server");
+  }
+  bytesSent += sizeof(code) + payload.size();
+  probe.mark(Phase::Send);
+
+  waitReply(deadline, hasDeadline);
+
+  auto &replies = segment->replies;
+  auto &reply = replies.front();
+  Response response;
+  response.status = reply.code;
+  response.data.assign(reply.data, reply.data + std::min<size_t>(reply.length, sizeof(reply.data)));
+  replies.pop();
+
+  bytesReceived += sizeof(uint16_t) + response.data.size();
+  probe.finish();
+  return response;
+}
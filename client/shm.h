@@ -0,0 +1,118 @@
+#ifndef CLIENT_SHM_H
+#define CLIENT_SHM_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "http.h"
+#include "protocol.h"
+
+// Shared-memory transport for a client on the same host as bura_server (Linux). Every client owns one segment
+// with two single-producer single-consumer rings, requests to the server and replies back. The client creates
+// the segment and two eventfds and hands all three to the server over a Unix socket; the socket then only
+// tells the server when the client is gone.
+//
+// Both sides spin on the ring for a while before they sleep on their eventfd, and a producer writes the eventfd
+// only when the consumer said it sleeps, so a busy round trip makes no system call at all.
+
+namespace http {
+
+// The default Unix socket of bura_server; makeTransport takes it as the "port" of TransportKind::Shm
+constexpr char kShmSocketPath[] = "/tmp/bura.sock";
+
+// A slot holds one whole message. The largest is a fetch reply: the state header, every card of the deck spread
+// over the lists, and the opponent's nickname. Longer nicknames are answered with status 1 on this transport.
+constexpr size_t kShmMaxNickname = 256;
+constexpr size_t kShmSlotSize = 512;
+constexpr size_t kShmRingSlots = 8;
+
+// Busy-wait hint for the ring pollers
+inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+struct ShmSlot {
+  uint16_t code;  // opcode of a request, status of a reply
+  uint32_t length;
+  uint8_t data[kShmSlotSize - 8];
+};
+
+static_assert(sizeof(ShmSlot) == kShmSlotSize);
+static_assert(sizeof(ShmSlot::data) >= bura::proto::StateReply::minSize + bura::kDeckSize * sizeof(bura::CardType) + kShmMaxNickname);
+
+struct ShmRing {
+  alignas(64) std::atomic<uint32_t> head{0};  // written by the producer only
+  alignas(64) std::atomic<uint32_t> tail{0};  // written by the consumer only
+  alignas(64) std::atomic<uint32_t> sleeping{0};  // the consumer waits on its eventfd
+  alignas(64) ShmSlot slots[kShmRingSlots];
+
+  [[nodiscard]] bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed); }
+  [[nodiscard]] bool full() const { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire) == kShmRingSlots; }
+
+  // Producer: the next free slot, published by push()
+  ShmSlot &back() { return slots[head.load(std::memory_order_relaxed) % kShmRingSlots]; }
+  // Returns true if the consumer has to be woken up through its eventfd
+  bool push() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    // Pairs with the fence in prepareSleep: either the consumer sees the slot or this sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return sleeping.load(std::memory_order_relaxed) != 0;
+  }
+
+  // Consumer: the oldest slot, released by pop()
+  ShmSlot &front() { return slots[tail.load(std::memory_order_relaxed) % kShmRingSlots]; }
+  void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer: announces the sleep; false if a slot was published meanwhile and the sleep is off
+  bool prepareSleep() {
+    sleeping.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (empty()) return true;
+    wakeUp();
+    return false;
+  }
+  void wakeUp() { sleeping.store(0, std::memory_order_relaxed); }
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the rings are shared between processes");
+
+struct ShmSegment {
+  uint32_t magic;
+  uint32_t version;
+  ShmRing requests;
+  ShmRing replies;
+};
+
+constexpr uint32_t kShmMagic = 0x41525542;  // "BURA"
+constexpr uint32_t kShmVersion = 1;
+
+class ShmTransport final : public Transport {
+ private:
+  int socket{-1};
+  int requestEvent{-1};  // the server sleeps on it
+  int replyEvent{-1};  // this client sleeps on it
+  ShmSegment *segment{nullptr};
+  size_t stale{0};  // replies still owed to calls that timed out
+
+  void release();
+  // Spins, then sleeps on replyEvent until a reply that is not stale is at the front of the reply ring
+  void waitReply(std::chrono::steady_clock::time_point deadline, bool hasDeadline);
+
+ public:
+  using Transport::call;
+
+  explicit ShmTransport(const std::string &path = kShmSocketPath, std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+  ShmTransport(const ShmTransport &) = delete;
+  ~ShmTransport() override;
+
+  Response call(uint16_t code, const std::vector<uint8_t> &payload, std::chrono::milliseconds timeout) override;
+};
+
+}  // namespace http
+
+#endif  // CLIENT_SHM_H
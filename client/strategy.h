@@ -0,0 +1,158 @@
+#ifndef CLIENT_STRATEGY_H
+#define CLIENT_STRATEGY_H
+
+#include <functional>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "metrics.h"
+#include "poll.h"
+#include "trace.h"
+
+// BuraClient::play runs the fetch loop and calls a strategy only when the game reaches a point it has to act on.
+// A strategy is any type with these members, called directly so they can be inlined:
+//
+//   void onStart(const GameState &state);                                 // first state of a started game
+//   void onMove(const GameState &state, std::vector<Card> &yourMove);    // leave empty to retry on the next poll
+//   bool onDefend(const GameState &state, std::vector<Card> &yourDefence);  // false passes
+//   void onEnd(const GameState &state);                                   // Win or Lose, play returns afterwards
+//
+// A rejected move or defence is offered to the strategy again on the next poll.
+
+namespace bura {
+
+// Strategy built from std::function or the *FunctionPtr callbacks; empty callbacks do nothing and pass.
+struct StrategyCallbacks {
+  std::function<void(const GameState &)> start;
+  std::function<void(const GameState &, std::vector<Card> &)> move;
+  std::function<bool(const GameState &, std::vector<Card> &)> defend;
+  std::function<void(const GameState &)> end;
+
+  void onStart(const GameState &state) {
+    if (start) start(state);
+  }
+  void onMove(const GameState &state, std::vector<Card> &yourMove) {
+    if (move) move(state, yourMove);
+  }
+  bool onDefend(const GameState &state, std::vector<Card> &yourDefence) { return defend && defend(state, yourDefence); }
+  void onEnd(const GameState &state) {
+    if (end) end(state);
+  }
+};
+
+struct Action {
+  enum struct Kind { None, Move, Defend, Pass, End } kind{Kind::None};
+  std::vector<Card> cards;
+};
+
+// The transition rules of play, for loops that do their own I/O: next() asks the strategy what to send for a
+// fetched state, sent() reports that it went out. Games, decisions and decision time go to ClientMetrics.
+template <typename Strategy>
+class StrategyDriver final {
+ private:
+  Strategy &strategy;
+  metrics::ClientMetrics &counters{metrics::ClientMetrics::get()};
+  GameStatus last{GameStatus::None};
+  bool started{false};
+
+ public:
+  explicit StrategyDriver(Strategy &strategy) : strategy(strategy) {}
+
+  Action next(const GameState &current) {
+    Action action;
+
+    auto status = current.status;
+    if (status == last) return action;
+    last = status;
+
+    if (!started && status != GameStatus::Idle && status != GameStatus::None) {
+      started = true;
+      strategy.onStart(current);
+    }
+
+    if (status == GameStatus::Win || status == GameStatus::Lose) {
+      counters.games.add();
+      (status == GameStatus::Win ? counters.wins : counters.losses).add();
+      strategy.onEnd(current);
+      action.kind = Action::Kind::End;
+    } else if (status == GameStatus::YourMove) {
+      {
+        metrics::Timer timer(counters.decisionTime);
+        strategy.onMove(current, action.cards);
+      }
+      if (!action.cards.empty()) {
+        action.kind = Action::Kind::Move;
+        counters.moves.add();
+      }
+      // Nothing chosen: ask again on the next poll
+      last = GameStatus::WaitUpdate;
+    } else if (status == GameStatus::YourDef) {
+      bool defend;
+      {
+        metrics::Timer timer(counters.decisionTime);
+        defend = strategy.onDefend(current, action.cards);
+      }
+      action.kind = defend ? Action::Kind::Defend : Action::Kind::Pass;
+      (defend ? counters.defences : counters.passes).add();
+    }
+
+    return action;
+  }
+
+  // Whatever happened, the next fetch has to be looked at: a new turn after success, a retry after a rejection
+  void sent() { last = GameStatus::WaitUpdate; }
+};
+
+template <typename Strategy>
+void BuraClient::play(Strategy &strategy, PollTimer &poll, const std::atomic<bool> &stop) {
+  StrategyDriver<Strategy> driver(strategy);
+
+  while (!stop) {
+    try {
+      {
+        TRACE_SCOPE("poll wait");
+        poll.wait(stop);
+      }
+      if (stop) break;
+
+      TRACE_SCOPE("BuraClient::play");
+      const auto current = fetch();
+      poll.observe(current);
+
+      auto action = driver.next(current);
+      int result = -1;
+
+      switch (action.kind) {
+        case Action::Kind::None:
+          continue;
+        case Action::Kind::End:
+          return;
+        case Action::Kind::Move:
+          result = finishMove(std::move(action.cards));
+          break;
+        case Action::Kind::Defend:
+          result = finishDef(std::move(action.cards));
+          break;
+        case Action::Kind::Pass:
+          result = passDef();
+          break;
+      }
+
+      driver.sent();
+      if (result == 0)
+        poll.nudge();
+      else
+        metrics::ClientMetrics::get().rejected.add();
+    } catch (std::exception &err) {
+      poll.failed();
+      countError(err);
+      std::cout << err.what() << std::endl;
+    }
+  }
+}
+
+}  // namespace bura
+
+#endif  // CLIENT_STRATEGY_H
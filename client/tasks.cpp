@@ -0,0 +1,191 @@
+#include "tasks.h"
+
+#include <algorithm>
+
+using namespace bura;
+
+namespace {
+
+thread_local const TaskPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+constexpr std::chrono::milliseconds kIdleWait{100};
+
+}  // namespace
+
+TaskPool::TaskPool(size_t threadCount) {
+  threadCount = std::max<size_t>(threadCount, 1);
+  for (size_t i = 0; i < threadCount; ++i) workers.push_back(std::make_unique<Worker>());
+  for (size_t i = 0; i < threadCount; ++i) threads.emplace_back(&TaskPool::run, this, i);
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(idleMutex);
+    isExit = true;
+  }
+  idle.notify_all();
+  for (auto &thread : threads) thread.join();
+
+  std::lock_guard<std::mutex> lock(ownedMutex);
+  for (auto task : owned) delete task;
+}
+
+void TaskPool::spawn(std::unique_ptr<Task> task) {
+  auto raw = task.release();
+  {
+    std::lock_guard<std::mutex> lock(ownedMutex);
+    owned.insert(raw);
+  }
+  alive.fetch_add(1);
+  push(raw);
+}
+
+void TaskPool::wake(Task *task) {
+  auto state = task->state.load();
+
+  for (;;) {
+    if (state == Task::Waiting) {
+      if (task->state.compare_exchange_weak(state, Task::Running)) return push(task);
+    } else if (state == Task::Running) {
+      // Still inside resume: the worker requeues it when resume returns Wait
+      if (task->state.compare_exchange_weak(state, Task::Woken)) return;
+    } else {
+      return;
+    }
+  }
+}
+
+void TaskPool::join() {
+  std::unique_lock<std::mutex> lock(idleMutex);
+  finished.wait(lock, [&] { return alive.load() == 0; });
+}
+
+void TaskPool::push(Task *task) {
+  auto &worker = currentPool == this ? *workers[currentWorker] : *workers[next.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.queue.push_back(task);
+  }
+  queued.fetch_add(1);
+  queueDepth.add();
+
+  { std::lock_guard<std::mutex> lock(idleMutex); }
+  idle.notify_one();
+}
+
+Task *TaskPool::pop(size_t self) {
+  {
+    auto &own = *workers[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.queue.empty()) {
+      auto task = own.queue.back();
+      own.queue.pop_back();
+      queued.fetch_sub(1);
+      queueDepth.sub();
+      return task;
+    }
+  }
+
+  for (size_t i = 1; i < workers.size(); ++i) {
+    auto &victim = *workers[(self + i) % workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.queue.empty()) continue;
+
+    auto task = victim.queue.front();
+    victim.queue.pop_front();
+    queued.fetch_sub(1);
+    queueDepth.sub();
+    steals.fetch_add(1, std::memory_order_relaxed);
+    return task;
+  }
+
+  return nullptr;
+}
+
+void TaskPool::fireTimers() {
+  std::vector<Task *> due;
+  {
+    std::lock_guard<std::mutex> lock(timerMutex);
+    auto now = TaskClock::now();
+    while (!timers.empty() && timers.top().due <= now) {
+      due.push_back(timers.top().task);
+      timers.pop();
+    }
+  }
+
+  for (auto task : due) push(task);
+}
+
+TaskClock::time_point TaskPool::nextTimer() {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  auto limit = TaskClock::now() + kIdleWait;
+  return timers.empty() ? limit : std::min(timers.top().due, limit);
+}
+
+void TaskPool::execute(Task *task) {
+  resumes.fetch_add(1, std::memory_order_relaxed);
+  auto step = task->resume();
+
+  switch (step.kind) {
+    case TaskStep::Kind::Yield:
+      push(task);
+      break;
+    case TaskStep::Kind::Sleep: {
+      {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timers.push({step.until, task});
+      }
+      // Idle workers may be waiting for a later deadline
+      {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        timerEpoch++;
+      }
+      idle.notify_one();
+      break;
+    }
+    case TaskStep::Kind::Wait: {
+      uint8_t expected = Task::Running;
+      if (!task->state.compare_exchange_strong(expected, Task::Waiting)) {
+        // Woken while it was still running
+        task->state.store(Task::Running);
+        push(task);
+      }
+      break;
+    }
+    case TaskStep::Kind::Done: {
+      {
+        std::lock_guard<std::mutex> lock(ownedMutex);
+        owned.erase(task);
+      }
+      delete task;
+
+      if (alive.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        finished.notify_all();
+      }
+      break;
+    }
+  }
+}
+
+void TaskPool::run(size_t self) {
+  currentPool = this;
+  currentWorker = self;
+
+  for (;;) {
+    fireTimers();
+
+    if (auto task = pop(self)) {
+      execute(task);
+      continue;
+    }
+
+    auto deadline = nextTimer();
+    std::unique_lock<std::mutex> lock(idleMutex);
+    if (isExit) return;
+
+    auto epoch = timerEpoch;
+    idle.wait_until(lock, deadline, [&] { return isExit || queued.load() > 0 || timerEpoch != epoch; });
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef CLIENT_TASKS_H
+#define CLIENT_TASKS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "metrics.h"
+
+namespace bura {
+
+using TaskClock = std::chrono::steady_clock;
+
+struct TaskStep {
+  enum struct Kind : uint8_t { Yield, Sleep, Wait, Done } kind;
+  TaskClock::time_point until{};
+
+  static TaskStep yield() { return {Kind::Yield}; }
+  static TaskStep sleep(TaskClock::time_point time) { return {Kind::Sleep, time}; }
+  static TaskStep wait() { return {Kind::Wait}; }  // until someone calls TaskPool::wake
+  static TaskStep done() { return {Kind::Done}; }
+};
+
+// Stackless task: a state machine that runs until it has to wait and says what for.
+// It keeps its state in members, so a suspended task costs only its own size.
+class Task {
+ private:
+  enum State : uint8_t { Running, Waiting, Woken };
+  std::atomic<uint8_t> state{Running};
+
+  friend class TaskPool;
+
+ public:
+  virtual ~Task() = default;
+  virtual TaskStep resume() = 0;
+};
+
+// Runs tasks on a few worker threads. Each worker pops its own queue from the back and steals from the front of
+// the others; sleeping tasks wait in a shared timer heap.
+class TaskPool final {
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task *> queue;
+  };
+
+  struct Timer {
+    TaskClock::time_point due;
+    Task *task;
+    bool operator>(const Timer &other) const { return due > other.due; }
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> next{0};
+
+  std::mutex ownedMutex;
+  std::unordered_set<Task *> owned;
+
+  std::mutex timerMutex;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers;
+
+  std::mutex idleMutex;
+  std::condition_variable idle;
+  std::condition_variable finished;
+  std::atomic<size_t> queued{0};
+  std::atomic<size_t> alive{0};
+  uint64_t timerEpoch{0};
+  bool isExit{false};
+
+  std::atomic<uint64_t> resumes{0};
+  std::atomic<uint64_t> steals{0};
+  metrics::Gauge &queueDepth{metrics::ClientMetrics::get().taskQueue};
+
+  void push(Task *task);
+  Task *pop(size_t self);
+  void fireTimers();
+  TaskClock::time_point nextTimer();
+  void execute(Task *task);
+  void run(size_t self);
+
+ public:
+  explicit TaskPool(size_t threadCount = std::thread::hardware_concurrency());
+  TaskPool(const TaskPool &) = delete;
+  ~TaskPool();
+
+  // The pool owns the task until it returns Done
+  void spawn(std::unique_ptr<Task> task);
+  // Resumes a task that returned Wait; may be called from any thread, also before that resume has returned
+  void wake(Task *task);
+  // Blocks until every spawned task is done
+  void join();
+
+  [[nodiscard]] size_t size() const { return threads.size(); }
+  [[nodiscard]] uint64_t getResumes() const { return resumes.load(std::memory_order_relaxed); }
+  [[nodiscard]] uint64_t getSteals() const { return steals.load(std::memory_order_relaxed); }
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_TASKS_H
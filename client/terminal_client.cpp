@@ -0,0 +1,376 @@
+#include <sys/ioctl.h>
+#include <sys/poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include "board.h"
+#include "framed.h"
+#include "game.h"
+#include "poll.h"
+#include "protocol.h"
+#include "record.h"
+#include "screen.h"
+#include "trace.h"
+
+using namespace bura;
+
+// Linux terminal front end. Unlike BuraConsole it runs on one thread: a single poll() waits on stdin, the game
+// connection and the next timer (poll interval or frame), so input, replies and drawing never wait on each other.
+class BuraTerminal {
+ private:
+  using Clock = std::chrono::steady_clock;
+  static constexpr auto kFrameInterval = std::chrono::milliseconds(33);
+
+  enum struct Stage : uint8_t { Connect, Idle, Budget, Fetching };
+
+  // Terminal
+  termios savedMode{};
+  bool rawMode{false};
+  Screen screen;
+  BoardView view{screen};
+  std::wostringstream frame;
+  std::string output;
+
+  // Game
+  std::string ip;
+  std::string port;
+  std::string id;
+  bool joined{false};
+  std::string nickname{};
+
+  std::unique_ptr<http::FramedConnection> connection;
+  std::shared_ptr<record::GameRecorder> recorder;
+  std::shared_ptr<PollScheduler> pollScheduler;
+  std::unique_ptr<PollTimer> pollTimer;
+  Stage stage{Stage::Connect};
+  Clock::time_point fetchAt{};
+  bool acting{false};  // a move is in flight, further moves wait for its reply
+
+  // Local State
+  StateSnapshot snapshot;
+  LocalState local;
+  bool isExit{false};
+  bool dirty{true};
+  Clock::time_point lastFrame{};
+
+  void setup() {
+    if (tcgetattr(STDIN_FILENO, &savedMode) != 0) throw std::system_error(errno, std::system_category(), "stdin is not a terminal");
+
+    termios raw = savedMode;
+    raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_oflag &= ~OPOST;
+    raw.c_cflag |= CS8;
+    raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != 0) throw std::system_error(errno, std::system_category(), "Failed to set raw mode");
+    rawMode = true;
+
+    // Alternate screen, hidden cursor
+    write("\x1b[?1049h\x1b[?25l\x1b[2J");
+    resize();
+  }
+
+  void restore() {
+    if (!rawMode) return;
+    write("\x1b[0m\x1b[?25h\x1b[?1049l");
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedMode);
+    rawMode = false;
+  }
+
+  // Recreates the screen when the window size changed
+  void resize() {
+    winsize size{};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0) size = {24, 80, 0, 0};
+    if (size.ws_col == screen.getWidth() && size.ws_row == screen.getHeight()) return;
+
+    auto mode = screen.getColorMode();
+    screen = Screen(size.ws_col, size.ws_row);
+    screen.setColorMode(mode);
+    write("\x1b[0m\x1b[2J");
+    dirty = true;
+  }
+
+  void write(const std::string &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+      auto result = ::write(STDOUT_FILENO, data.data() + done, data.size() - done);
+      if (result < 0 && errno == EINTR) continue;
+      if (result < 0) throw std::system_error(errno, std::system_category(), "Failed to write to the terminal");
+      done += static_cast<size_t>(result);
+    }
+  }
+
+  // Screen writes wide chars, the terminal takes utf8
+  void encodeFrame(const std::wstring &text) {
+    output.clear();
+    for (wchar_t symbol : text) {
+      auto c = static_cast<uint32_t>(symbol);
+      if (c < 0x80) {
+        output += static_cast<char>(c);
+      } else if (c < 0x800) {
+        output += static_cast<char>(0xC0 | (c >> 6));
+        output += static_cast<char>(0x80 | (c & 0x3F));
+      } else if (c < 0x10000) {
+        output += static_cast<char>(0xE0 | (c >> 12));
+        output += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (c & 0x3F));
+      } else {
+        output += static_cast<char>(0xF0 | (c >> 18));
+        output += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        output += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (c & 0x3F));
+      }
+    }
+  }
+
+  void render() {
+    TRACE_SCOPE("frame");
+    resize();
+
+    {
+      TRACE_SCOPE("draw");
+      view.draw(snapshot, local, isExit);
+    }
+
+    {
+      TRACE_SCOPE("flush");
+      frame.str(std::wstring());
+      screen.flush(frame);
+      encodeFrame(frame.str());
+      write(output);
+    }
+
+    dirty = false;
+    lastFrame = Clock::now();
+  }
+
+  // Event loop
+
+  void run() {
+    trace::setThreadName("BuraTerminal");
+    render();
+
+    while (!isExit) {
+      auto now = Clock::now();
+
+      if (stage == Stage::Connect && now >= fetchAt) connect();
+      if (stage == Stage::Idle && now >= fetchAt) {
+        auto delay = pollTimer->begin();
+        stage = Stage::Budget;
+        fetchAt = now + delay;
+      }
+      if (stage == Stage::Budget && now >= fetchAt) fetch();
+      // The error text disappears on the first frame after it expired
+      if (lastFrame < local.errorTextDuration && now >= local.errorTextDuration) dirty = true;
+      if (dirty && now >= lastFrame + kFrameInterval) render();
+
+      pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {-1, 0, 0}};
+      if (connection) fds[1] = {connection->handle(), static_cast<short>(POLLIN | (connection->wantsWrite() ? POLLOUT : 0)), 0};
+
+      if (::poll(fds, 2, timeout()) < 0) {
+        if (errno == EINTR) continue;
+        throw std::system_error(errno, std::system_category(), "poll failed");
+      }
+
+      if (fds[0].revents & (POLLIN | POLLHUP)) input();
+      if (connection && fds[1].revents) onConnection(fds[1].revents);
+    }
+
+    render();
+  }
+
+  // Milliseconds until the next timer: the pending poll, or the next frame if something changed
+  int timeout() {
+    auto now = Clock::now();
+    auto next = now + std::chrono::seconds(1);
+
+    if (stage != Stage::Fetching) next = std::min(next, fetchAt);
+    if (dirty) next = std::min(next, lastFrame + kFrameInterval);
+    if (now < local.errorTextDuration) next = std::min(next, local.errorTextDuration);
+
+    if (next <= now) return 0;
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(next - now).count());
+  }
+
+  void onConnection(short events) {
+    try {
+      if (events & POLLOUT) connection->onWritable();
+      if (events & (POLLIN | POLLHUP | POLLERR)) connection->onReadable();
+    } catch (std::exception &e) {
+      disconnected(e.what());
+    }
+  }
+
+  // Requests
+
+  // Blocks for the TCP handshake, the board shows "Connecting..." meanwhile
+  void connect() {
+    snapshot.state.status = GameStatus::Connecting;
+    render();
+
+    try {
+      connection = std::make_unique<http::FramedConnection>(ip, port, std::chrono::seconds(5));
+    } catch (std::exception &e) {
+      return disconnected(e.what());
+    }
+
+    // A reconnect resumes the game under the same id
+    if (!joined) connection->call(2, proto::ConnectRequest::encode(proto::Connect{id, nickname}), [this](const http::Response &) { joined = true; });
+    stage = Stage::Idle;
+    fetchAt = Clock::now();
+  }
+
+  void disconnected(const char *reason) {
+    connection.reset();
+    pollTimer->failed();
+    acting = false;
+    stage = Stage::Connect;
+    fetchAt = pollTimer->due();
+
+    std::string text(reason);
+    showError(local, std::wstring(text.begin(), text.end()).c_str(), std::chrono::seconds(2));
+    dirty = true;
+  }
+
+  void fetch() {
+    stage = Stage::Fetching;
+    connection->call(3, proto::FetchRequest::encode(proto::Fetch{id}), [this](http::Response response) {
+      TRACE_SCOPE("decode");
+      stage = Stage::Idle;
+
+      if (response.status == 0) {
+        if (!BuraClient::decodeState(response.data.data(), response.data.size(), snapshot.state)) {
+          pollTimer->failed();
+          fetchAt = pollTimer->due();
+          return;
+        }
+        if (recorder) recorder->state(snapshot.state);
+        ++snapshot.version;
+        syncCursor(local, snapshot.state.status);
+        dirty = true;
+      }
+
+      pollTimer->observe(snapshot.state);
+      fetchAt = pollTimer->due();
+    });
+  }
+
+  void act(uint16_t code, std::vector<uint8_t> payload, record::EventKind kind) {
+    acting = true;
+    auto cards = local.selectedCards;
+
+    connection->call(code, payload, [this, kind, cards](http::Response response) {
+      acting = false;
+      if (recorder) recorder->move(id, kind, cards, response.status);
+      dirty = true;
+      // Rejected: the selection stays for another try
+      if (response.status != 0) return showError(local, L"The server rejected the move", std::chrono::seconds(2));
+
+      local.selectedCards = {};
+      local.sent = true;
+      local.sentVersion = snapshot.version;
+      pollTimer->nudge();
+      if (stage == Stage::Idle) fetchAt = pollTimer->due();
+    });
+  }
+
+  // Keys arrive as bytes; a terminal writes the whole escape sequence of a key at once
+
+  void input() {
+    char buffer[64];
+    auto size = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (size < 0 && errno == EINTR) return;
+    if (size <= 0) return OnPressEsc();
+
+    TRACE_SCOPE("key");
+    for (ssize_t i = 0; i < size; ++i) {
+      switch (buffer[i]) {
+        case 0x1b:
+          if (i + 2 < size && (buffer[i + 1] == '[' || buffer[i + 1] == 'O')) {
+            OnPressArrow(buffer[i + 2]);
+            i += 2;
+          } else if (i + 1 == size) {
+            OnPressEsc();
+          }
+          break;
+        case 0x03:  // Ctrl+C, raw mode does not raise SIGINT
+          OnPressEsc();
+          break;
+        case 0x7f:
+        case 0x08:
+          OnPressBackspace();
+          break;
+        case '\r':
+        case '\n':
+          OnPressEnter();
+          break;
+        case ' ':
+          OnPressSpace();
+          break;
+        default:
+          break;
+      }
+    }
+    dirty = true;
+  }
+
+  GameStatus status() const { return shownStatus(snapshot, local); }
+
+  // Key Handlers
+
+  void OnPressBackspace() {
+    if (acting || !connection || status() != GameStatus::YourDef) return;
+    act(5, proto::PassRequest::encode(proto::Pass{id}), record::EventKind::Pass);
+  }
+  void OnPressEnter() {
+    const auto current = status();
+    if (acting || !connection || (current != GameStatus::YourMove && current != GameStatus::YourDef)) return;
+
+    auto error = current == GameStatus::YourMove ? checkMove(local) : checkDefence(local, snapshot.state);
+    if (error) return showError(local, error, std::chrono::seconds(2));
+
+    if (current == GameStatus::YourMove)
+      act(4, proto::MoveRequest::encode(proto::Move{id, local.selectedCards}), record::EventKind::Move);
+    else
+      act(5, proto::DefendRequest::encode(proto::Defend{id, 1, local.selectedCards}), record::EventKind::Defend);
+  }
+  void OnPressEsc() { isExit = true; }
+  void OnPressSpace() {
+    if (!acting && isOurTurn(status())) toggleCard(local, snapshot.state);
+  }
+  void OnPressArrow(char key) {
+    if (!isOurTurn(status())) return;
+    if (key == 'D') moveCursor(local, snapshot.state, -1);
+    if (key == 'C') moveCursor(local, snapshot.state, 1);
+  }
+
+ public:
+  BuraTerminal(std::string ip, std::string port) : ip(std::move(ip)), port(std::move(port)) {}
+  BuraTerminal(const BuraTerminal &) = delete;
+  ~BuraTerminal() { restore(); }
+
+  void setRecorder(std::shared_ptr<record::GameRecorder> gameRecorder) { recorder = std::move(gameRecorder); }
+  void setColorMode(ColorMode mode) { screen.setColorMode(mode); }
+  void setPollScheduler(std::shared_ptr<PollScheduler> scheduler) { pollScheduler = std::move(scheduler); }
+
+  void launch(const std::string &nick) {
+    nickname = nick;
+    if (!pollScheduler) pollScheduler = std::make_shared<PollScheduler>();
+    pollTimer = std::make_unique<PollTimer>(pollScheduler);
+    id = generateRandomString(8);
+    snapshot.state.id = id;
+    snapshot.state.status = GameStatus::Connecting;
+
+    setup();
+    run();
+    restore();
+  }
+};
@@ -0,0 +1,124 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+using namespace bura;
+
+namespace {
+
+// Spans this close to the write head may be overwritten while they are copied
+constexpr uint64_t kUnsafeTail = 64;
+
+std::atomic<bool> traceEnabled{false};
+std::atomic<size_t> traceCapacity{1 << 16};
+const auto traceEpoch = std::chrono::steady_clock::now();
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<trace::ThreadBuffer>> registry;
+
+struct BufferLease {
+  trace::ThreadBuffer *buffer{nullptr};
+
+  ~BufferLease() {
+    if (buffer) buffer->inUse.store(false, std::memory_order_release);
+  }
+};
+
+void writeEscaped(std::ostringstream &ss, const char *str) {
+  for (; *str != '\0'; ++str) {
+    if (*str == '"' || *str == '\\') ss << '\\';
+    ss << *str;
+  }
+}
+
+}  // namespace
+
+void trace::ThreadBuffer::collect(std::vector<Event> &out) const {
+  auto end = head.load(std::memory_order_acquire);
+  auto capacity = static_cast<uint64_t>(events.size());
+  auto begin = end > capacity ? end - capacity + std::min(kUnsafeTail, capacity) : 0;
+
+  for (auto i = begin; i < end; ++i) out.push_back(events[i % capacity]);
+}
+
+void trace::enable(size_t eventsPerThread) {
+  traceCapacity.store(std::max<size_t>(eventsPerThread, kUnsafeTail * 2), std::memory_order_relaxed);
+  traceEnabled.store(true, std::memory_order_release);
+}
+
+void trace::disable() { traceEnabled.store(false, std::memory_order_release); }
+
+bool trace::enabled() { return traceEnabled.load(std::memory_order_relaxed); }
+
+int64_t trace::now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch).count(); }
+
+void trace::setThreadName(const char *name) { local().threadName.store(name, std::memory_order_release); }
+
+trace::ThreadBuffer &trace::local() {
+  thread_local BufferLease lease;
+  if (lease.buffer) return *lease.buffer;
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  for (auto &buffer : registry) {
+    bool expected = false;
+    if (buffer->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      buffer->threadName.store(nullptr, std::memory_order_relaxed);
+      lease.buffer = buffer.get();
+      return *lease.buffer;
+    }
+  }
+
+  registry.emplace_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(registry.size() + 1), traceCapacity.load(std::memory_order_relaxed)));
+  lease.buffer = registry.back().get();
+  lease.buffer->inUse.store(true, std::memory_order_relaxed);
+  return *lease.buffer;
+}
+
+std::string trace::exportChrome() {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool first = true;
+  std::vector<Event> events;
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  for (auto &buffer : registry) {
+    auto name = buffer->threadName.load(std::memory_order_acquire);
+
+    if (name != nullptr) {
+      ss << (first ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"";
+      writeEscaped(ss, name);
+      ss << "\"}}";
+      first = false;
+    }
+
+    events.clear();
+    buffer->collect(events);
+
+    for (auto &event : events) {
+      ss << (first ? "" : ",") << "{\"name\":\"";
+      writeEscaped(ss, event.name);
+      ss << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << static_cast<double>(event.start) / 1000.0
+         << ",\"dur\":" << static_cast<double>(event.duration) / 1000.0 << "}";
+      first = false;
+    }
+  }
+
+  ss << "]}";
+  return ss.str();
+}
+
+void trace::writeChrome(const std::string &path) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) throw std::runtime_error("Failed to open " + path);
+  file << exportChrome();
+}
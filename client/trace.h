@@ -0,0 +1,72 @@
+#ifndef CLIENT_TRACE_H
+#define CLIENT_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bura::trace {
+
+struct Event {
+  const char *name;
+  int64_t start;  // ns since trace epoch
+  int64_t duration;
+};
+
+// Fixed-size ring of completed spans written by one thread. Old spans are overwritten.
+class ThreadBuffer final {
+ private:
+  std::vector<Event> events;
+  std::atomic<uint64_t> head{0};
+
+ public:
+  std::atomic<bool> inUse{false};
+  std::atomic<const char *> threadName{nullptr};
+  const uint32_t id;
+
+  ThreadBuffer(uint32_t id, size_t capacity) : events(capacity), id(id) {}
+
+  void push(const char *name, int64_t start, int64_t duration) {
+    auto position = head.load(std::memory_order_relaxed);
+    events[position % events.size()] = Event{name, start, duration};
+    head.store(position + 1, std::memory_order_release);
+  }
+
+  void collect(std::vector<Event> &out) const;
+};
+
+void enable(size_t eventsPerThread = 1 << 16);
+void disable();
+bool enabled();
+
+int64_t now();
+void setThreadName(const char *name);
+ThreadBuffer &local();
+
+std::string exportChrome();
+void writeChrome(const std::string &path);
+
+class Span final {
+ private:
+  const char *name;
+  int64_t start;
+
+ public:
+  explicit Span(const char *name) : name(name), start(enabled() ? now() : -1) {}
+  Span(const Span &) = delete;
+  ~Span() {
+    if (start >= 0) local().push(name, start, now() - start);
+  }
+
+  Span &operator=(const Span &) = delete;
+};
+
+}  // namespace bura::trace
+
+#define BURA_TRACE_CONCAT_IMPL(a, b) a##b
+#define BURA_TRACE_CONCAT(a, b) BURA_TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) bura::trace::Span BURA_TRACE_CONCAT(traceSpan, __LINE__)(name)
+
+#endif  // CLIENT_TRACE_H
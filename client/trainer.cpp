@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "evaluator.h"
+#include "position.h"
+#include "rng.h"
+
+using namespace bura;
+
+// Fits evaluator weights on self-play games.
+//
+// client_trainer [--games N] [--rounds R] [--epochs E] [--rate L] [--epsilon P] [--threads T] [--seed S]
+//                [--init <weights>] [--out <weights>] [--eval N]
+// Every round the current weights play N games against themselves on all threads, each player taking the move
+// whose successor scores best (a random one with probability P). Every decision becomes a sample: the features
+// of the chosen successor, labelled 1 if its player went on to win. Logistic regression over the samples of all
+// rounds so far, by full-batch gradient descent with the gradient split over the threads, gives the weights of
+// the next round. --eval plays the result against the initial weights. Weights go to --out (default
+// bura.weights), the report to stderr, JSON to stdout.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Weights = std::array<float, kEvalWidth>;
+
+constexpr size_t kMaxPlies = 2000;
+// The evaluator features and whether the decision was an attack. Only attack successors have cards on the table,
+// so without that column the table weights would also learn how much better attackers do than defenders. The
+// column is fitted and then dropped: it adds the same to every option of one decision.
+constexpr size_t kColumns = kEvalFeatureCount + 1;
+constexpr size_t kAttackColumn = kEvalFeatureCount;
+
+struct Samples {
+  std::vector<float> features;  // kColumns per sample
+  std::vector<float> labels;
+
+  [[nodiscard]] size_t size() const { return labels.size(); }
+};
+
+// Chooses for one side: the best scored successor, or with probability `epsilon` any legal move
+class Player {
+ private:
+  const EvalWeights &weights;
+  EvalBatch batch;
+  std::vector<float> scores;
+
+ public:
+  explicit Player(const EvalWeights &weights) : weights(weights) {}
+
+  size_t choose(const Position &position, const MoveList &moves, Rng &rng, double epsilon) {
+    batch.clear();
+    batch.addSuccessors(position, moves);
+    if (epsilon > 0 && rng.uniform() < epsilon) return rng.below(moves.size());
+
+    scores.resize(moves.size());
+    batch.score(weights, scores.data());
+    return static_cast<size_t>(std::max_element(scores.begin(), scores.end()) - scores.begin());
+  }
+
+  [[nodiscard]] const EvalPosition &successor(size_t i) const { return batch[i]; }
+};
+
+// Plays one deal to the end; returns the winning seat, or 2 if it ran past kMaxPlies
+uint8_t playGame(uint64_t seed, Player *players[2], double epsilon, Samples *samples) {
+  auto position = Position::deal(SeedTree{seed}.child(0).seed);
+  auto rng = SeedTree{seed}.child(1).rng();
+  MoveList moves;
+  std::vector<uint8_t> seats;
+  const auto first = samples ? samples->size() : 0;
+
+  for (size_t ply = 0; ply < kMaxPlies && position.phase != Position::Phase::Finish; ++ply) {
+    moves.clear();
+    position.moves(moves);
+    auto &player = *players[position.seat];
+    auto choice = player.choose(position, moves, rng, epsilon);
+
+    if (samples) {
+      std::array<float, kEvalWidth> features{};
+      EvalBatch::features(player.successor(choice), features.data());
+      samples->features.insert(samples->features.end(), features.begin(), features.begin() + kEvalFeatureCount);
+      samples->features.push_back(position.phase == Position::Phase::Attack ? 1.0f : 0.0f);
+      seats.push_back(position.seat);
+    }
+    position.apply(moves[choice]);
+  }
+
+  if (position.phase != Position::Phase::Finish) {
+    if (samples) {
+      samples->features.resize(first * kColumns);
+      samples->labels.resize(first);
+    }
+    return 2;
+  }
+  if (samples)
+    for (auto seat : seats) samples->labels.push_back(seat == position.winner ? 1.0f : 0.0f);
+  return position.winner;
+}
+
+// Runs job(i) for i in [0, count) on `threads` threads, indices handed out one at a time
+template <typename Job>
+void parallelFor(size_t count, unsigned threads, const Job &job) {
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      for (size_t i = next++; i < count; i = next++) job(t, i);
+    });
+  }
+  for (auto &worker : workers) worker.join();
+}
+
+// Appends the samples of `games` games to `samples`, returns how many
+size_t selfPlay(const Weights &current, const SeedTree &round, size_t games, unsigned threads, double epsilon, Samples &samples) {
+  const EvalWeights weights(current);
+  // One sample set per game, joined in game order, so a round does not depend on the thread schedule
+  std::vector<Samples> perGame(games);
+  std::vector<std::unique_ptr<Player>> players(threads);
+  for (auto &player : players) player = std::make_unique<Player>(weights);
+
+  parallelFor(games, threads, [&](unsigned thread, size_t game) {
+    Player *seats[2] = {players[thread].get(), players[thread].get()};
+    playGame(round.child(game).seed, seats, epsilon, &perGame[game]);
+  });
+
+  const auto before = samples.size();
+  for (auto &game : perGame) {
+    samples.features.insert(samples.features.end(), game.features.begin(), game.features.end());
+    samples.labels.insert(samples.labels.end(), game.labels.begin(), game.labels.end());
+  }
+  return samples.size() - before;
+}
+
+struct FitResult {
+  double lossBefore{};
+  double loss{};
+  double accuracy{};
+};
+
+// Logistic regression on standardized features, starting from and returning raw evaluator weights
+FitResult fit(const Samples &samples, Weights &weights, size_t epochs, double rate, unsigned threads) {
+  const auto n = samples.size();
+  std::array<double, kColumns> mean{}, scale{};
+  for (size_t i = 0; i < n; ++i)
+    for (size_t f = 1; f < kColumns; ++f) mean[f] += samples.features[i * kColumns + f];
+  for (size_t f = 1; f < kColumns; ++f) mean[f] /= static_cast<double>(n);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t f = 1; f < kColumns; ++f) {
+      auto d = samples.features[i * kColumns + f] - mean[f];
+      scale[f] += d * d;
+    }
+  }
+  // 1 / standard deviation; a constant feature keeps a zero weight
+  for (size_t f = 1; f < kColumns; ++f) {
+    auto deviation = std::sqrt(scale[f] / static_cast<double>(n));
+    scale[f] = deviation > 1e-9 ? 1.0 / deviation : 0.0;
+  }
+
+  // The same model on standardized features: theta[f] = w[f] / scale[f], theta[0] = w[0] + sum of w[f] * mean[f]
+  std::array<double, kColumns> theta{};
+  theta[0] = weights[0];
+  for (size_t f = 1; f < kEvalFeatureCount; ++f) {
+    theta[f] = scale[f] > 0 ? weights[f] / scale[f] : 0.0;
+    theta[0] += weights[f] * mean[f];
+  }
+
+  struct Partial {
+    std::array<double, kColumns> gradient{};
+    double loss{};
+    size_t correct{};
+  };
+  std::vector<Partial> partials(threads);
+  const auto shard = (n + threads - 1) / threads;
+
+  FitResult result;
+  for (size_t epoch = 0; epoch <= epochs; ++epoch) {
+    parallelFor(threads, threads, [&](unsigned, size_t t) {
+      Partial partial;
+      std::array<double, kColumns> x{};
+      x[0] = 1.0;
+      for (size_t i = t * shard; i < std::min(n, (t + 1) * shard); ++i) {
+        const auto *row = &samples.features[i * kColumns];
+        double z = theta[0];
+        for (size_t f = 1; f < kColumns; ++f) {
+          x[f] = (row[f] - mean[f]) * scale[f];
+          z += theta[f] * x[f];
+        }
+        const double p = 1.0 / (1.0 + std::exp(-z));
+        const double y = samples.labels[i];
+        const double g = p - y;
+        for (size_t f = 0; f < kColumns; ++f) partial.gradient[f] += g * x[f];
+        partial.loss -= y * std::log(std::max(p, 1e-12)) + (1 - y) * std::log(std::max(1 - p, 1e-12));
+        partial.correct += (p >= 0.5) == (y >= 0.5);
+      }
+      partials[t] = partial;
+    });
+
+    Partial total;
+    for (auto &partial : partials) {
+      for (size_t f = 0; f < kColumns; ++f) total.gradient[f] += partial.gradient[f];
+      total.loss += partial.loss;
+      total.correct += partial.correct;
+    }
+    result.loss = total.loss / static_cast<double>(n);
+    result.accuracy = static_cast<double>(total.correct) / static_cast<double>(n);
+    if (epoch == 0) result.lossBefore = result.loss;
+    // The last pass only measures
+    if (epoch == epochs) break;
+
+    for (size_t f = 0; f < kColumns; ++f) theta[f] -= rate * total.gradient[f] / static_cast<double>(n);
+  }
+
+  double bias = theta[0];
+  for (size_t f = 1; f < kColumns; ++f) {
+    if (f != kAttackColumn) weights[f] = static_cast<float>(theta[f] * scale[f]);
+    bias -= theta[f] * scale[f] * mean[f];
+  }
+  weights[0] = static_cast<float>(bias);
+  return result;
+}
+
+// Share of the decided games `first` wins against `second`, seats alternating
+double winRate(const Weights &first, const Weights &second, const SeedTree &seeds, size_t games, unsigned threads) {
+  const EvalWeights a(first), b(second);
+  std::atomic<size_t> wins{0}, decided{0};
+  std::vector<std::array<std::unique_ptr<Player>, 2>> players(threads);
+  for (auto &pair : players) {
+    pair[0] = std::make_unique<Player>(a);
+    pair[1] = std::make_unique<Player>(b);
+  }
+
+  parallelFor(games, threads, [&](unsigned thread, size_t game) {
+    const size_t firstSeat = game % 2;
+    Player *seats[2];
+    seats[firstSeat] = players[thread][0].get();
+    seats[1 - firstSeat] = players[thread][1].get();
+    auto winner = playGame(seeds.child(game / 2).seed, seats, 0.0, nullptr);
+    if (winner == 2) return;
+    ++decided;
+    if (winner == firstSeat) ++wins;
+  });
+  return decided == 0 ? 0.0 : static_cast<double>(wins) / static_cast<double>(decided);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  size_t games = 20000;
+  size_t rounds = 3;
+  size_t epochs = 300;
+  double rate = 0.5;
+  double epsilon = 0.05;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  uint64_t seed = 1;
+  std::string init, out = "bura.weights";
+  size_t evalGames = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << option << std::endl;
+      return 2;
+    }
+
+    if (option == "--games")
+      games = std::stoul(argv[++i]);
+    else if (option == "--rounds")
+      rounds = std::stoul(argv[++i]);
+    else if (option == "--epochs")
+      epochs = std::stoul(argv[++i]);
+    else if (option == "--rate")
+      rate = std::stod(argv[++i]);
+    else if (option == "--epsilon")
+      epsilon = std::stod(argv[++i]);
+    else if (option == "--threads")
+      threads = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+    else if (option == "--seed")
+      seed = std::stoull(argv[++i]);
+    else if (option == "--init")
+      init = argv[++i];
+    else if (option == "--out")
+      out = argv[++i];
+    else if (option == "--eval")
+      evalGames = std::stoul(argv[++i]);
+    else {
+      std::cerr << "Unknown option " << option << std::endl;
+      return 2;
+    }
+  }
+
+  Weights weights{};
+  try {
+    const EvalWeights start = init.empty() ? EvalWeights() : EvalWeights(init);
+    std::copy(start.data(), start.data() + kEvalWidth, weights.begin());
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  const auto initial = weights;
+  const SeedTree root{seed};
+
+  std::cerr << std::left << std::setw(8) << "round" << std::right << std::setw(12) << "samples" << std::setw(14) << "samples/s" << std::setw(16)
+            << "fit samples/s" << std::setw(10) << "loss" << std::setw(10) << "accuracy" << std::endl;
+
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(4) << "{\"threads\":" << threads << ",\"rounds\":[";
+
+  // Every round fits the games of all rounds so far, which keeps one round's policy from swinging too far
+  Samples samples;
+  for (size_t round = 0; round < rounds; ++round) {
+    auto start = Clock::now();
+    auto played = selfPlay(weights, root.child(round), games, threads, epsilon, samples);
+    auto playSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (samples.size() == 0) {
+      std::cerr << "No finished games" << std::endl;
+      return 1;
+    }
+
+    start = Clock::now();
+    auto result = fit(samples, weights, epochs, rate, threads);
+    auto fitSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const auto playRate = static_cast<double>(played) / playSeconds;
+    const auto fitRate = static_cast<double>(samples.size()) * static_cast<double>(epochs + 1) / fitSeconds;
+    std::cerr << std::left << std::setw(8) << round + 1 << std::right << std::setw(12) << played << std::fixed << std::setprecision(0)
+              << std::setw(14) << playRate << std::setw(16) << fitRate << std::setprecision(4) << std::setw(10) << result.loss << std::setw(10)
+              << result.accuracy << std::endl;
+    json << (round == 0 ? "" : ",") << "{\"games\":" << games << ",\"samples\":" << played << ",\"fitted\":" << samples.size() << ",\"play_seconds\":" << playSeconds
+         << ",\"samples_per_second\":" << playRate << ",\"fit_seconds\":" << fitSeconds << ",\"fit_samples_per_second\":" << fitRate
+         << ",\"loss_before\":" << result.lossBefore << ",\"loss\":" << result.loss << ",\"accuracy\":" << result.accuracy << "}";
+  }
+  json << "]";
+
+  try {
+    EvalWeights::save(out, weights);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::cerr << "weights written to " << out << std::endl;
+
+  if (evalGames > 0) {
+    auto rate = winRate(weights, initial, root.child(rounds), evalGames, threads);
+    std::cerr << "against the initial weights: " << std::setprecision(1) << rate * 100.0 << "% of " << evalGames << " games won" << std::endl;
+    json << ",\"eval_games\":" << evalGames << ",\"eval_win_rate\":" << rate;
+  }
+
+  std::cout << json.str() << "}" << std::endl;
+  return 0;
+}
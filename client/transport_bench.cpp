@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "framed.h"
+#include "shm.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Compares the HTTP, raw framed and (with the server on this host) shared-memory transports against a running server.
+//
+// client_transport_bench [host] [calls]
+// Every call is a fetch (opcode 3) for the same player; the report goes to stderr, JSON to stdout.
+
+namespace {
+
+struct Result {
+  std::string name;
+  size_t calls{};
+  double bytesSent{};
+  double bytesReceived{};
+  double mean{};
+  double p50{};
+  double p99{};
+  double max{};
+};
+
+Result run(const std::string &name, http::TransportKind kind, const std::string &host, size_t calls) {
+  auto transport = http::makeTransport(kind, host, http::defaultPort(kind), std::chrono::seconds(5));
+  const std::string id = "BENCH001";
+
+  // The first call pays for connection setup on the persistent transport, keep it out of the samples
+  transport->call(3, id);
+  auto sentBefore = transport->getBytesSent();
+  auto receivedBefore = transport->getBytesReceived();
+
+  std::vector<uint64_t> samples;
+  samples.reserve(calls);
+
+  for (size_t i = 0; i < calls; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    transport->call(3, id);
+    samples.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  Result result;
+  result.name = name;
+  result.calls = calls;
+  result.bytesSent = static_cast<double>(transport->getBytesSent() - sentBefore) / static_cast<double>(calls);
+  result.bytesReceived = static_cast<double>(transport->getBytesReceived() - receivedBefore) / static_cast<double>(calls);
+
+  uint64_t sum = 0;
+  for (auto sample : samples) sum += sample;
+  // Sampled in nanoseconds, reported in microseconds: a shared-memory round trip is well below one
+  result.mean = static_cast<double>(sum) / static_cast<double>(calls) / 1000.0;
+  result.p50 = static_cast<double>(samples[samples.size() / 2]) / 1000.0;
+  result.p99 = static_cast<double>(samples[std::min(samples.size() - 1, samples.size() * 99 / 100)]) / 1000.0;
+  result.max = static_cast<double>(samples.back()) / 1000.0;
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+  size_t calls = argc > 2 ? std::stoul(argv[2]) : 1000;
+  if (calls == 0) calls = 1;
+
+  std::vector<Result> results;
+
+  try {
+    results.push_back(run("http", http::TransportKind::Http, host, calls));
+    results.push_back(run("framed", http::TransportKind::Framed, host, calls));
+#ifndef _WIN32
+    // Only when the server runs on this host
+    if (access(http::kShmSocketPath, F_OK) == 0) results.push_back(run("shm", http::TransportKind::Shm, host, calls));
+#endif
+  } catch (const std::exception &e) {
+    std::cerr << "Transport benchmark failed: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cerr << std::left << std::setw(10) << "transport" << std::right << std::setw(12) << "sent/call" << std::setw(12) << "recv/call"
+            << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max"
+            << "  (bytes, us)" << std::endl;
+
+  for (auto &result : results) {
+    std::cerr << std::left << std::setw(10) << result.name << std::right << std::fixed << std::setprecision(2) << std::setw(12) << result.bytesSent
+              << std::setw(12) << result.bytesReceived << std::setw(10) << result.mean << std::setw(10) << result.p50 << std::setw(10) << result.p99
+              << std::setw(10) << result.max << std::endl;
+  }
+
+  std::cout << std::fixed << std::setprecision(2) << "{\"transports\":[";
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto &result = results[i];
+    std::cout << (i == 0 ? "" : ",") << "{\"name\":\"" << result.name << "\",\"calls\":" << result.calls << ",\"bytes_sent_per_call\":" << result.bytesSent
+              << ",\"bytes_received_per_call\":" << result.bytesReceived << ",\"rtt_us\":{\"mean\":" << result.mean << ",\"p50\":" << result.p50
+              << ",\"p99\":" << result.p99 << ",\"max\":" << result.max << "}}";
+  }
+  std::cout << "]}" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef CLIENT_TRIPLE_BUFFER_H
+#define CLIENT_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace bura {
+
+// Latest-value handoff from one writer thread to one reader thread without locks.
+// The writer fills back() and publishes it; the reader takes the newest published value with update() and
+// reads it through front() until the next update. Neither side ever waits for the other or copies a T,
+// slots are reused, so assigning into back() keeps the capacity of its vectors.
+template <typename T>
+class TripleBuffer final {
+ private:
+  static constexpr uint8_t kIndexMask = 0x3;
+  static constexpr uint8_t kFresh = 0x4;  // the middle slot holds a value the reader has not taken yet
+
+  std::array<T, 3> slots{};
+  alignas(64) std::atomic<uint8_t> middle{1};
+  alignas(64) uint8_t writeIndex{0};
+  alignas(64) uint8_t readIndex{2};
+
+ public:
+  // Writer side
+  T &back() { return slots[writeIndex]; }
+  void publish() { writeIndex = middle.exchange(writeIndex | kFresh, std::memory_order_acq_rel) & kIndexMask; }
+
+  // Reader side; returns false if nothing was published since the last update
+  bool update() {
+    if (!(middle.load(std::memory_order_relaxed) & kFresh)) return false;
+    readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+  const T &front() const { return slots[readIndex]; }
+};
+
+}  // namespace bura
+
+#endif  // CLIENT_TRIPLE_BUFFER_H
@@ -1,5 +1,6 @@
 import { RequestHandler } from "./durak";
 import { createServer } from "http";
+import { listenFramed } from "./socketHandler";
 import './requests'
 
 const server = createServer(function (req, res) {
@@ -29,4 +30,14 @@ server.on("clientError", (err) => {
 
 server.listen(2021);
 
+// Same requests over raw TCP: u16 code + u32 length header, then the player id and payload
+listenFramed(2022, async (code, payload) => {
+	let codeBuff = Buffer.alloc(2);
+	codeBuff.writeUInt16LE(code);
+
+	let result = await RequestHandler(Buffer.concat([codeBuff, payload]));
+
+	return { code: result.readUInt16LE(0), data: result.slice(2) };
+})
+
 console.log(`started!`)
\ No newline at end of file
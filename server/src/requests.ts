@@ -99,10 +99,10 @@ function getOpponent(player: IPlayer) {
 	return getLobby(player?.store?.lobby)?.players?.find(x => x != player.id)
 }
 
-regHandler(3, ({ player, payload }) => {
+function buildState(player: IPlayer): { data?: Buffer, code: number } {
 	let lobby = getLobby(player?.store?.lobby);
 	
-	if (!lobby) return 1;
+	if (!lobby) return { code: 1 };
 	let opponent = getPlayer(getOpponent(player));
 
 	let status = lobby.status;
@@ -155,6 +155,34 @@ regHandler(3, ({ player, payload }) => {
 	
 
 	return { data: Buffer.concat([buffer, nickBuff]), code: 0 };
+}
+
+regHandler(3, ({ player }) => buildState(player))
+
+// Batched fetch for processes running many bots: u32 count + 8-byte player ids,
+// answered with u32 count + (u16 code, u32 length, opcode 3 state) per id
+regHandler(8, ({ payload }) => {
+	if (payload.length < 4) return { code: 1 };
+	// never trust the count beyond the ids actually sent
+	let count = Math.min(payload.readUInt32LE(0), Math.floor((payload.length - 4) / 8));
+	let parts: Buffer[] = [];
+
+	let countBuff = Buffer.alloc(4);
+	countBuff.writeUInt32LE(count);
+	parts.push(countBuff);
+
+	for (let i = 0; i < count; i++) {
+		let id = payload.slice(4 + (i * 8), 12 + (i * 8)).toString();
+		let result = buildState(getPlayer(id));
+		let data = result.data ?? Buffer.alloc(0);
+
+		let meta = Buffer.alloc(2 + 4);
+		meta.writeUInt16LE(result.code);
+		meta.writeUInt32LE(data.length, 2);
+		parts.push(meta, data);
+	}
+
+	return { data: Buffer.concat(parts), code: 0 };
 })
 
 function sortCards(id: string) {
@@ -1,7 +1,6 @@
 /// <reference path="./types/common.d.ts" />
 
-import { Socket } from "net"
-import { IPlayerStore } from "types/game";
+import { createServer, Socket } from "net"
 
 interface SocketInfo {
 	socket: Socket,
@@ -10,15 +9,15 @@ interface SocketInfo {
 	payloadCode: number,
 	payloadLength: number,
 	payload: Buffer | null,
-	store: Record<string,any>
+	queue: Promise<void>
 }
 
 
 const META_SIZE_BYTE = 2 + 4;
+// same limit as ServerConfig::maxRequest in the C++ server
+const MAX_PAYLOAD_BYTE = 1024 * 1024;
 
-type HandlerReturnType = { data?: Buffer, code?: number } | Buffer | number | undefined | void
-
-type CodeHandler = (param: { socket: Socket, store: IPlayerStore, code: number, payload: Buffer }) => MaybePromise<HandlerReturnType>; 
+type FrameHandler = (code: number, payload: Buffer) => MaybePromise<{ code: number, data: Buffer }>;
 
 function sendReponse(socket: Socket, payload: Buffer, code = 0) {
 	if (!socket.writable) return;
@@ -27,11 +26,14 @@ function sendReponse(socket: Socket, payload: Buffer, code = 0) {
 	meta.writeUInt16LE(code);
 	meta.writeUInt32LE(l, 2);
 
-	socket.write(meta);
-	socket.write(payload || Buffer.alloc(0));
+	// one write per frame, otherwise Nagle holds the payload back until the header is acked
+	socket.write(Buffer.concat([meta, payload]));
 }
 
-async function parseData(socketInfo: SocketInfo, data: Buffer, methods: Record<number, CodeHandler> ) {
+async function parseData(socketInfo: SocketInfo, data: Buffer, handler: FrameHandler) {
+	// chunks queued before an oversized frame closed the socket
+	if (socketInfo.socket.destroyed) return;
+
 	let cursor = 0;
 	const dataLength = data.length;
 	//console.log(`recive data: `, data);
@@ -49,6 +51,10 @@ async function parseData(socketInfo: SocketInfo, data: Buffer, methods: Record<n
 			if (socketInfo.metaSize >= META_SIZE_BYTE) {
 				socketInfo.payloadCode = socketInfo.metaBuff.readUInt16LE(0);
 				let length = socketInfo.metaBuff.readUInt32LE(2);
+				if (length > MAX_PAYLOAD_BYTE) {
+					socketInfo.socket.destroy();
+					return;
+				}
 				socketInfo.payloadLength = 0;
 				socketInfo.payload = Buffer.alloc(length);
 			}
@@ -68,31 +74,13 @@ async function parseData(socketInfo: SocketInfo, data: Buffer, methods: Record<n
 		}
 
 		if (socketInfo.payload) {
-			if (socketInfo.payload.length >= socketInfo.payloadLength) {
-
-
-				let handler = methods[socketInfo.payloadCode];
+			if (socketInfo.payload.length <= socketInfo.payloadLength) {
 
 				//console.log(`run code ${socketInfo.payloadCode}`)
 
-				let result: HandlerReturnType = await Promise.resolve(handler?.({ socket: socketInfo.socket, payload: socketInfo.payload, store: socketInfo.store as IPlayerStore, code: socketInfo.payloadCode }))
-
-
-				let rbuffer: Buffer;
-				let rcode: number = handler ? 0 : 1;
+				let result = await Promise.resolve(handler(socketInfo.payloadCode, socketInfo.payload));
 
-				if (typeof result == "object" && result != null) {
-					if (Buffer.isBuffer(result)) rbuffer = result;
-					else {
-						if (typeof result.code == "number") rcode = result.code;
-						if (Buffer.isBuffer(result.data)) rbuffer = result.data;
-					}
-				}
-				else if (typeof result == "number") rcode = result;
-
-				console.log(` result ${socketInfo.payloadCode}: `, rcode);
-
-				sendReponse(socketInfo.socket, rbuffer || Buffer.alloc(0), rcode);
+				sendReponse(socketInfo.socket, result.data, result.code);
 
 				socketInfo.payload = null;
 				socketInfo.payloadCode = -1;
@@ -102,3 +90,36 @@ async function parseData(socketInfo: SocketInfo, data: Buffer, methods: Record<n
 		}
 	}
 }
+
+export function listenFramed(port: number, handler: FrameHandler) {
+	const server = createServer((socket) => {
+		socket.setNoDelay(true);
+
+		let socketInfo: SocketInfo = {
+			socket,
+			metaBuff: Buffer.alloc(META_SIZE_BYTE),
+			metaSize: 0,
+			payloadCode: -1,
+			payloadLength: 0,
+			payload: null,
+			queue: Promise.resolve()
+		}
+
+		// chunks are parsed in arrival order even while a handler is still awaiting
+		socket.on("data", (data) => {
+			socketInfo.queue = socketInfo.queue
+				.then(() => parseData(socketInfo, data, handler))
+				.catch((err) => {
+					console.log('ferr', err);
+					socket.destroy();
+				});
+		})
+
+		socket.on("error", (err) => {
+			console.log('serr', err);
+		})
+	})
+
+	server.listen(port);
+	return server;
+}